@@ -0,0 +1,80 @@
+/*
+ * main.cpp
+ *
+ *  Created on:
+ *      Author:
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <util/shm_ring.h>
+
+/*
+ * @Brief: a minimal live consumer of the shared memory ring written by scc::create_vcd_shm_trace_file() or
+ * scv_tr_shm_init(). It attaches to the ring of the given trace or database, requests a snapshot and writes the
+ * snapshot followed by the published records to a file (or stdout) until the producer closes the ring. If records
+ * are lost a new snapshot is requested and the records until its arrival are skipped.
+ *
+ * usage: shm_consumer <trace or database name> [output file]
+ */
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <trace or database name> [output file]\n";
+        return 1;
+    }
+    auto name = util::shm::object_name(argv[1]);
+    std::unique_ptr<util::shm_ring_reader> reader;
+    // the producer creates the ring when the simulation starts tracing
+    for(unsigned retry = 0; !reader; ++retry) {
+        try {
+            reader.reset(new util::shm_ring_reader(name));
+        } catch(std::runtime_error& e) {
+            if(retry == 100) {
+                std::cerr << e.what() << "\n";
+                return 1;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    std::ofstream ofs;
+    if(argc > 2)
+        ofs.open(argv[2]);
+    std::ostream& out = argc > 2 ? ofs : std::cout;
+    std::cerr << "attached to " << name << " (format " << reader->get_header().format << ")\n";
+    reader->request_resync();
+    auto synced = false;
+    auto lost = reader->lost_bytes();
+    uint64_t bytes = 0;
+    auto cb = [&](util::shm::record_type type, char const* data, size_t len) {
+        if(type == util::shm::SNAPSHOT)
+            synced = true;
+        if(synced) {
+            out.write(data, len);
+            bytes += len;
+        }
+    };
+    while(true) {
+        auto closed = reader->closed();
+        if(!reader->read(cb)) {
+            if(closed)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if(reader->lost_bytes() != lost) {
+            std::cerr << "lost " << reader->lost_bytes() - lost << " bytes, requesting a snapshot\n";
+            lost = reader->lost_bytes();
+            synced = false;
+            reader->request_resync();
+        }
+    }
+    auto& hdr = reader->get_header();
+    std::cerr << "received " << bytes << " bytes, producer published " << hdr.records.load() << " records, dropped "
+              << hdr.dropped_records.load() << " and overwrote " << hdr.overwritten_records.load() << "\n";
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * sc_main.cpp
+ *
+ *  Created on:
+ *      Author:
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <scc.h>
+#include <scc/sc_observable_signal.h>
+#include <scc/trace.h>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+
+template <typename T> using plain_signal = sc_core::sc_signal<T>;
+template <typename T> using observable_signal = scc::sc_observable_signal<T>;
+/*
+ * @Brief: a module driving a configurable number of signals with changing values to measure the trace throughput
+ */
+template <template <typename> class SIGNAL> class stimuli : public sc_core::sc_module {
+public:
+    SC_HAS_PROCESS(stimuli);
+
+    stimuli(sc_core::sc_module_name nm, unsigned num_signals, unsigned cycles)
+    : sc_core::sc_module(nm)
+    , bool_sigs("bool_sig", num_signals)
+    , word_sigs("word_sig", num_signals)
+    , dword_sigs("dword_sig", num_signals)
+    , real_sigs("real_sig", num_signals)
+    , cycles(cycles) {
+        SC_THREAD(run);
+    }
+
+    sc_core::sc_vector<SIGNAL<bool>> bool_sigs;
+    sc_core::sc_vector<SIGNAL<uint32_t>> word_sigs;
+    sc_core::sc_vector<SIGNAL<uint64_t>> dword_sigs;
+    sc_core::sc_vector<SIGNAL<double>> real_sigs;
+
+    void trace(sc_core::sc_trace_file* tf) const override {
+        for(auto i = 0U; i < bool_sigs.size(); ++i) {
+            bool_sigs[i].trace(tf);
+            word_sigs[i].trace(tf);
+            dword_sigs[i].trace(tf);
+            real_sigs[i].trace(tf);
+        }
+    }
+
+private:
+    void run() {
+        for(auto c = 0U; c < cycles; ++c) {
+            for(auto i = 0U; i < bool_sigs.size(); ++i) {
+                if((c + i) % 3 == 0)
+                    bool_sigs[i].write(!bool_sigs[i].read());
+                if((c + i) % 2 == 0)
+                    word_sigs[i].write(c * 0x9e3779b1U + i);
+                if((c + i) % 4 == 0)
+                    dword_sigs[i].write(c * 0x9e3779b97f4a7c15ULL + i);
+                if((c + i) % 8 == 0)
+                    real_sigs[i].write(c * 0.1 + i);
+            }
+            wait(10, SC_NS);
+        }
+    }
+    unsigned const cycles;
+};
+
+int sc_main(int argc, char* argv[]) {
+    // clang-format off
+    scc::init_logging(
+            scc::LogConfig()
+            .logLevel(scc::log::INFO)
+            .logAsync(false)
+            .coloredOutput(true));
+    // clang-format on
+    // usage: trace_benchmark [pull|push|mt|fst|scw] [number of signals] [number of cycles] [number of compression threads]
+    //        [plain|observable]
+    // for fst a non-zero number of threads selects the background writer, observable uses signals pushing their
+    // changes into the trace file
+    std::string type = argc > 1 ? argv[1] : "mt";
+    unsigned num_signals = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000;
+    unsigned cycles = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10000;
+    unsigned threads = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : type == "mt" ? 1 : 0;
+    std::string signal_type = argc > 5 ? argv[5] : "plain";
+
+    std::unique_ptr<sc_core::sc_module> stim;
+    if(signal_type == "observable")
+        stim.reset(new stimuli<observable_signal>("stim", num_signals, cycles));
+    else
+        stim.reset(new stimuli<plain_signal>("stim", num_signals, cycles));
+    sc_core::sc_trace_file* tf{nullptr};
+    if(type == "pull")
+        tf = scc::create_vcd_pull_trace_file("trace_benchmark", threads);
+    else if(type == "push")
+        tf = scc::create_vcd_push_trace_file("trace_benchmark", threads);
+    else if(type == "fst")
+        tf = scc::create_fst_trace_file("trace_benchmark", threads > 0);
+    else if(type == "scw")
+        tf = scc::create_scw_trace_file("trace_benchmark");
+    else
+        tf = scc::create_vcd_mt_trace_file("trace_benchmark", threads);
+    stim->trace(tf);
+    auto start = std::chrono::high_resolution_clock::now();
+    sc_core::sc_start();
+    if(type == "pull")
+        scc::close_vcd_pull_trace_file(tf);
+    else if(type == "push")
+        scc::close_vcd_push_trace_file(tf);
+    else if(type == "fst")
+        scc::close_fst_trace_file(tf);
+    else if(type == "scw")
+        scc::close_scw_trace_file(tf);
+    else
+        scc::close_vcd_mt_trace_file(tf);
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    SCCINFO("sc_main") << "tracing " << 4 * num_signals << " signals over " << cycles << " cycles using the " << type
+                       << " writer, " << signal_type << " signals and " << threads
+                       << " compression threads took " << duration.count() << "ms";
+    return sc_core::sc_report_handler::get_count(SC_ERROR) + sc_core::sc_report_handler::get_count(SC_WARNING);
+}
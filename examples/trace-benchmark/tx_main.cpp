@@ -0,0 +1,86 @@
+/*
+ * tx_main.cpp
+ *
+ *  Created on:
+ *      Author:
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <scc.h>
+#include <scc/tracer.h>
+#include <string>
+#ifdef HAS_SCV
+#include <scv.h>
+#ifndef SCVNS
+#define SCVNS
+#endif
+#else
+#include <scv-tr.h>
+#ifndef SCVNS
+#define SCVNS ::scv_tr::
+#endif
+#endif
+
+using namespace sc_core;
+/*
+ * @Brief: a module recording a configurable number of transactions to measure the transaction recording throughput
+ */
+class initiator : public sc_core::sc_module {
+public:
+    SC_HAS_PROCESS(initiator);
+
+    initiator(sc_core::sc_module_name nm, uint64_t count)
+    : sc_core::sc_module(nm)
+    , count(count) {
+        SC_THREAD(run);
+    }
+
+private:
+    void run() {
+        SCVNS scv_tr_stream stream("tx_stream", "TRANSACTOR");
+        SCVNS scv_tr_generator<sc_dt::uint64, sc_dt::uint64> gen("access", stream, "addr", "data");
+        for(uint64_t i = 0; i < count; ++i) {
+            auto h = gen.begin_transaction(i * 4);
+            if(i % 16 == 0)
+                wait(10, SC_NS);
+            gen.end_transaction(h, i * 0x9e3779b97f4a7c15ULL);
+        }
+    }
+    uint64_t const count;
+};
+
+int sc_main(int argc, char* argv[]) {
+    // clang-format off
+    scc::init_logging(
+            scc::LogConfig()
+            .logLevel(scc::log::INFO)
+            .logAsync(false)
+            .coloredOutput(true));
+    // clang-format on
+    // usage: tx_benchmark [text|compressed|sqlite|mtc] [number of transactions]
+    // mtc selects the multi-threaded compressed writer
+    std::string type = argc > 1 ? argv[1] : "mtc";
+    uint64_t count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+#ifndef WITH_SQLITE
+    if(type == "sqlite") {
+        SCCERR("sc_main") << "the SQLite database is not available, configure SCC with -DENABLE_SQLITE=ON";
+        return 1;
+    }
+#endif
+    auto file_type = type == "text"         ? scc::tracer::TEXT
+                     : type == "compressed" ? scc::tracer::COMPRESSED
+                     : type == "sqlite"     ? scc::tracer::SQLITE
+                                            : scc::tracer::CUSTOM;
+    std::unique_ptr<scc::tracer> trc(new scc::tracer("tx_benchmark", file_type, false));
+    initiator init("init", count);
+    auto start = std::chrono::high_resolution_clock::now();
+    sc_core::sc_start();
+    // deleting the tracer closes the database and waits for all data being written
+    trc.reset();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    SCCINFO("sc_main") << "recording " << count << " transactions using the " << type << " database took "
+                       << duration.count() << "ms";
+    return sc_core::sc_report_handler::get_count(SC_ERROR) + sc_core::sc_report_handler::get_count(SC_WARNING);
+}
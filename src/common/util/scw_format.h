@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _COMMON_UTIL_SCW_FORMAT_H_
+#define _COMMON_UTIL_SCW_FORMAT_H_
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace util {
+/**
+ * @brief definitions of the SCW waveform format
+ *
+ * SCW is a chunked columnar waveform format allowing random access to single signals. Each traced value (column) is
+ * recorded as a sequence of blocks of delta encoded value changes, each block is LZ4 compressed on its own. An index
+ * at the end of the file lists the blocks of each column with their time range so that a reader only needs to
+ * decompress the blocks covering the requested time range of the requested signal. All integers are little endian.
+ *
+ * @code
+ * file    := header block* index trailer
+ * header  := "SCWAVE01" u32:version i32:time_exponent
+ * block   := LZ4 block compressed entries
+ * entries := { varint:time_delta value }*      time_delta is relative to the previous entry or the block start
+ * value   := varint (INTEGER) | f64 (REAL) | varint:length char* (BITS)
+ * index   := u32:columns { u8:kind u32:bits u32:blocks { u64:offset u32:csize u32:rsize u64:t_first u64:t_last
+ *            u32:count }* }* u32:signals { u32:column u32:length char* }*
+ * trailer := u64:index_offset "SCWINDEX"
+ * @endcode
+ * Several signals (aliases) may refer to the same column.
+ */
+namespace scw {
+//! the magic at the beginning of a SCW file
+static const char file_magic[] = "SCWAVE01";
+//! the magic at the end of a SCW file
+static const char index_magic[] = "SCWINDEX";
+//! the size of the magics
+static const size_t magic_size = 8;
+//! the version of the format
+static const uint32_t version = 1;
+//! the representation of the values of a column
+enum class value_kind : uint8_t {
+    //! unsigned integer values up to 64 bits
+    INTEGER = 0,
+    //! double precision floating point values
+    REAL = 1,
+    //! bit vectors as string of characters of 0, 1, X, Z etc.
+    BITS = 2
+};
+//! appends a value using LEB128 variable length encoding
+inline void put_varint(std::string& out, uint64_t val) {
+    while(val >= 0x80) {
+        out.push_back(static_cast<char>(val | 0x80));
+        val >>= 7;
+    }
+    out.push_back(static_cast<char>(val));
+}
+//! appends the raw (little endian) representation of a value
+template <typename T> inline void put(std::string& out, T val) {
+    out.append(reinterpret_cast<char const*>(&val), sizeof(T));
+}
+//! reads a LEB128 encoded value and advances the pointer
+inline uint64_t get_varint(char const*& ptr, char const* end) {
+    uint64_t res = 0;
+    for(unsigned shift = 0; ptr < end && shift < 64; shift += 7) {
+        auto c = static_cast<uint8_t>(*ptr++);
+        res |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if(!(c & 0x80))
+            return res;
+    }
+    throw std::runtime_error("corrupt SCW varint");
+}
+//! reads the raw (little endian) representation of a value and advances the pointer
+template <typename T> inline T get(char const*& ptr, char const* end) {
+    if(end - ptr < static_cast<ptrdiff_t>(sizeof(T)))
+        throw std::runtime_error("truncated SCW data");
+    T res;
+    memcpy(&res, ptr, sizeof(T));
+    ptr += sizeof(T);
+    return res;
+}
+} // namespace scw
+} // namespace util
+#endif /* _COMMON_UTIL_SCW_FORMAT_H_ */
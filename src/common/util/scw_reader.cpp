@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#include "scw_reader.h"
+#include <algorithm>
+#include <lz4.h>
+#include <stdexcept>
+
+namespace util {
+
+scw_reader::scw_reader(std::string const& file_name)
+: in(file_name, std::ios::binary) {
+    if(!in.is_open())
+        throw std::runtime_error("Could not open " + file_name);
+    char head[scw::magic_size + 8];
+    in.read(head, sizeof(head));
+    if(!in || memcmp(head, scw::file_magic, scw::magic_size) != 0)
+        throw std::runtime_error(file_name + " is not a SCW file");
+    char const* ptr = head + scw::magic_size;
+    if(scw::get<uint32_t>(ptr, head + sizeof(head)) > scw::version)
+        throw std::runtime_error(file_name + " has an unsupported version");
+    time_exponent = scw::get<int32_t>(ptr, head + sizeof(head));
+    // the trailer gives the location of the index
+    char trailer[8 + scw::magic_size];
+    in.seekg(-static_cast<std::streamoff>(sizeof(trailer)), std::ios::end);
+    auto index_end = static_cast<uint64_t>(in.tellg());
+    in.read(trailer, sizeof(trailer));
+    if(!in || memcmp(trailer + 8, scw::index_magic, scw::magic_size) != 0)
+        throw std::runtime_error(file_name + " has no index, the file is probably incomplete");
+    ptr = trailer;
+    auto index_offset = scw::get<uint64_t>(ptr, trailer + sizeof(trailer));
+    if(index_offset > index_end)
+        throw std::runtime_error(file_name + " has a corrupt index");
+    std::vector<char> index(index_end - index_offset);
+    in.seekg(index_offset);
+    in.read(index.data(), index.size());
+    ptr = index.data();
+    auto end = index.data() + index.size();
+    columns.resize(scw::get<uint32_t>(ptr, end));
+    for(auto& c : columns) {
+        c.kind = static_cast<scw::value_kind>(scw::get<uint8_t>(ptr, end));
+        c.bits = scw::get<uint32_t>(ptr, end);
+        c.blocks.resize(scw::get<uint32_t>(ptr, end));
+        for(auto& b : c.blocks) {
+            b.offset = scw::get<uint64_t>(ptr, end);
+            b.csize = scw::get<uint32_t>(ptr, end);
+            b.rsize = scw::get<uint32_t>(ptr, end);
+            b.t_first = scw::get<uint64_t>(ptr, end);
+            b.t_last = scw::get<uint64_t>(ptr, end);
+            b.count = scw::get<uint32_t>(ptr, end);
+        }
+    }
+    signals.resize(scw::get<uint32_t>(ptr, end));
+    for(size_t i = 0; i < signals.size(); ++i) {
+        auto& s = signals[i];
+        s.column = scw::get<uint32_t>(ptr, end);
+        auto len = scw::get<uint32_t>(ptr, end);
+        if(s.column >= columns.size() || end - ptr < len)
+            throw std::runtime_error(file_name + " has a corrupt index");
+        s.name.assign(ptr, len);
+        ptr += len;
+        s.kind = columns[s.column].kind;
+        s.bits = columns[s.column].bits;
+        signal_idx[s.name] = i;
+    }
+}
+
+scw_reader::signal const* scw_reader::find(std::string const& name) const {
+    auto it = signal_idx.find(name);
+    return it == signal_idx.end() ? nullptr : &signals[it->second];
+}
+
+std::vector<scw_reader::value_change> scw_reader::read(signal const& sig, uint64_t from, uint64_t to) {
+    std::vector<value_change> res;
+    auto const& col = columns[sig.column];
+    // the last block starting at or before 'from' holds the value valid at 'from'
+    auto it = std::upper_bound(col.blocks.begin(), col.blocks.end(), from,
+                               [](uint64_t t, block const& b) { return t < b.t_first; });
+    if(it != col.blocks.begin())
+        --it;
+    for(; it != col.blocks.end() && it->t_first <= to; ++it)
+        decode(col, *it, from, to, res);
+    return res;
+}
+
+void scw_reader::decode(column const& col, block const& blk, uint64_t from, uint64_t to,
+                        std::vector<value_change>& res) {
+    cbuf.resize(blk.csize);
+    rbuf.resize(blk.rsize);
+    in.clear();
+    in.seekg(blk.offset);
+    in.read(cbuf.data(), blk.csize);
+    if(!in || LZ4_decompress_safe(cbuf.data(), rbuf.data(), blk.csize, blk.rsize) != static_cast<int>(blk.rsize))
+        throw std::runtime_error("corrupt SCW block");
+    char const* ptr = rbuf.data();
+    char const* end = ptr + rbuf.size();
+    auto time = blk.t_first;
+    value_change vc{0, 0, 0.0, std::string()};
+    for(uint32_t i = 0; i < blk.count; ++i) {
+        time += scw::get_varint(ptr, end);
+        vc.time = time;
+        switch(col.kind) {
+        case scw::value_kind::INTEGER:
+            vc.value = scw::get_varint(ptr, end);
+            break;
+        case scw::value_kind::REAL:
+            vc.real = scw::get<double>(ptr, end);
+            break;
+        default: {
+            auto len = scw::get_varint(ptr, end);
+            if(static_cast<uint64_t>(end - ptr) < len)
+                throw std::runtime_error("corrupt SCW block");
+            vc.bits.assign(ptr, len);
+            ptr += len;
+        }
+        }
+        if(time > to)
+            break;
+        if(time <= from && res.size() && res.back().time <= from)
+            res.back() = vc; // only the value valid at 'from' is kept
+        else
+            res.push_back(vc);
+    }
+}
+} // namespace util
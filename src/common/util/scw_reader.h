@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _COMMON_UTIL_SCW_READER_H_
+#define _COMMON_UTIL_SCW_READER_H_
+
+#include "scw_format.h"
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace util {
+/**
+ * @class scw_reader
+ * @brief random access reader of SCW waveform files
+ *
+ * The reader loads the index of the file when being opened, the value changes are read on demand. Extracting a signal
+ * over a time range only reads and decompresses the blocks of this signal overlapping the range.
+ */
+class scw_reader {
+public:
+    /**
+     * @struct signal
+     * @brief the description of a traced signal
+     */
+    struct signal {
+        //! the hierarchical name
+        std::string name;
+        //! the kind of the values
+        scw::value_kind kind;
+        //! the width in bits
+        unsigned bits;
+        //! the column holding the values, aliases share a column
+        uint32_t column;
+    };
+    /**
+     * @struct value_change
+     * @brief a single value change, depending on the kind of the signal one of the values is valid
+     */
+    struct value_change {
+        //! the time of the change in units of the time scale
+        uint64_t time;
+        //! the value of an INTEGER signal
+        uint64_t value;
+        //! the value of a REAL signal
+        double real;
+        //! the value of a BITS signal
+        std::string bits;
+    };
+    /**
+     * @fn  scw_reader(const std::string&)
+     * @brief opens a file and reads its index, throws a std::runtime_error if this fails
+     *
+     * @param file_name the name of the file
+     */
+    explicit scw_reader(std::string const& file_name);
+    /**
+     * @fn const std::vector<signal>& get_signals()const
+     * @brief returns the descriptions of all signals
+     */
+    std::vector<signal> const& get_signals() const { return signals; }
+    /**
+     * @fn const signal* find(const std::string&)const
+     * @brief looks up a signal by its hierarchical name
+     *
+     * @return the signal description or nullptr if no such signal exists
+     */
+    signal const* find(std::string const& name) const;
+    /**
+     * @fn int get_time_exponent()const
+     * @brief returns the time scale of the file as power of 10 in seconds, e.g. -12 for ps
+     */
+    int get_time_exponent() const { return time_exponent; }
+    /**
+     * @fn std::vector<value_change> read(const signal&, uint64_t, uint64_t)
+     * @brief extracts the value changes of a signal within a time range. The first element holds the value valid at
+     * the start of the range, i.e. the last change before or at 'from' if there is one.
+     *
+     * @param sig the signal
+     * @param from the start of the range
+     * @param to the end of the range (inclusive)
+     * @return the value changes
+     */
+    std::vector<value_change> read(signal const& sig, uint64_t from = 0,
+                                   uint64_t to = std::numeric_limits<uint64_t>::max());
+
+private:
+    struct block {
+        uint64_t offset;
+        uint32_t csize, rsize;
+        uint64_t t_first, t_last;
+        uint32_t count;
+    };
+    struct column {
+        scw::value_kind kind;
+        unsigned bits;
+        std::vector<block> blocks;
+    };
+    void decode(column const& col, block const& blk, uint64_t from, uint64_t to, std::vector<value_change>& res);
+    std::ifstream in;
+    int time_exponent{-12};
+    std::vector<column> columns;
+    std::vector<signal> signals;
+    std::unordered_map<std::string, size_t> signal_idx;
+    std::vector<char> cbuf, rbuf;
+};
+} // namespace util
+#endif /* _COMMON_UTIL_SCW_READER_H_ */
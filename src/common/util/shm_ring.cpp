@@ -0,0 +1,266 @@
+/*******************************************************************************
+ * Copyright 2024 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#include "shm_ring.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace util {
+namespace {
+static_assert(sizeof(shm::header) == 320, "unexpected layout of the shared memory ring header");
+
+struct record_header {
+    uint32_t length;
+    uint16_t type;
+    uint16_t flags;
+};
+static_assert(sizeof(record_header) == shm::record_header_size, "unexpected layout of the record header");
+
+#ifdef _WIN32
+char* map(std::string const& name, bool create, size_t& size) {
+    throw std::runtime_error("shared memory ring buffers are not supported on this platform");
+}
+void unmap(void* ptr, size_t size) {}
+void unlink(std::string const& name) {}
+#else
+char* map(std::string const& name, bool create, size_t& size) {
+    auto flags = create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR;
+    if(create)
+        shm_unlink(name.c_str());
+    auto fd = shm_open(name.c_str(), flags, 0600);
+    if(fd < 0)
+        throw std::runtime_error("could not open shared memory object " + name);
+    if(create) {
+        if(ftruncate(fd, size) != 0) {
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::runtime_error("could not size shared memory object " + name);
+        }
+    } else {
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(shm::header))) {
+            close(fd);
+            throw std::runtime_error("shared memory object " + name + " is not a ring buffer");
+        }
+        size = st.st_size;
+    }
+    auto* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(ptr == MAP_FAILED)
+        throw std::runtime_error("could not map shared memory object " + name);
+    return static_cast<char*>(ptr);
+}
+void unmap(void* ptr, size_t size) { munmap(ptr, size); }
+void unlink(std::string const& name) { shm_unlink(name.c_str()); }
+#endif
+} // namespace
+
+std::string shm::object_name(std::string const& name) {
+    auto res = name;
+    std::replace(res.begin(), res.end(), '/', '_');
+    std::replace(res.begin(), res.end(), '\\', '_');
+    return "/" + res;
+}
+
+shm_ring_writer::shm_ring_writer(std::string const& name, size_t capacity, shm::policy policy,
+                                 std::string const& format)
+: name(name)
+, pol(policy) {
+    this->capacity = 4096;
+    while(this->capacity < capacity)
+        this->capacity <<= 1;
+    map_size = sizeof(shm::header) + this->capacity;
+    auto* ptr = map(name, true, map_size);
+    // the object is zero filled, the atomics are constructed in place
+    hdr = new(ptr) shm::header();
+    data = ptr + sizeof(shm::header);
+    hdr->version = shm::version;
+    hdr->policy = static_cast<uint32_t>(policy);
+    hdr->capacity = this->capacity;
+    strncpy(hdr->format, format.c_str(), sizeof(hdr->format) - 1);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(hdr->magic, shm::magic, sizeof(hdr->magic));
+}
+
+shm_ring_writer::~shm_ring_writer() {
+    if(hdr) {
+        hdr->closed.store(1, std::memory_order_release);
+        unmap(hdr, map_size);
+        unlink(name);
+    }
+}
+
+bool shm_ring_writer::write(shm::record_type type, char const* payload, size_t length) {
+    // the limit does not depend on the current position so that a payload either always or never fits
+    if(length > capacity / 2)
+        throw std::length_error("a record of " + std::to_string(length) + " bytes does not fit into the " +
+                                std::to_string(capacity) + " bytes of the shared memory ring " + name);
+    // a record occupies at most a quarter of the ring, larger payloads are split into fragments
+    size_t const max_fragment = capacity / 4 - shm::record_header_size;
+    size_t const fragments = length > max_fragment ? (length + max_fragment - 1) / max_fragment : 1;
+    // the space needed by all fragments including the padding at the end of the data area
+    uint64_t needed = 0;
+    for(size_t i = 0, offs = head & (capacity - 1), rem = length; i < fragments; ++i) {
+        auto size = shm::record_size(std::min(rem, max_fragment));
+        if(offs + size > capacity) {
+            needed += capacity - offs;
+            offs = 0;
+        }
+        needed += size;
+        offs += size;
+        rem -= std::min(rem, max_fragment);
+    }
+    if(pol == shm::policy::DROP) {
+        tail = hdr->tail.load(std::memory_order_acquire);
+        if(capacity - (head - tail) < needed) {
+            hdr->dropped_records.fetch_add(1, std::memory_order_relaxed);
+            hdr->dropped_bytes.fetch_add(length, std::memory_order_relaxed);
+            return false;
+        }
+    } else if(capacity - (head - tail) < needed) {
+        // release the oldest records, the consumer detects this by checking the tail after copying a record
+        uint64_t records = 0, bytes = 0;
+        while(capacity - (head - tail) < needed) {
+            auto* rec = reinterpret_cast<record_header*>(data + (tail & (capacity - 1)));
+            if(rec->type != shm::PADDING) {
+                ++records;
+                bytes += rec->length;
+            }
+            tail += shm::record_size(rec->length);
+        }
+        hdr->tail.store(tail, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        hdr->overwritten_records.fetch_add(records, std::memory_order_relaxed);
+        hdr->overwritten_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    // the fragments become visible at once when the head is published
+    for(size_t i = 0, rem = length; i < fragments; ++i) {
+        auto len = std::min(rem, max_fragment);
+        auto size = shm::record_size(len);
+        auto offs = head & (capacity - 1);
+        if(offs + size > capacity) {
+            auto* rec = reinterpret_cast<record_header*>(data + offs);
+            rec->length = capacity - offs - shm::record_header_size;
+            rec->type = shm::PADDING;
+            rec->flags = 0;
+            head += capacity - offs;
+            offs = 0;
+        }
+        auto* rec = reinterpret_cast<record_header*>(data + offs);
+        rec->length = len;
+        rec->type = type;
+        rec->flags = (i ? shm::CONTINUED : 0) | (i + 1 < fragments ? shm::MORE : 0);
+        memcpy(data + offs + shm::record_header_size, payload, len);
+        payload += len;
+        rem -= len;
+        head += size;
+    }
+    hdr->head.store(head, std::memory_order_release);
+    hdr->records.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+shm_ring_writer::statistics shm_ring_writer::get_statistics() const {
+    statistics s;
+    s.records = hdr->records.load(std::memory_order_relaxed);
+    s.dropped_records = hdr->dropped_records.load(std::memory_order_relaxed);
+    s.dropped_bytes = hdr->dropped_bytes.load(std::memory_order_relaxed);
+    s.overwritten_records = hdr->overwritten_records.load(std::memory_order_relaxed);
+    s.overwritten_bytes = hdr->overwritten_bytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+shm_ring_reader::shm_ring_reader(std::string const& name) {
+    auto* ptr = map(name, false, map_size);
+    hdr = reinterpret_cast<shm::header*>(ptr);
+    data = ptr + sizeof(shm::header);
+    capacity = hdr->capacity;
+    if(memcmp(hdr->magic, shm::magic, sizeof(hdr->magic)) != 0 || hdr->version != shm::version ||
+       capacity & (capacity - 1) || sizeof(shm::header) + capacity > map_size) {
+        unmap(ptr, map_size);
+        throw std::runtime_error("shared memory object " + name + " is not a ring buffer");
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    pos = hdr->tail.load(std::memory_order_acquire);
+}
+
+shm_ring_reader::~shm_ring_reader() { unmap(hdr, map_size); }
+
+size_t shm_ring_reader::read(callback const& cb, size_t max_records) {
+    auto const overwrite = hdr->policy == static_cast<uint32_t>(shm::policy::OVERWRITE);
+    auto head = hdr->head.load(std::memory_order_acquire);
+    size_t count = 0;
+    while(pos < head && count < max_records) {
+        if(overwrite) {
+            auto tail = hdr->tail.load(std::memory_order_acquire);
+            if(pos < tail) {
+                lost += tail - pos;
+                pos = tail;
+                assembling = false;
+                continue;
+            }
+        }
+        auto offs = pos & (capacity - 1);
+        record_header rec;
+        memcpy(&rec, data + offs, sizeof(rec));
+        auto size = shm::record_size(rec.length);
+        if(offs + size > capacity) {
+            // only possible if the record header has been overwritten while reading it
+            pos = hdr->tail.load(std::memory_order_acquire);
+            assembling = false;
+            continue;
+        }
+        if(rec.type != shm::PADDING) {
+            char const* payload = data + offs + shm::record_header_size;
+            if(overwrite) {
+                buffer.assign(payload, payload + rec.length);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(hdr->tail.load(std::memory_order_relaxed) > pos)
+                    continue; // overwritten while copying, skipped at the top of the loop
+                payload = buffer.data();
+            }
+            auto type = static_cast<shm::record_type>(rec.type);
+            if(!(rec.flags & (shm::MORE | shm::CONTINUED))) {
+                assembling = false;
+                cb(type, payload, rec.length);
+                ++count;
+            } else if(!(rec.flags & shm::CONTINUED)) {
+                fragments.assign(payload, payload + rec.length);
+                assembling = true;
+            } else if(assembling) {
+                fragments.insert(fragments.end(), payload, payload + rec.length);
+                if(!(rec.flags & shm::MORE)) {
+                    assembling = false;
+                    cb(type, fragments.data(), fragments.size());
+                    ++count;
+                }
+            } // else the first fragments have been overwritten, the remaining ones are skipped
+        }
+        pos += size;
+        if(!overwrite)
+            hdr->tail.store(pos, std::memory_order_release);
+    }
+    return count;
+}
+} // namespace util
@@ -0,0 +1,289 @@
+/*******************************************************************************
+ * Copyright 2024 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _COMMON_UTIL_SHM_RING_H_
+#define _COMMON_UTIL_SHM_RING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace util {
+/**
+ * @brief definitions of the shared memory ring buffer used to stream trace data to a live consumer
+ *
+ * The ring is a POSIX shared memory object consisting of a header followed by the data area. A single producer
+ * appends records, a consumer (viewer, checker, dashboard) maps the same object and reads them in place. The
+ * producer never waits for the consumer: if the ring is full a new record is either dropped (DROP) or the oldest
+ * records are overwritten (OVERWRITE), both cases are counted in the header. All numbers use the byte order of the
+ * host, the ring is meant to be used on a single machine.
+ *
+ * @code
+ * offset  size  field
+ *      0     8  magic "SCCSHMR1", written last when the producer has initialized the header
+ *      8     4  version
+ *     12     4  policy, 0 = DROP, 1 = OVERWRITE
+ *     16     8  capacity of the data area in bytes, a power of 2
+ *     24    16  format of the payload as zero terminated string, e.g. "vcd" or "txlog"
+ *     40     4  closed, set to 1 when the producer has finished
+ *     64     8  head: the position after the last published record (written by the producer)
+ *    128     8  tail: the position of the oldest readable record. In DROP mode the consumer advances it after
+ *               reading a record, in OVERWRITE mode the producer advances it before overwriting a record
+ *    192     8  resync: incremented by a consumer to request a SNAPSHOT record
+ *    256     8  number of published records
+ *    264     8  number of dropped records
+ *    272     8  number of dropped payload bytes
+ *    280     8  number of overwritten records
+ *    288     8  number of overwritten payload bytes
+ *    320        data area
+ *
+ * record  := u32:length u16:type u16:flags payload[length] padding to a multiple of 8 bytes
+ * @endcode
+ * Positions are byte counters which only increase, the offset of a position in the data area is position modulo
+ * capacity. A record never wraps around the end of the data area, the remainder is filled with a PADDING record.
+ * Payloads not fitting into a quarter of the capacity are split into fragments which are published at once: all but
+ * the last fragment carry the MORE flag, all but the first one the CONTINUED flag. The reader reassembles them and
+ * drops fragments whose first part has been lost. Payloads larger than half of the capacity are rejected.
+ */
+namespace shm {
+//! the magic at the beginning of the shared memory object
+static const char magic[] = "SCCSHMR1";
+//! the version of the layout
+static const uint32_t version = 1;
+//! the behavior of the producer if the ring is full
+enum class policy : uint32_t {
+    //! new records are dropped until the consumer has made room
+    DROP = 0,
+    //! the oldest records are overwritten
+    OVERWRITE = 1
+};
+//! the type of a record
+enum record_type : uint16_t {
+    //! a part of the stream in the given format
+    DATA = 1,
+    //! the complete state (definitions and current values) sent in response to a resync request. A consumer which
+    //! lost records can restart its parsing from a snapshot
+    SNAPSHOT = 2,
+    //! fills the end of the data area, to be skipped
+    PADDING = 0xffff
+};
+//! the flags of a record being a fragment of a larger payload
+enum record_flags : uint16_t {
+    //! further fragments of the payload follow
+    MORE = 1,
+    //! the record continues the payload of the previous record
+    CONTINUED = 2
+};
+//! the header of the shared memory object
+struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t policy;
+    uint64_t capacity;
+    char format[16];
+    std::atomic<uint32_t> closed;
+    uint32_t reserved;
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint64_t> resync;
+    alignas(64) std::atomic<uint64_t> records;
+    std::atomic<uint64_t> dropped_records;
+    std::atomic<uint64_t> dropped_bytes;
+    std::atomic<uint64_t> overwritten_records;
+    std::atomic<uint64_t> overwritten_bytes;
+};
+//! the size of the record header
+static const size_t record_header_size = 8;
+//! returns the size a record with the given payload occupies in the data area
+inline uint64_t record_size(uint64_t length) { return (record_header_size + length + 7) & ~uint64_t(7); }
+/**
+ * @fn std::string object_name(const std::string&)
+ * @brief derives the name of a POSIX shared memory object from a (file) name: it starts with a slash and contains no
+ * further slash
+ *
+ * @param name the name, e.g. the name of the trace file
+ * @return the name of the shared memory object
+ */
+std::string object_name(std::string const& name);
+} // namespace shm
+/**
+ * @class shm_ring_writer
+ * @brief the producer side of the shared memory ring, creates the shared memory object
+ *
+ * Only a single producer thread is supported. Writing a record does not lock nor wait, if the consumer does not keep
+ * up the record is dropped or the oldest records are overwritten depending on the policy.
+ */
+class shm_ring_writer {
+public:
+    /**
+     * @struct statistics
+     * @brief counters describing the operation of the ring
+     */
+    struct statistics {
+        //! number of published records
+        uint64_t records{0};
+        //! number of records dropped since the ring was full (DROP) or too large
+        uint64_t dropped_records{0};
+        //! number of payload bytes dropped
+        uint64_t dropped_bytes{0};
+        //! number of records overwritten before the consumer read them (OVERWRITE)
+        uint64_t overwritten_records{0};
+        //! number of payload bytes overwritten
+        uint64_t overwritten_bytes{0};
+    };
+    /**
+     * @fn  shm_ring_writer(const std::string&, size_t, shm::policy, const std::string&)
+     * @brief creates the shared memory object, an existing object of the same name is replaced. Throws a
+     * std::runtime_error if this fails
+     *
+     * @param name the name of the shared memory object, see shm::object_name()
+     * @param capacity the size of the data area in bytes, rounded up to the next power of 2
+     * @param policy the behavior if the ring is full
+     * @param format the format of the payload written into the header
+     */
+    shm_ring_writer(std::string const& name, size_t capacity, shm::policy policy, std::string const& format);
+
+    shm_ring_writer(shm_ring_writer const&) = delete;
+
+    shm_ring_writer& operator=(shm_ring_writer const&) = delete;
+    /**
+     * @fn  ~shm_ring_writer()
+     * @brief marks the ring as closed and removes the name of the shared memory object. Consumers having it mapped
+     * can still read the remaining records
+     */
+    ~shm_ring_writer();
+    /**
+     * @fn bool write(shm::record_type, const char*, size_t)
+     * @brief publishes a record, a large payload is split into fragments. Throws a std::length_error if the payload is
+     * larger than half of the capacity
+     *
+     * @param type the type of the record
+     * @param data the payload
+     * @param length the size of the payload in bytes
+     * @return false if the record has been dropped
+     */
+    bool write(shm::record_type type, char const* data, size_t length);
+    /**
+     * @fn bool resync_requested()
+     * @brief checks if a consumer requested a snapshot since the last call, the check is cheap and meant to be done
+     * before writing the records of a time step
+     *
+     * @return true if a SNAPSHOT record should be written
+     */
+    inline bool resync_requested() {
+        auto r = hdr->resync.load(std::memory_order_relaxed);
+        if(r == last_resync)
+            return false;
+        last_resync = r;
+        return true;
+    }
+    /**
+     * @fn statistics get_statistics()const
+     * @brief returns the statistics of the ring
+     *
+     * @return the statistics
+     */
+    statistics get_statistics() const;
+    /**
+     * @fn const std::string& get_name()const
+     * @brief returns the name of the shared memory object
+     */
+    std::string const& get_name() const { return name; }
+
+private:
+    std::string const name;
+    shm::header* hdr{nullptr};
+    char* data{nullptr};
+    size_t map_size{0};
+    uint64_t capacity{0};
+    uint64_t head{0};
+    uint64_t tail{0};
+    uint64_t last_resync{0};
+    shm::policy const pol;
+};
+/**
+ * @class shm_ring_reader
+ * @brief the consumer side of the shared memory ring, attaches to an existing shared memory object
+ *
+ * In DROP mode the records are handed to the callback in place (zero copy) and the space is released once the
+ * callback returns. In OVERWRITE mode a record is copied and validated before being handed to the callback since the
+ * producer may overwrite it at any time. Fragmented payloads are reassembled and handed to the callback as a single
+ * record. Only a single consumer is supported in DROP mode.
+ */
+class shm_ring_reader {
+public:
+    //! the callback receiving the type, payload and length of a record
+    using callback = std::function<void(shm::record_type, char const*, size_t)>;
+    /**
+     * @fn  shm_ring_reader(const std::string&)
+     * @brief maps the shared memory object, throws a std::runtime_error if this fails or if it is not a ring
+     *
+     * @param name the name of the shared memory object
+     */
+    explicit shm_ring_reader(std::string const& name);
+
+    shm_ring_reader(shm_ring_reader const&) = delete;
+
+    shm_ring_reader& operator=(shm_ring_reader const&) = delete;
+
+    ~shm_ring_reader();
+    /**
+     * @fn size_t read(const callback&, size_t)
+     * @brief reads the records published since the last call
+     *
+     * @param cb the callback invoked for each record
+     * @param max_records the maximum number of records to read
+     * @return the number of records handed to the callback
+     */
+    size_t read(callback const& cb, size_t max_records = SIZE_MAX);
+    /**
+     * @fn void request_resync()
+     * @brief asks the producer to write a SNAPSHOT record, e.g. after attaching or after records have been lost
+     */
+    void request_resync() { hdr->resync.fetch_add(1, std::memory_order_relaxed); }
+    /**
+     * @fn bool closed()const
+     * @brief checks if the producer has finished
+     *
+     * @return true if no further records will be published
+     */
+    bool closed() const { return hdr->closed.load(std::memory_order_acquire) != 0; }
+    /**
+     * @fn uint64_t lost_bytes()const
+     * @brief returns the number of bytes of records which have been overwritten before this reader got them
+     */
+    uint64_t lost_bytes() const { return lost; }
+    /**
+     * @fn const shm::header& get_header()const
+     * @brief gives access to the header holding the format and the counters of the producer
+     */
+    shm::header const& get_header() const { return *hdr; }
+
+private:
+    shm::header* hdr{nullptr};
+    char* data{nullptr};
+    size_t map_size{0};
+    uint64_t capacity{0};
+    uint64_t pos{0};
+    uint64_t lost{0};
+    bool assembling{false};
+    std::vector<char> buffer;
+    std::vector<char> fragments;
+};
+} // namespace util
+#endif /* _COMMON_UTIL_SHM_RING_H_ */
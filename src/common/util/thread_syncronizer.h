@@ -56,6 +56,15 @@ public:
      * @return true if it can handle a new request
      */
     bool is_ready() { return ready.load(std::memory_order_acquire); }
+    /**
+     * check if there are tasks waiting for execution
+     *
+     * @return true if at least one task is queued
+     */
+    bool has_pending() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return !tasks_.empty();
+    }
     /**
      * enqueue a function to be executed in the other thread and wait for completion
      *
@@ -94,10 +103,10 @@ public:
      * execute the next task in queue but do not wait for the next one
      */
     void execute() {
-        if(tasks_.empty())
-            return;
         {
             std::unique_lock<std::mutex> lock(mutex_);
+            if(tasks_.empty())
+                return;
             // Copy task locally and remove from the queue. This is done within
             // its own scope so that the task object is destructed immediately
             // after running the task.  This is useful in the event that the
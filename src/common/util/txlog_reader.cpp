@@ -0,0 +1,96 @@
+/*******************************************************************************
+ * Copyright 2024 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#include "txlog_reader.h"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace util {
+namespace {
+const char version_tag[] = "scv_tr_format_version ";
+const char name_tag[] = "attribute_name (ID ";
+
+inline bool starts_with(std::string const& str, char const* prefix, size_t len) {
+    return str.compare(0, len, prefix) == 0;
+}
+// parses an unsigned decimal number at pos and advances pos behind it
+bool parse_number(std::string const& str, size_t& pos, uint64_t& value) {
+    auto start = pos;
+    value = 0;
+    while(pos < str.size() && str[pos] >= '0' && str[pos] <= '9')
+        value = value * 10 + (str[pos++] - '0');
+    return pos > start;
+}
+} // namespace
+
+bool txlog_reader::next(std::string& line) {
+    while(std::getline(in, line)) {
+        ++line_no;
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if(starts_with(line, version_tag, sizeof(version_tag) - 1)) {
+            version = std::strtoul(line.c_str() + sizeof(version_tag) - 1, nullptr, 10);
+            if(version < 1 || version > 2)
+                throw std::runtime_error("unsupported txlog format version " + std::to_string(version));
+            continue;
+        }
+        if(version < 2)
+            return true;
+        if(starts_with(line, name_tag, sizeof(name_tag) - 1)) {
+            // attribute_name (ID <id>, name "<name>", type "<type>")
+            size_t pos = sizeof(name_tag) - 1;
+            uint64_t id;
+            auto name_start = line.find(", name \"");
+            auto type_start = line.rfind("\", type \"");
+            if(!parse_number(line, pos, id) || name_start != pos || type_start == std::string::npos ||
+               type_start < name_start + 8 || line.size() < type_start + 11 || line.compare(line.size() - 2, 2, "\")"))
+                throw std::runtime_error("malformed attribute_name record in line " + std::to_string(line_no));
+            auto& entry = names[id];
+            entry.name = line.substr(name_start + 8, type_start - name_start - 8);
+            entry.type = line.substr(type_start + 9, line.size() - type_start - 11);
+            continue;
+        }
+        if(line.size() > 2 && line[0] == 'r' && line[1] == ' ') {
+            // r <tx id> <name id> <value>
+            size_t pos = 2;
+            uint64_t tx_id, name_id;
+            if(!parse_number(line, pos, tx_id) || pos >= line.size() || line[pos++] != ' ' ||
+               !parse_number(line, pos, name_id) || pos >= line.size() || line[pos++] != ' ')
+                throw std::runtime_error("malformed attribute record in line " + std::to_string(line_no));
+            auto it = names.find(name_id);
+            if(it == names.end())
+                throw std::runtime_error("unknown attribute name ID " + std::to_string(name_id) + " in line " +
+                                         std::to_string(line_no));
+            line = "tx_record_attribute " + std::to_string(tx_id) + " \"" + it->second.name + "\" " + it->second.type +
+                   " = " + line.substr(pos);
+        }
+        return true;
+    }
+    return false;
+}
+
+size_t txlog_reader::convert(std::istream& in, std::ostream& out) {
+    txlog_reader reader(in);
+    std::string line;
+    size_t count = 0;
+    while(reader.next(line)) {
+        out << line << '\n';
+        ++count;
+    }
+    return count;
+}
+} // namespace util
@@ -0,0 +1,88 @@
+/*******************************************************************************
+ * Copyright 2024 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _COMMON_UTIL_TXLOG_READER_H_
+#define _COMMON_UTIL_TXLOG_READER_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+namespace util {
+/**
+ * @class txlog_reader
+ * @brief line reader of the SCV text transaction format (txlog) as written by the SCC text databases
+ *
+ * The reader returns the records of a file in the version 1 format understood by the SCV text readers (e.g.
+ * SCViewer). Files of version 2 start with 'scv_tr_format_version 2' and use an attribute name dictionary:
+ *
+ *     attribute_name (ID <name id>, name "<name>", type "<data type>")
+ *     r <tx id> <name id> <value>
+ *
+ * The attribute_name records are consumed and each 'r' record is expanded into
+ *
+ *     tx_record_attribute <tx id> "<name>" <data type> = <value>
+ *
+ * All other records are passed unchanged, files of version 1 are returned as they are.
+ */
+class txlog_reader {
+public:
+    /**
+     * @fn  txlog_reader(std::istream&)
+     * @brief creates a reader of the given stream, the stream needs to provide the uncompressed text
+     *
+     * @param in the input stream
+     */
+    explicit txlog_reader(std::istream& in)
+    : in(in) {}
+    /**
+     * @fn bool next(std::string&)
+     * @brief reads the next record in the version 1 format. Throws a std::runtime_error if the input is malformed,
+     * refers to an unknown attribute name or has an unsupported version
+     *
+     * @param line the record without the trailing newline
+     * @return false at the end of the input
+     */
+    bool next(std::string& line);
+    /**
+     * @fn unsigned get_version()const
+     * @brief returns the format version of the input, valid after the first record has been read
+     */
+    unsigned get_version() const { return version; }
+    /**
+     * @fn size_t convert(std::istream&, std::ostream&)
+     * @brief converts a complete input into the version 1 format
+     *
+     * @param in the input
+     * @param out the output
+     * @return the number of records written
+     */
+    static size_t convert(std::istream& in, std::ostream& out);
+
+private:
+    struct attribute_name {
+        std::string name;
+        std::string type;
+    };
+    std::istream& in;
+    unsigned version{1};
+    uint64_t line_no{0};
+    std::unordered_map<uint64_t, attribute_name> names;
+};
+} // namespace util
+#endif /* _COMMON_UTIL_TXLOG_READER_H_ */
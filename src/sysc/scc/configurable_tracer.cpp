@@ -16,6 +16,7 @@
 
 #include "configurable_tracer.h"
 #include "traceable.h"
+#include <cstring>
 #include <unordered_set>
 
 using namespace sc_core;
@@ -48,29 +49,30 @@ scc::configurable_tracer::~configurable_tracer() {
 void configurable_tracer::descend(const sc_core::sc_object* obj, bool trace) {
     if(obj == this)
         return;
-    const std::string kind = obj->kind();
-    if((types_to_trace & trace_types::SIGNALS) == trace_types::SIGNALS && kind == "tlm_signal") {
+    const char* kind = obj->kind();
+    if((types_to_trace & trace_types::SIGNALS) == trace_types::SIGNALS && strcmp(kind, "tlm_signal") == 0) {
         if(trace)
             obj->trace(trf);
         return;
-    } else if(kind == "sc_vector") {
+    } else if(strcmp(kind, "sc_vector") == 0) {
         if(trace)
             for(auto o : obj->get_child_objects())
                 descend(o, trace);
         return;
-    } else if(kind == "sc_module") {
+    } else if(strcmp(kind, "sc_module") == 0) {
         auto trace_enable = get_trace_enabled(obj, default_trace_enable);
         if(trace_enable)
             obj->trace(trf);
         for(auto o : obj->get_child_objects())
             descend(o, trace_enable);
-    } else if(kind == "sc_variable") {
+    } else if(strcmp(kind, "sc_variable") == 0) {
         if(trace && (types_to_trace & trace_types::VARIABLES) == trace_types::VARIABLES)
             obj->trace(trf);
-    } else if(kind == "sc_signal" || kind == "sc_clock" || kind == "sc_buffer" || kind == "sc_signal_rv") {
+    } else if(strcmp(kind, "sc_signal") == 0 || strcmp(kind, "sc_clock") == 0 || strcmp(kind, "sc_buffer") == 0 ||
+              strcmp(kind, "sc_signal_rv") == 0) {
         if(trace && (types_to_trace & trace_types::SIGNALS) == trace_types::SIGNALS)
             try_trace(trf, obj, types_to_trace);
-    } else if(kind == "sc_in" || kind == "sc_out" || kind == "sc_inout") {
+    } else if(strcmp(kind, "sc_in") == 0 || strcmp(kind, "sc_out") == 0 || strcmp(kind, "sc_inout") == 0) {
         if(trace && (types_to_trace & trace_types::PORTS) == trace_types::PORTS)
             try_trace(trf, obj, types_to_trace);
     } else if(const auto* tr = dynamic_cast<const scc::traceable*>(obj)) {
@@ -0,0 +1,209 @@
+/*******************************************************************************
+ * Copyright 2024 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#include "flight_recorder.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#ifndef _WIN32
+#include <pthread.h>
+#include <thread>
+#endif
+
+namespace scc {
+namespace {
+const std::array<char const*, 3> cmd2char{{"READ", "WRITE", "IGNORE"}};
+const std::array<char const*, 7> resp2char{
+    {"OK", "INCOMPLETE", "GENERIC_ERROR", "ADDRESS_ERROR", "COMMAND_ERROR", "BURST_ERROR", "BYTE_ENABLE_ERROR"}};
+const std::array<char const*, 5> phase2char{{"UNINITIALIZED_PHASE", "BEGIN_REQ", "END_REQ", "BEGIN_RESP", "END_RESP"}};
+const std::array<char const*, 4> severity2char{{"INFO", "WARNING", "ERROR", "FATAL"}};
+const std::array<char const*, 3> kind2char{{"b_transport", "nb_transport_fw", "nb_transport_bw"}};
+
+// the txlog format is line based and has no escape sequences, so quotes and line breaks are replaced
+inline std::string escape(std::string str) {
+    for(auto& c : str)
+        if(c == '"')
+            c = '\'';
+        else if(c == '\n' || c == '\r')
+            c = ' ';
+    return str;
+}
+} // namespace
+
+std::atomic<bool> flight_recorder::active{false};
+std::atomic<bool> flight_recorder::dump_requested{false};
+
+flight_recorder& flight_recorder::get() {
+    static flight_recorder inst;
+    return inst;
+}
+
+void flight_recorder::enable(size_t entries, std::string const& file_name) {
+    active.store(false);
+    this->file_name = file_name;
+    if(!entries) {
+        ring.reset();
+        mask = 0;
+        return;
+    }
+    size_t size = 1;
+    while(size < entries)
+        size <<= 1;
+    ring.reset(new entry[size]);
+    mask = size - 1;
+    head.store(0);
+    active.store(true);
+}
+
+unsigned flight_recorder::register_source(std::string const& name) {
+    std::lock_guard<std::mutex> lock(sources_mtx);
+    sources.push_back(name);
+    return sources.size() - 1;
+}
+
+void flight_recorder::record_tx(kind k, unsigned source, unsigned cmd, uint64_t address, unsigned length,
+                                int response, unsigned phase, uint64_t start, uint64_t end) {
+    uint64_t idx;
+    auto& e = acquire(idx);
+    e.start = start;
+    e.end = end;
+    e.address = address;
+    e.length = length;
+    e.source = source;
+    e.kind = k;
+    e.cmd = cmd;
+    e.phase = phase;
+    e.response = response;
+    commit(e, idx);
+}
+
+void flight_recorder::record_log(sc_core::sc_severity severity, char const* msg_type, char const* msg,
+                                 uint64_t time) {
+    uint64_t idx;
+    auto& e = acquire(idx);
+    e.start = e.end = time;
+    e.kind = LOG;
+    e.cmd = severity;
+    auto len = msg_type ? std::min(strlen(msg_type), sizeof(e.text) - 3) : 0;
+    if(len) {
+        memcpy(e.text, msg_type, len);
+        memcpy(e.text + len, ": ", 2);
+        len += 2;
+    }
+    if(msg)
+        strncpy(e.text + len, msg, sizeof(e.text) - len - 1);
+    else
+        e.text[len] = 0;
+    e.text[sizeof(e.text) - 1] = 0;
+    commit(e, idx);
+}
+
+bool flight_recorder::dump() { return dump(file_name); }
+
+bool flight_recorder::dump(std::string const& file_name) {
+    if(!ring)
+        return false;
+    std::vector<snapshot> records;
+    auto h = head.load(std::memory_order_acquire);
+    auto count = std::min<uint64_t>(h, mask + 1);
+    records.reserve(count);
+    for(auto idx = h - count; idx < h; ++idx) {
+        auto& e = ring[idx & mask];
+        auto seq = e.seq.load(std::memory_order_acquire);
+        if(seq != 2 * idx + 2)
+            continue;
+        snapshot s{e.start, e.end, e.address, e.length, e.source, e.kind, e.cmd, e.phase, e.response,
+                   e.kind == LOG ? std::string(e.text, strnlen(e.text, sizeof(e.text))) : std::string()};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(e.seq.load(std::memory_order_relaxed) == seq)
+            records.push_back(std::move(s));
+    }
+    std::stable_sort(records.begin(), records.end(),
+                     [](snapshot const& a, snapshot const& b) -> bool { return a.start < b.start; });
+    std::ofstream out(file_name);
+    if(!out.is_open())
+        return false;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(sources_mtx);
+        names = sources;
+    }
+    // stream ids are the source ids + 1, the log stream uses the last id. Generators are numbered per stream
+    auto id = 1UL;
+    auto gen_base = names.size() + 2;
+    for(auto& name : names) {
+        out << fmt::format("scv_tr_stream (ID {}, name \"{}\", kind \"TLM\")\n", id, escape(name));
+        for(auto i = 0U; i < kind2char.size(); ++i)
+            out << fmt::format("scv_tr_generator (ID {}, name \"{}\", scv_tr_stream {},\n)\n",
+                               gen_base + (id - 1) * 4 + i, kind2char[i], id);
+        ++id;
+    }
+    out << fmt::format("scv_tr_stream (ID {}, name \"log\", kind \"LOG\")\n", id);
+    for(auto i = 0U; i < severity2char.size(); ++i)
+        out << fmt::format("scv_tr_generator (ID {}, name \"{}\", scv_tr_stream {},\n)\n",
+                           gen_base + (id - 1) * 4 + i, severity2char[i], id);
+    // transactions are numbered after the generators
+    auto tx_id = gen_base + (names.size() + 1) * 4;
+    for(auto& r : records) {
+        if(r.kind == LOG) {
+            auto gen = gen_base + names.size() * 4 + std::min<unsigned>(r.cmd, severity2char.size() - 1);
+            out << fmt::format("tx_begin {} {} {} ps\n", tx_id, gen, r.start);
+            out << fmt::format("tx_record_attribute {} \"message\" STRING = \"{}\"\n", tx_id, escape(r.text));
+            out << fmt::format("tx_end {} {} {} ps\n", tx_id, gen, r.end);
+        } else if(r.source < names.size()) {
+            auto gen = gen_base + r.source * 4 + r.kind;
+            out << fmt::format("tx_begin {} {} {} ps\n", tx_id, gen, r.start);
+            out << fmt::format("tx_record_attribute {} \"trans.cmd\" STRING = \"{}\"\n", tx_id,
+                               r.cmd < cmd2char.size() ? cmd2char[r.cmd] : "UNKNOWN");
+            out << fmt::format("tx_record_attribute {} \"trans.address\" UNSIGNED = {}\n", tx_id, r.address);
+            out << fmt::format("tx_record_attribute {} \"trans.data_length\" UNSIGNED = {}\n", tx_id, r.length);
+            auto resp = 1 - r.response;
+            out << fmt::format("tx_record_attribute {} \"trans.response\" STRING = \"{}\"\n", tx_id,
+                               resp >= 0 && resp < static_cast<int>(resp2char.size()) ? resp2char[resp] : "UNKNOWN");
+            if(r.kind != B_TRANSPORT)
+                out << fmt::format("tx_record_attribute {} \"phase\" STRING = \"{}\"\n", tx_id,
+                                   r.phase < phase2char.size() ? phase2char[r.phase] : "UNKNOWN");
+            out << fmt::format("tx_end {} {} {} ps\n", tx_id, gen, r.end);
+        }
+        ++tx_id;
+    }
+    return out.good();
+}
+
+void flight_recorder::signal_handler(int) { dump_requested.store(true, std::memory_order_relaxed); }
+
+#ifndef _WIN32
+void flight_recorder::dump_on_signal(int signum) {
+    // the signal is blocked in the calling thread and the threads created later, a helper thread accepts it
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, signum);
+    if(pthread_sigmask(SIG_BLOCK, &set, nullptr)) {
+        std::signal(signum, &flight_recorder::signal_handler);
+        return;
+    }
+    std::thread([this, set]() {
+        int sig;
+        while(sigwait(&set, &sig) == 0)
+            dump();
+    }).detach();
+}
+#else
+void flight_recorder::dump_on_signal(int signum) { std::signal(signum, &flight_recorder::signal_handler); }
+#endif
+} // namespace scc
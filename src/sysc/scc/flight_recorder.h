@@ -0,0 +1,178 @@
+/*******************************************************************************
+ * Copyright 2024 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _SCC_FLIGHT_RECORDER_H_
+#define _SCC_FLIGHT_RECORDER_H_
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sysc/utils/sc_report.h>
+#include <vector>
+
+/** \ingroup scc-sysc
+ *  @{
+ */
+/**@{*/
+//! @brief SCC SystemC utilities
+namespace scc {
+/**
+ * @class flight_recorder
+ * @brief keeps the last transactions and log messages in a fixed size ring buffer in memory
+ *
+ * The TLM recorders and the SCC report handler write compact records into the ring buffer if the flight recorder is
+ * enabled. The buffer is written as SCV text database (txlog) if an error or fatal report is raised, if a signal
+ * registered with dump_on_signal() is received or if dump() is called. Writing a record does not lock, concurrent
+ * writers reserve their slot using an atomic counter.
+ */
+class flight_recorder {
+public:
+    //! the kind of a record
+    enum kind : uint8_t { B_TRANSPORT, NB_TRANSPORT_FW, NB_TRANSPORT_BW, LOG };
+    /**
+     * @fn flight_recorder& get()
+     * @brief get the flight recorder instance
+     *
+     * @return the flight recorder
+     */
+    static flight_recorder& get();
+    /**
+     * @fn bool enabled()
+     * @brief check if the flight recorder records, this is the cheap check to be done before recording
+     *
+     * @return true if the ring buffer is allocated
+     */
+    static inline bool enabled() { return active.load(std::memory_order_relaxed); }
+    /**
+     * @fn void enable(size_t, const std::string&)
+     * @brief allocates the ring buffer and starts recording, needs to be called before the simulation starts
+     *
+     * @param entries the number of records being kept, it is rounded up to the next power of 2. 0 disables recording
+     * @param file_name the name of the txlog file written by dump()
+     */
+    void enable(size_t entries, std::string const& file_name = "flight_recorder.txlog");
+    /**
+     * @fn unsigned register_source(const std::string&)
+     * @brief registers the name of a record source like a TLM recorder
+     *
+     * @param name the name of the source
+     * @return the id being used when recording
+     */
+    unsigned register_source(std::string const& name);
+    /**
+     * @fn void record_tx(kind, unsigned, unsigned, uint64_t, unsigned, int, unsigned, uint64_t, uint64_t)
+     * @brief records a TLM transaction
+     *
+     * @param k the kind of the access
+     * @param source the id of the source returned by register_source()
+     * @param cmd the tlm_command of the payload
+     * @param address the address of the payload
+     * @param length the data length of the payload
+     * @param response the tlm_response_status of the payload
+     * @param phase the phase of a non-blocking access
+     * @param start the start time of the access in time resolution units
+     * @param end the end time of the access in time resolution units
+     */
+    void record_tx(kind k, unsigned source, unsigned cmd, uint64_t address, unsigned length, int response,
+                   unsigned phase, uint64_t start, uint64_t end);
+    /**
+     * @fn void record_log(sc_core::sc_severity, const char*, const char*, uint64_t)
+     * @brief records a log message, the text is truncated to the size of a record
+     *
+     * @param severity the severity of the report
+     * @param msg_type the message type (usually the originator)
+     * @param msg the message text
+     * @param time the time of the report in time resolution units
+     */
+    void record_log(sc_core::sc_severity severity, char const* msg_type, char const* msg, uint64_t time);
+    /**
+     * @fn bool dump()
+     * @brief writes the content of the ring buffer to the file given in enable()
+     *
+     * @return true if the file could be written
+     */
+    bool dump();
+    /**
+     * @fn bool dump(const std::string&)
+     * @brief writes the content of the ring buffer as SCV text database
+     *
+     * @param file_name the name of the file
+     * @return true if the file could be written
+     */
+    bool dump(std::string const& file_name);
+    /**
+     * @fn void dump_on_signal(int)
+     * @brief dumps the ring buffer whenever the given signal is received. On POSIX systems the signal is blocked and
+     * accepted by a helper thread using sigwait() which writes the dump, so it is written even if the simulation does
+     * not record anything anymore. The signal is only blocked in the calling thread and threads created afterwards, so
+     * this needs to be called early, e.g. in sc_main() before further threads are started. On other systems a signal
+     * handler requests the dump which is then done with the next record being written
+     *
+     * @param signum the signal number, e.g. SIGUSR1
+     */
+    void dump_on_signal(int signum);
+
+private:
+    flight_recorder() = default;
+    //! a record in the ring buffer, seq is odd while the record is written
+    struct entry {
+        std::atomic<uint64_t> seq{0};
+        uint64_t start{0}, end{0};
+        uint64_t address{0};
+        uint32_t length{0};
+        uint32_t source{0};
+        uint8_t kind{0}, cmd{0}, phase{0};
+        int8_t response{0};
+        char text[84];
+    };
+    //! the copy of a valid record taken when dumping
+    struct snapshot {
+        uint64_t start, end, address;
+        uint32_t length, source;
+        uint8_t kind, cmd, phase;
+        int8_t response;
+        std::string text;
+    };
+    inline entry& acquire(uint64_t& idx) {
+        if(dump_requested.load(std::memory_order_relaxed)) {
+            dump_requested.store(false, std::memory_order_relaxed);
+            dump();
+        }
+        idx = head.fetch_add(1, std::memory_order_relaxed);
+        auto& e = ring[idx & mask];
+        e.seq.store(2 * idx + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return e;
+    }
+    inline void commit(entry& e, uint64_t idx) { e.seq.store(2 * idx + 2, std::memory_order_release); }
+
+    static void signal_handler(int);
+
+    static std::atomic<bool> active;
+    static std::atomic<bool> dump_requested;
+    std::unique_ptr<entry[]> ring;
+    uint64_t mask{0};
+    std::atomic<uint64_t> head{0};
+    std::string file_name;
+    std::vector<std::string> sources;
+    std::mutex sources_mtx;
+};
+} // namespace scc
+/** @} */ // end of scc-sysc
+#endif /* _SCC_FLIGHT_RECORDER_H_ */
@@ -16,9 +16,17 @@
 
 #include "fst_trace.hh"
 #include "fstapi.h"
+#include "trace/change_detector.hh"
+#include "trace/pre_trigger_buffer.hh"
+#include "trace/scope_trie.hh"
+#include "trace/segment_manifest.hh"
 #include "trace/types.hh"
 #include "utilities.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <deque>
@@ -27,6 +35,7 @@
 #include <map>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <util/ities.h>
 #include <vector>
@@ -44,6 +53,262 @@ inline unsigned get_bits(const char** literals) {
         continue;
     return scc::ilog2(nliterals);
 }
+/**
+ * @class fst_emitter
+ * @brief forwards value changes to the FST writer, either directly or via a background thread
+ *
+ * In background mode the simulation thread only appends fixed size records to a lock-free single-producer/
+ * single-consumer ring buffer. A worker thread drains the ring and calls the FST writer API so that the
+ * value change encoding and the block compression do not run in the simulation thread. String values are
+ * stored inline in the slots following their record.
+ */
+class fst_emitter {
+    enum kind : uint8_t { TIME, VAL32, VAL64, REAL, STRING };
+    struct record {
+        kind k;
+        uint32_t bits;
+        fstHandle hndl;
+        uint64_t value;
+    };
+
+public:
+    //! the default number of records in the ring buffer
+    static const size_t default_capacity = 1 << 16;
+    /**
+     * @fn  fst_emitter(void*, bool, unsigned)
+     * @brief constructor
+     *
+     * @param fst the FST writer context
+     * @param background if true the FST writer API is called from a separate thread
+     * @param max_bits the widest signal being emitted, used to size the ring buffer
+     */
+    fst_emitter(void* fst, bool background, unsigned max_bits)
+    : fst(fst) {
+        if(background) {
+            auto min_capacity = 4 * slots(max_bits);
+            capacity = default_capacity;
+            while(capacity < min_capacity)
+                capacity <<= 1;
+            ring.reset(new record[capacity]);
+            worker = std::thread([this]() { run(); });
+        }
+    }
+
+    fst_emitter(fst_emitter const&) = delete;
+
+    fst_emitter& operator=(fst_emitter const&) = delete;
+    /**
+     * @fn  ~fst_emitter()
+     * @brief destructor, drains the ring buffer and stops the worker thread
+     */
+    ~fst_emitter() {
+        if(worker.joinable()) {
+            finished.store(true, std::memory_order_release);
+            worker.join();
+        }
+    }
+
+    inline void emit_time(uint64_t time_stamp) {
+        if(diverted)
+            pre_trigger.begin(time_stamp);
+        else if(ring)
+            push(TIME, 0, 0, time_stamp);
+        else
+            fstWriterEmitTimeChange(fst, time_stamp);
+    }
+
+    inline void emit32(fstHandle hndl, unsigned bits, uint32_t val) {
+        bytes += sizeof(val);
+        if(diverted)
+            keep(record{VAL32, bits, hndl, val});
+        else if(ring)
+            push(VAL32, bits, hndl, val);
+        else
+            fstWriterEmitValueChange32(fst, hndl, bits, val);
+    }
+
+    inline void emit64(fstHandle hndl, unsigned bits, uint64_t val) {
+        bytes += sizeof(val);
+        if(diverted)
+            keep(record{VAL64, bits, hndl, val});
+        else if(ring)
+            push(VAL64, bits, hndl, val);
+        else
+            fstWriterEmitValueChange64(fst, hndl, bits, val);
+    }
+
+    inline void emit(fstHandle hndl, double val) {
+        bytes += sizeof(val);
+        if(diverted || ring) {
+            uint64_t raw;
+            memcpy(&raw, &val, sizeof(raw));
+            if(diverted)
+                keep(record{REAL, 64, hndl, raw});
+            else
+                push(REAL, 64, hndl, raw);
+        } else
+            fstWriterEmitValueChange(fst, hndl, &val);
+    }
+
+    inline void emit(fstHandle hndl, unsigned len, char const* val) {
+        bytes += len;
+        if(diverted)
+            keep(record{STRING, len, hndl, 0}, val);
+        else if(ring) {
+            auto n = slots(len);
+            auto h = reserve(n + 1);
+            ring[h & (capacity - 1)] = record{STRING, len, hndl, 0};
+            for(size_t i = 0; i < n; ++i, val += sizeof(record)) {
+                auto sz = len - i * sizeof(record);
+                memcpy(&ring[(h + 1 + i) & (capacity - 1)], val, sz < sizeof(record) ? sz : sizeof(record));
+            }
+            head.store(h + n + 1, std::memory_order_release);
+        } else
+            fstWriterEmitValueChange(fst, hndl, val);
+    }
+    /**
+     * @fn void set_pre_trigger(uint64_t)
+     * @brief sets the length of the window of value changes being kept while diverted
+     *
+     * @param depth the length of the window in ps, 0 disables the buffering
+     */
+    void set_pre_trigger(uint64_t depth) { pre_trigger.set_depth(depth); }
+    /**
+     * @fn void divert(bool)
+     * @brief if enabled the value changes are kept in the pre-trigger buffer, when disabled the kept value changes
+     * are emitted
+     *
+     * @param enable the diversion state
+     */
+    void divert(bool enable) {
+        if(diverted && !enable) {
+            diverted = false;
+            pre_trigger.flush([this](uint64_t ts) { emit_time(ts); },
+                              [this](fstHandle, char const* data, size_t len) { replay(data, len); });
+        } else
+            diverted = enable;
+    }
+    /**
+     * @fn void expire(uint64_t)
+     * @brief drops the diverted value changes being older than the pre-trigger window
+     *
+     * @param time_stamp the current time stamp
+     */
+    void expire(uint64_t time_stamp) { pre_trigger.expire(time_stamp); }
+    //! number of times the simulation thread had to wait for free space in the ring
+    uint64_t stalls{0};
+    //! the (uncompressed) size of the emitted values in bytes
+    uint64_t bytes{0};
+
+private:
+    static inline size_t slots(size_t len) { return (len + sizeof(record) - 1) / sizeof(record); }
+
+    inline void keep(record const& r, char const* str = nullptr) {
+        scratch.assign(reinterpret_cast<char const*>(&r), sizeof(record));
+        if(str)
+            scratch.append(str, r.bits);
+        pre_trigger.add(r.hndl, scratch.data(), scratch.size());
+    }
+
+    void replay(char const* data, size_t len) {
+        record r;
+        memcpy(&r, data, sizeof(record));
+        switch(r.k) {
+        case VAL32:
+            emit32(r.hndl, r.bits, static_cast<uint32_t>(r.value));
+            break;
+        case VAL64:
+            emit64(r.hndl, r.bits, r.value);
+            break;
+        case REAL: {
+            double val;
+            memcpy(&val, &r.value, sizeof(val));
+            emit(r.hndl, val);
+        } break;
+        case STRING:
+            emit(r.hndl, r.bits, data + sizeof(record));
+            break;
+        default:
+            break;
+        }
+    }
+
+    inline size_t reserve(size_t n) {
+        auto h = head.load(std::memory_order_relaxed);
+        if(h + n - cached_tail > capacity) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if(h + n - cached_tail > capacity) {
+                stalls++;
+                while(h + n - cached_tail > capacity) {
+                    std::this_thread::yield();
+                    cached_tail = tail.load(std::memory_order_acquire);
+                }
+            }
+        }
+        return h;
+    }
+
+    inline void push(kind k, unsigned bits, fstHandle hndl, uint64_t val) {
+        auto h = reserve(1);
+        ring[h & (capacity - 1)] = record{k, bits, hndl, val};
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    void run() {
+        std::vector<char> buf;
+        size_t t = tail.load(std::memory_order_relaxed);
+        while(true) {
+            auto h = head.load(std::memory_order_acquire);
+            if(t == h) {
+                if(finished.load(std::memory_order_acquire) && t == head.load(std::memory_order_acquire))
+                    break;
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                continue;
+            }
+            while(t != h) {
+                auto const& r = ring[t & (capacity - 1)];
+                ++t;
+                switch(r.k) {
+                case TIME:
+                    fstWriterEmitTimeChange(fst, r.value);
+                    break;
+                case VAL32:
+                    fstWriterEmitValueChange32(fst, r.hndl, r.bits, static_cast<uint32_t>(r.value));
+                    break;
+                case VAL64:
+                    fstWriterEmitValueChange64(fst, r.hndl, r.bits, r.value);
+                    break;
+                case REAL: {
+                    double val;
+                    memcpy(&val, &r.value, sizeof(val));
+                    fstWriterEmitValueChange(fst, r.hndl, &val);
+                } break;
+                case STRING: {
+                    auto n = slots(r.bits);
+                    buf.resize(n * sizeof(record) + 1);
+                    for(size_t i = 0; i < n; ++i, ++t)
+                        memcpy(&buf[i * sizeof(record)], &ring[t & (capacity - 1)], sizeof(record));
+                    buf[r.bits] = 0;
+                    fstWriterEmitValueChange(fst, r.hndl, buf.data());
+                } break;
+                }
+            }
+            tail.store(t, std::memory_order_release);
+        }
+    }
+
+    void* const fst;
+    size_t capacity{0};
+    std::unique_ptr<record[]> ring;
+    size_t cached_tail{0};
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    std::atomic<bool> finished{false};
+    std::thread worker;
+    bool diverted{false};
+    pre_trigger_buffer<fstHandle> pre_trigger;
+    std::string scratch;
+};
 
 struct fst_trace {
 
@@ -52,9 +317,9 @@ struct fst_trace {
     , bits{bits}
     , type{type} {}
 
-    virtual void record(void* m_fst) = 0;
+    virtual void record(fst_emitter& os) = 0;
 
-    virtual void update_and_record(void* m_fst) = 0;
+    virtual void update_and_record(fst_emitter& os) = 0;
 
     virtual uintptr_t get_hash() = 0;
 
@@ -81,9 +346,9 @@ struct fst_trace_enum : public fst_trace {
 
     inline void update() { old_val = act_val; }
 
-    void record(void* os) override { fstWriterEmitValueChange64(os, fst_hndl, bits, old_val); }
+    void record(fst_emitter& os) override { os.emit64(fst_hndl, bits, old_val); }
 
-    void update_and_record(void* os) override {
+    void update_and_record(fst_emitter& os) override {
         update();
         record(os);
     };
@@ -105,116 +370,113 @@ template <typename T, typename OT = T> struct fst_trace_t : public fst_trace {
 
     inline void update() { old_val = act_val; }
 
-    void record(void* m_fst) override;
+    void record(fst_emitter& os) override;
 
-    void update_and_record(void* m_fst) override {
+    void update_and_record(fst_emitter& os) override {
         update();
-        record(m_fst);
+        record(os);
     };
 
     OT old_val;
     const T& act_val;
 };
 
-template <typename T, typename OT> inline void fst_trace_t<T, OT>::record(void* m_fst) {
+template <typename T, typename OT> inline void fst_trace_t<T, OT>::record(fst_emitter& os) {
     if(sizeof(T) <= 4)
-        fstWriterEmitValueChange32(m_fst, fst_hndl, bits, old_val);
+        os.emit32(fst_hndl, bits, old_val);
     else
-        fstWriterEmitValueChange64(m_fst, fst_hndl, bits, old_val);
+        os.emit64(fst_hndl, bits, old_val);
 }
-template <> void fst_trace_t<bool, bool>::record(void* m_fst) {
-    fstWriterEmitValueChange(m_fst, fst_hndl, old_val ? "1" : "0");
+template <> void fst_trace_t<bool, bool>::record(fst_emitter& os) {
+    os.emit(fst_hndl, bits, old_val ? "1" : "0");
 }
-template <> void fst_trace_t<sc_dt::sc_bit, sc_dt::sc_bit>::record(void* m_fst) {
-    fstWriterEmitValueChange(m_fst, fst_hndl, old_val ? "1" : "0");
+template <> void fst_trace_t<sc_dt::sc_bit, sc_dt::sc_bit>::record(fst_emitter& os) {
+    os.emit(fst_hndl, bits, old_val ? "1" : "0");
 }
-template <> void fst_trace_t<sc_dt::sc_logic, sc_dt::sc_logic>::record(void* m_fst) {
+template <> void fst_trace_t<sc_dt::sc_logic, sc_dt::sc_logic>::record(fst_emitter& os) {
     char buf[2] = {0, 0};
     buf[0] = old_val.to_char();
-    fstWriterEmitValueChange(m_fst, fst_hndl, buf);
+    os.emit(fst_hndl, bits, buf);
 }
-template <> void fst_trace_t<float, float>::record(void* m_fst) {
+template <> void fst_trace_t<float, float>::record(fst_emitter& os) {
     double val = old_val;
-    fstWriterEmitValueChange(m_fst, fst_hndl, &val);
+    os.emit(fst_hndl, val);
 }
-template <> void fst_trace_t<double, double>::record(void* m_fst) {
-    fstWriterEmitValueChange(m_fst, fst_hndl, &old_val);
+template <> void fst_trace_t<double, double>::record(fst_emitter& os) {
+    os.emit(fst_hndl, old_val);
 }
-template <> void fst_trace_t<sc_dt::sc_int_base, sc_dt::sc_int_base>::record(void* m_fst) {
+template <> void fst_trace_t<sc_dt::sc_int_base, sc_dt::sc_int_base>::record(fst_emitter& os) {
     static std::vector<char> rawdata(get_buffer_size(old_val.length()));
     char* rawdata_ptr = &rawdata[0];
     for(int bitindex = old_val.length() - 1; bitindex >= 0; --bitindex) {
         *rawdata_ptr++ = '0' + old_val[bitindex].value();
     }
-    fstWriterEmitValueChange(m_fst, fst_hndl, &rawdata[0]);
+    os.emit(fst_hndl, bits, &rawdata[0]);
 }
-template <> void fst_trace_t<sc_dt::sc_uint_base, sc_dt::sc_uint_base>::record(void* m_fst) {
+template <> void fst_trace_t<sc_dt::sc_uint_base, sc_dt::sc_uint_base>::record(fst_emitter& os) {
     static std::vector<char> rawdata(get_buffer_size(old_val.length()));
     char* rawdata_ptr = &rawdata[0];
     for(int bitindex = old_val.length() - 1; bitindex >= 0; --bitindex) {
         *rawdata_ptr++ = '0' + old_val[bitindex].value();
     }
-    fstWriterEmitValueChange(m_fst, fst_hndl, &rawdata[0]);
+    os.emit(fst_hndl, bits, &rawdata[0]);
 }
-template <> void fst_trace_t<sc_dt::sc_signed, sc_dt::sc_signed>::record(void* m_fst) {
+template <> void fst_trace_t<sc_dt::sc_signed, sc_dt::sc_signed>::record(fst_emitter& os) {
     static std::vector<char> rawdata(get_buffer_size(old_val.length()));
     char* rawdata_ptr = &rawdata[0];
     for(int bitindex = old_val.length() - 1; bitindex >= 0; --bitindex) {
         *rawdata_ptr++ = '0' + old_val[bitindex].value();
     }
-    fstWriterEmitValueChange(m_fst, fst_hndl, &rawdata[0]);
+    os.emit(fst_hndl, bits, &rawdata[0]);
 }
-template <> void fst_trace_t<sc_dt::sc_unsigned, sc_dt::sc_unsigned>::record(void* m_fst) {
+template <> void fst_trace_t<sc_dt::sc_unsigned, sc_dt::sc_unsigned>::record(fst_emitter& os) {
     static std::vector<char> rawdata(get_buffer_size(old_val.length()));
     char* rawdata_ptr = &rawdata[0];
     for(int bitindex = old_val.length() - 1; bitindex >= 0; --bitindex) {
         *rawdata_ptr++ = '0' + old_val[bitindex].value();
     }
-    fstWriterEmitValueChange(m_fst, fst_hndl, &rawdata[0]);
+    os.emit(fst_hndl, bits, &rawdata[0]);
 }
-template <> void fst_trace_t<sc_dt::sc_fxval, sc_dt::sc_fxval>::record(void* m_fst) {
+template <> void fst_trace_t<sc_dt::sc_fxval, sc_dt::sc_fxval>::record(fst_emitter& os) {
     auto val = old_val.to_double();
-    fstWriterEmitValueChange(m_fst, fst_hndl, &val);
+    os.emit(fst_hndl, val);
 }
-template <> void fst_trace_t<sc_dt::sc_fxval_fast, sc_dt::sc_fxval_fast>::record(void* m_fst) {
+template <> void fst_trace_t<sc_dt::sc_fxval_fast, sc_dt::sc_fxval_fast>::record(fst_emitter& os) {
     auto val = old_val.to_double();
-    fstWriterEmitValueChange(m_fst, fst_hndl, &val);
+    os.emit(fst_hndl, val);
 }
-template <> void fst_trace_t<sc_dt::sc_fxnum, sc_dt::sc_fxval>::record(void* m_fst) {
-    fstWriterEmitValueChange32(m_fst, fst_hndl, 64, *reinterpret_cast<uint64_t*>(&old_val));
+template <> void fst_trace_t<sc_dt::sc_fxnum, sc_dt::sc_fxval>::record(fst_emitter& os) {
+    os.emit32(fst_hndl, 64, *reinterpret_cast<uint64_t*>(&old_val));
 }
-template <> void fst_trace_t<sc_dt::sc_fxnum_fast, sc_dt::sc_fxval_fast>::record(void* m_fst) {
+template <> void fst_trace_t<sc_dt::sc_fxnum_fast, sc_dt::sc_fxval_fast>::record(fst_emitter& os) {
     auto val = old_val.to_double();
-    fstWriterEmitValueChange(m_fst, fst_hndl, &val);
+    os.emit(fst_hndl, val);
 }
-template <> void fst_trace_t<sc_dt::sc_bv_base, sc_dt::sc_bv_base>::record(void* m_fst) {
+template <> void fst_trace_t<sc_dt::sc_bv_base, sc_dt::sc_bv_base>::record(fst_emitter& os) {
     auto str = old_val.to_string();
     auto* cstr = str.c_str();
     auto c = *cstr;
     if(c != '1')
         while(c == *(cstr + 1))
             cstr++;
-    fstWriterEmitValueChange(m_fst, fst_hndl, str.c_str());
+    os.emit(fst_hndl, bits, str.c_str());
 }
-template <> void fst_trace_t<sc_dt::sc_lv_base, sc_dt::sc_lv_base>::record(void* m_fst) {
+template <> void fst_trace_t<sc_dt::sc_lv_base, sc_dt::sc_lv_base>::record(fst_emitter& os) {
     auto str = old_val.to_string();
     auto* cstr = str.c_str();
     auto c = *cstr;
     if(c != '1')
         while(c == *(cstr + 1))
             cstr++;
-    fstWriterEmitValueChange(m_fst, fst_hndl, str.c_str());
+    os.emit(fst_hndl, bits, str.c_str());
 }
 } // namespace trace
 
-fst_trace_file::fst_trace_file(const char* name, std::function<bool()>& enable)
-: check_enabled(enable) {
-    std::stringstream ss;
-    ss << name << ".fst";
-    m_fst = fstWriterCreate(ss.str().c_str(), 1);
-    fstWriterSetPackType(m_fst, FST_WR_PT_LZ4);
-    fstWriterSetTimescale(m_fst, 12); // pico seconds 1*10-12
-    fstWriterSetFileType(m_fst, FST_FT_VERILOG);
+fst_trace_file::fst_trace_file(const char* name, std::function<bool()>& enable, bool background, fst_pack_type pack)
+: check_enabled(enable)
+, background(background)
+, pack(pack)
+, name(name) {
 #if defined(WITH_SC_TRACING_PHASE_CALLBACKS)
     // remove from hierarchy
     sc_object::detach();
@@ -225,11 +487,37 @@ fst_trace_file::fst_trace_file(const char* name, std::function<bool()>& enable)
 #endif
 }
 
+void* fst_trace_file::create_writer(std::string const& file_name) {
+    auto* fst = fstWriterCreate(file_name.c_str(), 1);
+    switch(pack) {
+    case fst_pack_type::ZLIB:
+        fstWriterSetPackType(fst, FST_WR_PT_ZLIB);
+        break;
+    case fst_pack_type::FASTLZ:
+        fstWriterSetPackType(fst, FST_WR_PT_FASTLZ);
+        break;
+    default:
+        fstWriterSetPackType(fst, FST_WR_PT_LZ4);
+        break;
+    }
+#ifdef FST_WRITER_PARALLEL
+    // compress and write the value change blocks in a separate thread
+    if(background)
+        fstWriterSetParallelMode(fst, 1);
+#endif
+    fstWriterSetTimescale(fst, 12); // pico seconds 1*10-12
+    fstWriterSetFileType(fst, FST_FT_VERILOG);
+    return fst;
+}
+
 fst_trace_file::~fst_trace_file() {
+    emitter.reset();
     if(m_fst) {
         fstWriterFlushContext(m_fst);
         fstWriterClose(m_fst);
     }
+    if(manifest)
+        manifest->close(sc_core::sc_time_stamp().value() / (1_ps).value());
     for(auto t:all_traces) delete t.trc;
 }
 
@@ -242,11 +530,13 @@ template <typename T, typename OT = T> bool changed(trace::fst_trace* trace) {
 }
 #define DECL_TRACE_METHOD_A(tp)                                                                                        \
     void fst_trace_file::trace(const tp& object, const std::string& name) {                                            \
-        all_traces.emplace_back(this, &changed<tp>, new trace::fst_trace_t<tp>(object, name));                         \
+        all_traces.emplace_back(this, &changed<tp>, new trace::fst_trace_t<tp>(object, name),                          \
+                                trace::shadow_size<tp>());                                                             \
     }
 #define DECL_TRACE_METHOD_B(tp)                                                                                        \
     void fst_trace_file::trace(const tp& object, const std::string& name, int width) {                                 \
-        all_traces.emplace_back(this, &changed<tp>, new trace::fst_trace_t<tp>(object, name));                         \
+        all_traces.emplace_back(this, &changed<tp>, new trace::fst_trace_t<tp>(object, name),                          \
+                                trace::shadow_size<tp>());                                                             \
     }
 #define DECL_TRACE_METHOD_C(tp, tpo)                                                                                   \
     void fst_trace_file::trace(const tp& object, const std::string& name) {                                            \
@@ -361,47 +651,43 @@ bool fst_trace_file::trace_entry::notify() {
 
 void fst_trace_file::write_comment(const std::string& comment) {}
 
-void fst_trace_file::init() {
-    std::vector<trace_entry*> traces;
-    traces.reserve(all_traces.size());
+std::vector<fst_trace_file::trace_entry*> fst_trace_file::declare() {
+    trace::scope_trie<trace_entry> scope(all_traces.size());
     for(auto& e : all_traces)
-        traces.push_back(&e);
-    std::sort(std::begin(traces), std::end(traces),
-              [](trace_entry const* a, trace_entry const* b) -> bool { return a->trc->name < b->trc->name; });
-
+        scope.add(e.trc->name, &e);
+    scope.sort();
     std::unordered_map<uintptr_t, fstHandle> alias_map;
-    std::deque<std::string> fst_scope;
-    for(auto e : traces) {
-        auto alias_it = alias_map.find(e->trc->get_hash());
-        e->trc->is_alias = alias_it != std::end(alias_map);
-        auto hier_tokens = util::split(e->trc->name, '.');
-        auto sig_name = hier_tokens.back();
-        hier_tokens.pop_back();
-        auto cur_it = fst_scope.begin();
-        auto tok_it = hier_tokens.begin();
-        while(cur_it != std::end(fst_scope) && tok_it != std::end(hier_tokens)) {
-            if(*cur_it != *tok_it)
-                break;
-            ++cur_it;
-            ++tok_it;
-        }
-        auto common_count = std::distance(fst_scope.begin(), cur_it);
-        for(auto i = fst_scope.size(); i > common_count; i--) {
-            fstWriterSetUpscope(m_fst);
-            fst_scope.pop_back();
-        }
-        for(; tok_it != std::end(hier_tokens); tok_it++) {
-            fstWriterSetScope(m_fst, FST_ST_VCD_SCOPE, tok_it->c_str(), nullptr);
-            fst_scope.push_back(*tok_it);
-        }
-        e->trc->fst_hndl =
-            fstWriterCreateVar(m_fst, e->trc->type == trace::REAL ? FST_VT_VCD_REAL : FST_VT_VCD_WIRE, FST_VD_IMPLICIT,
-                               e->trc->bits, sig_name.c_str(), e->trc->is_alias ? alias_it->second : 0);
-        if(!e->trc->is_alias)
-            alias_map.insert({e->trc->get_hash(), e->trc->fst_hndl});
-    }
-    std::copy_if(std::begin(traces), std::end(traces), std::back_inserter(pull_traces),
-                 [](trace_entry const* e) { return !(e->trc->is_alias || e->trc->is_triggered); });
+    alias_map.reserve(all_traces.size());
+    scope.traverse(
+        scope.root,
+        [this](std::string const& name) { fstWriterSetScope(m_fst, FST_ST_VCD_SCOPE, name.c_str(), nullptr); },
+        [this]() { fstWriterSetUpscope(m_fst); },
+        [this, &alias_map](std::string const& name, trace_entry* e) {
+            auto alias_it = alias_map.find(e->trc->get_hash());
+            e->trc->is_alias = alias_it != std::end(alias_map);
+            e->trc->fst_hndl = fstWriterCreateVar(m_fst, e->trc->type == trace::REAL ? FST_VT_VCD_REAL : FST_VT_VCD_WIRE,
+                                                  FST_VD_IMPLICIT, e->trc->bits, name.c_str(),
+                                                  e->trc->is_alias ? alias_it->second : 0);
+            if(!e->trc->is_alias)
+                alias_map.insert({e->trc->get_hash(), e->trc->fst_hndl});
+        });
+    return scope.ordered();
+}
+
+void fst_trace_file::init() {
+    if(!m_fst)
+        open_output();
+    auto traces = declare();
+    for(auto e : traces)
+        if(e->trc->bits > max_bits)
+            max_bits = e->trc->bits;
+    emitter.reset(new trace::fst_emitter(m_fst, background, max_bits));
+    emitter->set_pre_trigger(pre_trigger_depth);
+    detector.reset(new trace::change_detector<trace_entry>());
+    for(auto e : traces)
+        if(!(e->trc->is_alias || e->trc->is_triggered) &&
+           !detector->add(e, reinterpret_cast<void const*>(e->trc->get_hash()), e->shadow_size))
+            pull_traces.push_back(e);
     changed_traces.reserve(pull_traces.size());
     triggered_traces.reserve(all_traces.size());
 }
@@ -413,14 +699,25 @@ void fst_trace_file::cycle(bool delta_cycle) {
         init();
     if(last_emitted_ts==std::numeric_limits<uint64_t>::max()) {
         uint64_t time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
-        fstWriterEmitTimeChange(m_fst, time_stamp);
+        emitter->emit_time(time_stamp);
         for(auto& e : all_traces)
             if(!e.trc->is_alias)
-                e.trc->update_and_record(m_fst);
+                e.trc->update_and_record(*emitter);
         last_emitted_ts = time_stamp;
     } else {
-        if(check_enabled && !check_enabled())
+        auto enabled = !check_enabled || check_enabled();
+        if(!enabled && !pre_trigger_depth) {
+            // the changes of triggered traces are kept once per trace and written when tracing is enabled again
+            std::sort(std::begin(triggered_traces), std::end(triggered_traces));
+            triggered_traces.erase(std::unique(std::begin(triggered_traces), std::end(triggered_traces)),
+                                   std::end(triggered_traces));
             return;
+        }
+        emitter->divert(!enabled);
+        detector->scan([this](trace_entry& e) {
+            if(e.compare_and_update(e.trc))
+                changed_traces.push_back(e.trc);
+        });
         for(auto e : pull_traces) {
             if(e->compare_and_update(e->trc))
                 changed_traces.push_back(e->trc);
@@ -428,30 +725,86 @@ void fst_trace_file::cycle(bool delta_cycle) {
         if(triggered_traces.size() || changed_traces.size()) {
             uint64_t time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
             if(last_emitted_ts<time_stamp)
-                fstWriterEmitTimeChange(m_fst, time_stamp);
+                emitter->emit_time(time_stamp);
             if(triggered_traces.size()) {
                 auto end = std::unique(std::begin(triggered_traces), std::end(triggered_traces));
                 triggered_traces.erase(end, triggered_traces.end());
                 for(auto t : triggered_traces)
-                    t->record(m_fst);
+                    t->record(*emitter);
                 triggered_traces.clear();
             }
             if(changed_traces.size()) {
                 for(auto t : changed_traces)
-                    t->record(m_fst);
+                    t->record(*emitter);
                 changed_traces.clear();
             }
             last_emitted_ts = time_stamp;
         }
+        if(!enabled)
+            emitter->expire(sc_core::sc_time_stamp().value() / (1_ps).value());
+        else if(manifest) {
+            uint64_t time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
+            if((max_segment_size && emitter->bytes >= max_segment_size) ||
+               (max_segment_time && time_stamp - segment_start >= max_segment_time))
+                rotate(time_stamp);
+        }
     }
 }
 
+void fst_trace_file::set_rotation(uint64_t max_size, sc_core::sc_time const& max_time) {
+    max_segment_size = max_size;
+    max_segment_time = max_time.value() / (1_ps).value();
+    if(!manifest && (max_segment_size || max_segment_time)) {
+        // from now on the output goes into the segment files, the writer is created lazily in init()
+        manifest.reset(new trace::segment_manifest(name + ".fst.json", "fst"));
+        if(emitter)
+            rotate(sc_core::sc_time_stamp().value() / (1_ps).value());
+    }
+}
+
+void fst_trace_file::open_output() {
+    if(manifest) {
+        auto file_name = trace::segment_manifest::segment_name(name, 0, ".fst");
+        m_fst = create_writer(file_name);
+        segment_start = sc_core::sc_time_stamp().value() / (1_ps).value();
+        manifest->add(file_name, segment_start);
+    } else
+        m_fst = create_writer(name + ".fst");
+}
+
+void fst_trace_file::rotate(uint64_t time_stamp) {
+    emitter.reset();
+    fstWriterClose(m_fst);
+    auto file_name = trace::segment_manifest::segment_name(name, manifest->size(), ".fst");
+    m_fst = create_writer(file_name);
+    manifest->add(file_name, time_stamp);
+    segment_start = time_stamp;
+    declare();
+    emitter.reset(new trace::fst_emitter(m_fst, background, max_bits));
+    emitter->set_pre_trigger(pre_trigger_depth);
+    emitter->emit_time(time_stamp);
+    for(auto& e : all_traces)
+        if(!e.trc->is_alias)
+            e.trc->record(*emitter);
+}
+
+void fst_trace_file::set_pre_trigger(sc_core::sc_time const& window) {
+    pre_trigger_depth = window.value() / (1_ps).value();
+    if(emitter)
+        emitter->set_pre_trigger(pre_trigger_depth);
+}
+
 void fst_trace_file::set_time_unit(double v, sc_core::sc_time_unit tu) {}
 
 sc_core::sc_trace_file* create_fst_trace_file(const char* name, std::function<bool()> enable) {
     return new fst_trace_file(name, enable);
 }
 
+sc_core::sc_trace_file* create_fst_trace_file(const char* name, bool background, fst_pack_type pack,
+                                              std::function<bool()> enable) {
+    return new fst_trace_file(name, enable, background, pack);
+}
+
 void close_fst_trace_file(sc_core::sc_trace_file* tf) { delete static_cast<fst_trace_file*>(tf); }
 
 } // namespace scc
@@ -19,11 +19,13 @@
 #define SCC_FST_TRACE_H
 
 #include <scc/observer.h>
+#include <scc/trace.h>
 #include <sysc/tracing/sc_trace.h>
 #include <sysc/kernel/sc_ver.h>
 #include <deque>
 #include <vector>
 #include <functional>
+#include <memory>
 
 namespace sc_core {
 class sc_time;
@@ -37,13 +39,33 @@ namespace scc {
 //! @brief SCC SystemC tracing utilities
 namespace trace {
 class fst_trace;
+class fst_emitter;
+class segment_manifest;
+template <typename E> class change_detector;
 }
-struct fst_trace_file : public sc_core::sc_trace_file, public observer {
-
-    fst_trace_file(const char *name, std::function<bool()>& enable);
+struct fst_trace_file : public sc_core::sc_trace_file, public observer, public trace_capture_if {
+
+    /**
+     * @fn  fst_trace_file(const char*, std::function<bool()>&, bool, fst_pack_type)
+     * @brief constructor
+     *
+     * @param name the name of the trace file without extension
+     * @param enable the functor returning if tracing is enabled
+     * @param background if true the FST writer runs in a separate thread, the value changes are handed over using a
+     * lock-free queue and the blocks are compressed in parallel if the FST library supports it
+     * @param pack the compression algorithm used for the value change blocks
+     */
+    fst_trace_file(const char *name, std::function<bool()>& enable, bool background = false,
+            fst_pack_type pack = fst_pack_type::LZ4);
 
     virtual ~fst_trace_file();
 
+    void set_enable(std::function<bool()> enable) override { check_enabled = enable; }
+
+    void set_pre_trigger(sc_core::sc_time const& window) override;
+
+    void set_rotation(uint64_t max_size, sc_core::sc_time const& max_time) override;
+
 protected:
 #define DECL_TRACE_METHOD_A(tp) void trace(const tp& object, const std::string& name) override;
 #define DECL_TRACE_METHOD_B(tp) void trace(const tp& object, const std::string& name, int width) override;
@@ -137,20 +159,43 @@ private:
 #endif
 
     void init();
+
+    void open_output();
+
+    void* create_writer(std::string const& file_name);
+
+    void rotate(uint64_t time_stamp);
+
     std::function<bool()> check_enabled;
 
     void* m_fst{nullptr};
+    bool const background;
+    fst_pack_type const pack;
+    std::string const name;
+    unsigned max_bits{64};
+    //! the index of the segments if the output is rotated
+    std::unique_ptr<trace::segment_manifest> manifest;
+    uint64_t max_segment_size{0}, max_segment_time{0}, segment_start{0};
+    //! forwards the value changes to the FST writer
+    std::unique_ptr<trace::fst_emitter> emitter;
+    //! the length of the pre-trigger window in ps
+    uint64_t pre_trigger_depth{0};
     struct trace_entry: public observer::notification_handle {
         bool (*compare_and_update)(trace::fst_trace*);
         trace::fst_trace* trc;
         fst_trace_file* that;
+        unsigned shadow_size;
         bool notify() override;
-        trace_entry(fst_trace_file* owner, bool (*compare_and_update)(trace::fst_trace*), trace::fst_trace* trc)
-        :compare_and_update{compare_and_update}, trc{trc}, that{owner}{}
+        trace_entry(fst_trace_file* owner, bool (*compare_and_update)(trace::fst_trace*), trace::fst_trace* trc,
+                unsigned shadow_size = 0)
+        :compare_and_update{compare_and_update}, trc{trc}, that{owner}, shadow_size{shadow_size}{}
         virtual ~trace_entry(){}
     };
+    std::vector<trace_entry*> declare();
     std::deque<trace_entry> all_traces;
     std::vector<trace_entry*> pull_traces;
+    //! the pulled traces of scalar values being checked in a structure-of-arrays
+    std::unique_ptr<trace::change_detector<trace_entry>> detector;
     std::vector<trace::fst_trace*> changed_traces;
     std::vector<trace::fst_trace*> triggered_traces;
     uint64_t last_emitted_ts{std::numeric_limits<uint64_t>::max()};
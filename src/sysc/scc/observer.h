@@ -92,6 +92,22 @@ struct observer {
 #endif
     virtual ~observer() {}
 };
+/**
+ * @brief The interface of an object notifying its observers itself when its value changes, e.g. a signal calling the
+ * notification handles from its update phase. This avoids a process per traced object.
+ */
+struct observable {
+    /**
+     * @fn bool register_observer(observer*, const std::string&)const
+     * @brief registers the value of this object with the observer and keeps the returned notification handle
+     *
+     * @param obs the observer (usually a trace file)
+     * @param nm the name to be used for the value
+     * @return true if the observer accepted the value
+     */
+    virtual bool register_observer(observer* obs, std::string const& nm) const = 0;
+    virtual ~observable() {}
+};
 
 #define DECL_REGISTER_METHOD_A(tp)                                                                                     \
 		inline observer::notification_handle* observe(observer* obs, tp const& o, std::string const& nm) {                 \
@@ -136,7 +152,11 @@ DECL_REGISTER_METHOD_A(sc_dt::sc_lv_base)
 template< class T > inline
 void sc_trace(sc_core::sc_trace_file* tf, const sc_core::sc_signal_in_if<T>& object, const char* name ) {
     if(auto* obs = dynamic_cast<observer*>(tf)) {
-        if(auto* handle = obs->observe(object.read(), std::string(name))){
+        if(auto* obl = dynamic_cast<observable const*>(&object)) {
+            // fall back to the polling of the value if the observer does not accept it
+            if(!obl->register_observer(obs, std::string(name)))
+                sc_core::sc_trace(tf, object.read(), name);
+        } else if(auto* handle = obs->observe(object.read(), std::string(name))){
             sc_core::sc_spawn_options scopts;
             scopts.spawn_method();
             scopts.set_sensitivity(&object.default_event());
@@ -161,7 +181,10 @@ void sc_trace(sc_core::sc_trace_file* tf, const sc_core::sc_in<T>& port, char co
         iface = dynamic_cast<const sc_core::sc_signal_in_if<T>*>( port.get_interface() );
     if ( iface )
         if(auto* obs = dynamic_cast<observer*>(tf)) {
-            if(auto* handle = obs->observe(port.read(), name)){
+            if(auto* obl = dynamic_cast<observable const*>(iface)) {
+                if(!obl->register_observer(obs, name))
+                    sc_trace(tf, iface->read(), name);
+            } else if(auto* handle = obs->observe(port.read(), name)){
                 sc_core::sc_spawn_options scopts;
                 scopts.spawn_method();
                 scopts.set_sensitivity(&port.default_event());
@@ -188,7 +211,10 @@ void sc_trace( sc_core::sc_trace_file* tf, const sc_core::sc_inout<T>& port, cha
         iface = dynamic_cast<const sc_core::sc_signal_in_if<T>*>( port.get_interface() );
     if ( iface )
         if(auto* obs = dynamic_cast<observer*>(tf)) {
-            if(auto* handle = obs->observe(port.read(), name)){
+            if(auto* obl = dynamic_cast<observable const*>(iface)) {
+                if(!obl->register_observer(obs, name))
+                    sc_trace(tf, iface->read(), name);
+            } else if(auto* handle = obs->observe(port.read(), name)){
                 sc_core::sc_spawn_options scopts;
                 scopts.spawn_method();
                 scopts.set_sensitivity(&port.default_event());
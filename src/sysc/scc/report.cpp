@@ -21,6 +21,7 @@
  */
 
 #include "report.h"
+#include "flight_recorder.h"
 #include <array>
 #include <chrono>
 #include <fstream>
@@ -257,6 +258,12 @@ void report_handler(const sc_report& rep, const sc_actions& actions) {
     thread_local bool sc_stop_called = false;
     if(actions & SC_DO_NOTHING)
         return;
+    if(flight_recorder::enabled()) {
+        flight_recorder::get().record_log(rep.get_severity(), rep.get_msg_type(), rep.get_msg(),
+                                          sc_time_stamp().value());
+        if(rep.get_severity() >= SC_ERROR)
+            flight_recorder::get().dump();
+    }
     if(rep.get_severity() == sc_core::SC_INFO || !log_cfg.report_only_first_error ||
             sc_report_handler::get_count(SC_ERROR) < 2) {
         if((actions & SC_DISPLAY) && (!log_cfg.file_logger || get_verbosity(rep) < SC_HIGH))
@@ -372,6 +379,14 @@ static void configure_logging() {
     sc_report_handler::set_actions(SC_FATAL, SC_DEFAULT_FATAL_ACTIONS);
     sc_report_handler::set_verbosity_level(verbosity[static_cast<unsigned>(log_cfg.level)]);
     sc_report_handler::set_handler(report_handler);
+    if(auto* val = getenv("SCC_FLIGHT_RECORDER_SIZE"))
+        log_cfg.flight_recorder_size = strtoul(val, nullptr, 0);
+    if(log_cfg.flight_recorder_size && !flight_recorder::enabled()) {
+        flight_recorder::get().enable(log_cfg.flight_recorder_size);
+#ifdef SIGUSR1
+        flight_recorder::get().dump_on_signal(SIGUSR1);
+#endif
+    }
     if(!spdlog_initialized) {
         spdlog::init_thread_pool(1024U,
                 log_cfg.log_file_name.size() ? 2U : 1U); // queue with 8k items and 1 backing thread.
@@ -521,6 +536,11 @@ auto scc::LogConfig::instanceBasedLogLevels(bool v) -> scc::LogConfig& {
     return *this;
 }
 
+auto scc::LogConfig::flightRecorderSize(size_t size) -> scc::LogConfig& {
+    this->flight_recorder_size = size;
+    return *this;
+}
+
 auto scc::get_log_verbosity(char const* str) -> sc_core::sc_verbosity {
 #ifdef HAS_CCI
     if(inst_based_logging()){
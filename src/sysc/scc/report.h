@@ -165,6 +165,7 @@ struct LogConfig {
     bool dont_create_broker{false};
     bool report_only_first_error{false};
     bool instance_based_log_levels{true};
+    size_t flight_recorder_size{0};
 
     //! set the logging level
     LogConfig& logLevel(log);
@@ -196,6 +197,8 @@ struct LogConfig {
     LogConfig& reportOnlyFirstError(bool = true);
     //! disable/enable the supression of all error messages after the first error
     LogConfig& instanceBasedLogLevels(bool = true);
+    //! set the number of transactions and messages kept by the flight recorder, 0 disables it
+    LogConfig& flightRecorderSize(size_t);
 };
 /**
  * @fn void init_logging(const LogConfig&)
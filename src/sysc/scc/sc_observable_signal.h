@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _SCC_SC_OBSERVABLE_SIGNAL_H_
+#define _SCC_SC_OBSERVABLE_SIGNAL_H_
+
+#include "observer.h"
+#include <algorithm>
+#include <sysc/communication/sc_signal.h>
+#include <vector>
+/** \ingroup scc-sysc
+ *  @{
+ */
+/**@{*/
+//! @brief SCC SystemC utilities
+namespace scc {
+/**
+ * @class sc_observable_signal
+ * @brief sc_signal which pushes its value changes into the observing trace files
+ *
+ * When traced by a trace file implementing the observer interface (e.g. the VCD push, VCD multi-threaded and FST
+ * trace files) the signal calls the notification handles directly from its update phase if the value actually
+ * changed. Neither a process per signal nor a per-timestep comparison is needed so the tracing cost scales with the
+ * activity of the design instead of its size. Other trace files, and observers rejecting the value, are served as for
+ * a plain sc_signal.
+ *
+ * @tparam T the type of the value
+ * @tparam POL the writer policy
+ */
+template <class T, sc_core::sc_writer_policy POL = sc_core::SC_ONE_WRITER>
+class sc_observable_signal : public sc_core::sc_signal<T, POL>, public observable {
+protected:
+    using super = sc_core::sc_signal<T, POL>;
+
+public: // constructors and destructor:
+    sc_observable_signal()
+    : sc_core::sc_signal<T, POL>(sc_core::sc_gen_unique_name("signal")) {}
+
+    explicit sc_observable_signal(const char* name_)
+    : sc_core::sc_signal<T, POL>(name_) {}
+
+    sc_observable_signal(const char* name_, T const& initial_value_)
+    : sc_core::sc_signal<T, POL>(name_, initial_value_) {}
+
+    virtual ~sc_observable_signal() {}
+
+    using super::operator=;
+    /**
+     * @fn void trace(sc_core::sc_trace_file*)const
+     * @brief register the signal with the trace file, observing trace files get the value changes pushed
+     *
+     * @param tf the trace file
+     */
+    void trace(sc_core::sc_trace_file* tf) const override {
+        // trace files not accepting the value (e.g. for an unsupported type) poll it as for a plain sc_signal
+        auto* obs = dynamic_cast<observer*>(tf);
+        if(!obs || !register_observer(obs, this->name()))
+            super::trace(tf);
+    }
+
+    bool register_observer(observer* obs, std::string const& nm) const override {
+        if(auto* h = observe(obs, super::m_cur_val, nm)) {
+            hndl.push_back(h);
+            return true;
+        }
+        return false;
+    }
+
+protected:
+    void update() override {
+        if(!(super::m_new_val == super::m_cur_val)) {
+            super::update();
+            // a handle returns false if the trace is an alias of another one, it does not need to be notified again
+            if(hndl.size())
+                hndl.erase(std::remove_if(std::begin(hndl), std::end(hndl),
+                                          [](observer::notification_handle* h) { return !h->notify(); }),
+                           std::end(hndl));
+        } else
+            super::update();
+    }
+
+private:
+    //! the handles of the observing trace files
+    mutable std::vector<observer::notification_handle*> hndl;
+};
+
+} // namespace scc
+/** @} */ // end of scc-sysc
+#endif /* _SCC_SC_OBSERVABLE_SIGNAL_H_ */
@@ -14,40 +14,135 @@
  * limitations under the License.
  *******************************************************************************/
 
-#include <functional>
-#include <ostream>
-
-namespace sc_core {
-inline std::ostream& operator<<(std::ostream& os, std::function<void()>&) { return os; }
-} // namespace sc_core
-
 #define SC_INCLUDE_DYNAMIC_PROCESSES
 #include "sc_thread_pool.h"
+#include "report.h"
+#include <algorithm>
 
 namespace scc {
 
 sc_thread_pool::sc_thread_pool()
 : sc_core::sc_object(sc_core::sc_gen_unique_name("pool")) {}
 
-sc_thread_pool::~sc_thread_pool() = default;
+sc_thread_pool::~sc_thread_pool() {
+    if(stats.jobs)
+        SCCDEBUG(name()) << "executed " << stats.jobs << " jobs using " << stats.threads << " threads, peak concurrency "
+                         << stats.peak_concurrency << ", " << stats.queued_jobs << " jobs queued (peak queue size "
+                         << stats.peak_queue_size << ", max wait time " << stats.max_wait_time << ")";
+}
+
+unsigned sc_thread_pool::get_stack_class(unsigned stack_size) const {
+    unsigned cls = 0;
+    for(auto size = default_stack_size.get_value(); size < stack_size && cls < stack_classes - 1; size <<= 1)
+        ++cls;
+    return cls;
+}
+
+void sc_thread_pool::execute(std::function<void(void)> fct, unsigned stack_size) {
+    if(stack_size > (default_stack_size.get_value() << (stack_classes - 1))) {
+        // larger than the largest stack class, the job gets a thread of its own which is not pooled
+        if(thread_active < max_concurrent_threads.get_value())
+            spawn_unpooled(std::move(fct), stack_size);
+        else
+            enqueue(std::move(fct), unpooled, stack_size);
+        return;
+    }
+    auto cls = get_stack_class(stack_size);
+    for(auto i = cls; i < stack_classes; ++i) {
+        if(idle_workers[i].size()) {
+            auto* w = idle_workers[i].back();
+            idle_workers[i].pop_back();
+            w->job = std::move(fct);
+            if(++thread_active > stats.peak_concurrency)
+                stats.peak_concurrency = thread_active;
+            w->evt.notify();
+            return;
+        }
+    }
+    if(thread_active < max_concurrent_threads.get_value()) {
+        spawn_worker(std::move(fct), cls);
+    } else {
+        enqueue(std::move(fct), cls, 0);
+    }
+}
+
+void sc_thread_pool::enqueue(std::function<void(void)>&& fct, unsigned stack_class, unsigned stack_size) {
+    pending_jobs.push_back(pending_job{std::move(fct), stack_class, stack_size, sc_core::sc_time_stamp()});
+    stats.queued_jobs++;
+    if(pending_jobs.size() > stats.peak_queue_size)
+        stats.peak_queue_size = pending_jobs.size();
+}
+
+void sc_thread_pool::spawn_worker(std::function<void(void)>&& fct, unsigned stack_class) {
+    workers.emplace_back(stack_class);
+    auto& w = workers.back();
+    w.job = std::move(fct);
+    stats.threads++;
+    if(++thread_active > stats.peak_concurrency)
+        stats.peak_concurrency = thread_active;
+    sc_core::sc_spawn_options opts;
+    opts.set_stack_size(default_stack_size.get_value() << stack_class);
+    sc_core::sc_spawn([this, &w]() { run(w); }, sc_core::sc_gen_unique_name("worker"), &opts);
+}
 
-void sc_thread_pool::execute(std::function<void(void)> fct) {
+void sc_thread_pool::spawn_unpooled(std::function<void(void)>&& fct, unsigned stack_size) {
+    stats.threads++;
+    if(++thread_active > stats.peak_concurrency)
+        stats.peak_concurrency = thread_active;
     sc_core::sc_spawn_options opts;
-    opts.set_stack_size(0x10000);
-    if(thread_avail == 0 && thread_active < max_concurrent_threads.get_value())
-        sc_core::sc_spawn(
-            [this]() {
-                thread_active++;
-                while(true) {
-                    thread_avail++;
-                    auto fct = dispatch_queue.read();
-                    sc_assert(thread_avail > 0);
-                    thread_avail--;
-                    fct();
-                }
-            },
-            nullptr, &opts);
-    dispatch_queue.write(fct);
+    opts.set_stack_size(stack_size);
+    auto job = std::move(fct);
+    sc_core::sc_spawn(
+        [this, job]() {
+            job();
+            stats.jobs++;
+            sc_assert(thread_active > 0);
+            thread_active--;
+            start_pending();
+        },
+        sc_core::sc_gen_unique_name("worker"), &opts);
+}
+
+void sc_thread_pool::start_pending() {
+    if(pending_jobs.size() && thread_active < max_concurrent_threads.get_value()) {
+        auto p = std::move(pending_jobs.front());
+        pending_jobs.pop_front();
+        record_wait(p.enqueue_time);
+        if(p.stack_class == unpooled)
+            spawn_unpooled(std::move(p.job), p.stack_size);
+        else
+            spawn_worker(std::move(p.job), p.stack_class);
+    }
+}
+
+void sc_thread_pool::run(worker& w) {
+    while(true) {
+        w.job();
+        w.job = nullptr;
+        stats.jobs++;
+        auto it = std::find_if(pending_jobs.begin(), pending_jobs.end(),
+                               [&w](pending_job const& p) { return p.stack_class <= w.stack_class; });
+        if(it != pending_jobs.end()) {
+            record_wait(it->enqueue_time);
+            w.job = std::move(it->job);
+            pending_jobs.erase(it);
+        } else {
+            sc_assert(thread_active > 0);
+            thread_active--;
+            // the waiting jobs need a larger stack than this thread provides
+            start_pending();
+            idle_workers[w.stack_class].push_back(&w);
+            sc_core::wait(w.evt);
+            sc_assert(w.job);
+        }
+    }
+}
+
+void sc_thread_pool::record_wait(sc_core::sc_time const& enqueue_time) {
+    auto wait_time = sc_core::sc_time_stamp() - enqueue_time;
+    stats.total_wait_time += wait_time;
+    if(wait_time > stats.max_wait_time)
+        stats.max_wait_time = wait_time;
 }
 
 } /* namespace scc */
@@ -16,9 +16,12 @@
 
 #ifndef SYSC_SCC_SC_THREAD_POOL_H_
 #define SYSC_SCC_SC_THREAD_POOL_H_
+#include <array>
 #include <cci_configuration>
+#include <deque>
 #include <functional>
 #include <systemc>
+#include <vector>
 
 /** \ingroup scc-sysc
  *  @{
@@ -26,19 +29,104 @@
 /**@{*/
 //! @brief SCC SystemC utilities
 namespace scc {
-
+/**
+ * @class sc_thread_pool
+ * @brief a pool of re-usable SystemC threads
+ *
+ * Jobs are handed directly to an idle pooled thread by notifying the thread specific event. If no suitable thread is
+ * idle and less than max_concurrent_threads jobs are running a new thread is spawned, otherwise the job is queued in
+ * FIFO order. Threads are grouped into stack size classes being powers of 2 of the default stack size, a job is only
+ * executed by a thread having at least the requested stack size. A job requesting more than the largest stack class
+ * (128 times the default stack size) is run in a dedicated, non-pooled thread with the requested stack size. Such a
+ * thread counts as running job as well and is queued if max_concurrent_threads jobs are running.
+ */
 class sc_thread_pool : sc_core::sc_object {
 public:
+    //! the statistics collected by the pool
+    struct statistics {
+        //! number of executed jobs
+        uint64_t jobs{0};
+        //! number of jobs which needed to wait for a free thread
+        uint64_t queued_jobs{0};
+        //! number of spawned SystemC threads
+        unsigned threads{0};
+        //! maximum number of concurrently running jobs
+        unsigned peak_concurrency{0};
+        //! maximum number of jobs waiting for a free thread
+        unsigned peak_queue_size{0};
+        //! accumulated (simulation) time jobs waited for a free thread
+        sc_core::sc_time total_wait_time{sc_core::SC_ZERO_TIME};
+        //! maximum (simulation) time a job waited for a free thread
+        sc_core::sc_time max_wait_time{sc_core::SC_ZERO_TIME};
+    };
+
     sc_thread_pool();
-    virtual ~sc_thread_pool();
 
-    void execute(std::function<void(void)> fct);
+    virtual ~sc_thread_pool();
+    /**
+     * @fn void execute(std::function<void(void)>, unsigned)
+     * @brief execute a function in a SystemC thread context
+     *
+     * @param fct the function to execute, it may call wait()
+     * @param stack_size the minimum stack size required by the function, 0 selects the default stack size
+     */
+    void execute(std::function<void(void)> fct, unsigned stack_size = 0);
+    /**
+     * @fn const statistics& get_statistics()const
+     * @brief get the statistics of the pool
+     *
+     * @return reference to the statistics
+     */
+    const statistics& get_statistics() const { return stats; }
+    /**
+     * @fn unsigned get_active_jobs()const
+     * @brief get the number of currently running jobs
+     *
+     * @return the number of running jobs
+     */
+    unsigned get_active_jobs() const { return thread_active; }
+    /**
+     * @fn unsigned get_pending_jobs()const
+     * @brief get the number of jobs waiting for a free thread
+     *
+     * @return the number of waiting jobs
+     */
+    unsigned get_pending_jobs() const { return pending_jobs.size(); }
 
     cci::cci_param<unsigned> max_concurrent_threads{"max_concurrent_threads", 16};
 
+    cci::cci_param<unsigned> default_stack_size{"default_stack_size", 0x10000};
+
 private:
-    sc_core::sc_fifo<std::function<void(void)>> dispatch_queue{"dispatch_queue"};
-    unsigned thread_avail{0}, thread_active{0};
+    static constexpr unsigned stack_classes = 8;
+    //! the pseudo stack class of jobs being run in a non-pooled thread
+    static constexpr unsigned unpooled = stack_classes;
+    struct worker {
+        sc_core::sc_event evt;
+        std::function<void(void)> job;
+        unsigned stack_class;
+        explicit worker(unsigned stack_class)
+        : stack_class(stack_class) {}
+    };
+    struct pending_job {
+        std::function<void(void)> job;
+        unsigned stack_class;
+        //! the requested stack size of an unpooled job
+        unsigned stack_size;
+        sc_core::sc_time enqueue_time;
+    };
+    unsigned get_stack_class(unsigned stack_size) const;
+    void enqueue(std::function<void(void)>&& fct, unsigned stack_class, unsigned stack_size);
+    void spawn_worker(std::function<void(void)>&& fct, unsigned stack_class);
+    void spawn_unpooled(std::function<void(void)>&& fct, unsigned stack_size);
+    void start_pending();
+    void run(worker& w);
+    void record_wait(sc_core::sc_time const& enqueue_time);
+    std::deque<worker> workers;
+    std::array<std::vector<worker*>, stack_classes> idle_workers;
+    std::deque<pending_job> pending_jobs;
+    unsigned thread_active{0};
+    statistics stats;
 };
 } /* namespace scc */
 /** @} */ // end of scc-sysc
@@ -16,13 +16,19 @@
 #include <array>
 #include <boost/filesystem.hpp>
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <deque>
 #include <fcntl.h>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <unistd.h>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -83,177 +89,296 @@ using data_type = scv_extensions_if::data_type;
 // ----------------------------------------------------------------------------
 namespace {
 
-struct ByteBufferWriter {
-    ByteBufferWriter(size_t reserve = 32) { buf.reserve(reserve); }
-    template <typename T> ByteBufferWriter& append(const T& v) {
-        const auto* ptr = reinterpret_cast<const unsigned char*>(&v);
-        for(size_t i = 0; i < sizeof(T); ++i, ++ptr)
-            buf.push_back(*ptr);
-        return *this;
-    }
-
-    size_t length() { return buf.size(); }
-
-    unsigned char* operator()() { return buf.data(); }
+/**
+ * writes a record directly into a preallocated buffer, the caller has to make sure the record fits
+ */
+struct RecordWriter {
+    RecordWriter(unsigned char* buf)
+    : ptr(buf) {}
 
-    void write(int file_des) {
-        ssize_t written = ::write(file_des, buf.data(), buf.size());
-        if(written != buf.size())
-            throw std::runtime_error("not written"); // TODO: implement error handling
+    template <typename T> RecordWriter& append(const T& v) {
+        memcpy(ptr, &v, sizeof(T));
+        ptr += sizeof(T);
+        return *this;
     }
 
 private:
-    std::vector<unsigned char> buf;
+    unsigned char* ptr;
 };
 
-template <> ByteBufferWriter& ByteBufferWriter::append<std::string>(const std::string& v) {
-    auto it = buf.end();
-    buf.resize(buf.size() + v.length());
-    std::copy(v.begin(), v.end(), it);
+template <> RecordWriter& RecordWriter::append<std::string>(const std::string& v) {
+    memcpy(ptr, v.data(), v.length());
+    ptr += v.length();
     return *this;
 }
 
 const int open_flags{O_WRONLY | O_CREAT | O_TRUNC};
 const auto open_mode{00644};
-
-struct ControlBuffer {
-    ControlBuffer(const boost::filesystem::path& name) {
+/**
+ * a file written in chunks of fixed size. Records are placed into the current chunk, full chunks are written by a
+ * background thread using a single write call per chunk. The number of chunks in flight is bounded, if all of them are
+ * in use the producer waits for the writer thread. If the file is padded records do not span chunk boundaries, the
+ * remainder of a chunk is filled with 0 (fill record) and each chunk is written with its full size.
+ */
+class ChunkedFile {
+public:
+    ChunkedFile(const boost::filesystem::path& name, size_t chunk_size, bool padded, size_t max_chunks = 8)
+    : file_name(name.string())
+    , chunk_size(chunk_size)
+    , max_chunks(max_chunks)
+    , padded(padded) {
         file_des = open(name.string().c_str(), open_flags, open_mode);
+        if(file_des < 0)
+            throw std::runtime_error("could not open " + name.string());
+        current = allocate();
+        writer = std::thread([this]() { run(); });
+    }
+
+    ~ChunkedFile() {
+        // a destructor must not throw, a failure of the writer thread is reported instead
+        if(current->size) {
+            if(padded)
+                pad();
+            enqueue(current);
+        }
+        {
+            lock_type lock(mtx);
+            done = true;
+        }
+        job_cond.notify_one();
+        writer.join();
+        close(file_des);
+        if(failed)
+            _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL,
+                                  ("Can't write recording file " + file_name).c_str());
+    }
+    /**
+     * returns a pointer where len bytes can be written to and the file offset thereof, in padded files the current
+     * chunk is closed if the record does not fit
+     */
+    inline unsigned char* reserve(size_t len, uint64_t& offset) {
+        if(current->size + len > chunk_size) {
+            if(padded)
+                pad();
+            submit(current);
+            current = acquire();
+        }
+        offset = block_count * chunk_size + current->size;
+        auto* ret = current->data.get() + current->size;
+        current->size += len;
+        return ret;
     }
+    /**
+     * appends data of arbitrary length, may only be used for files not being padded
+     */
+    void write(const unsigned char* p, size_t len) {
+        while(len > chunk_size - current->size) {
+            auto avail = chunk_size - current->size;
+            memcpy(current->data.get() + current->size, p, avail);
+            current->size += avail;
+            p += avail;
+            len -= avail;
+            submit(current);
+            current = acquire();
+        }
+        memcpy(current->data.get() + current->size, p, len);
+        current->size += len;
+    }
+
+private:
+    using lock_type = std::unique_lock<std::mutex>;
+
+    struct chunk {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size{0};
+    };
+
+    void pad() {
+        std::fill(current->data.get() + current->size, current->data.get() + chunk_size, 0);
+        current->size = chunk_size;
+    }
+
+    chunk* allocate() {
+        chunks.emplace_back(new chunk);
+        chunks.back()->data.reset(new unsigned char[chunk_size]);
+        return chunks.back().get();
+    }
+
+    void submit(chunk* c) {
+        if(!enqueue(c))
+            throw std::runtime_error("could not write " + file_name);
+    }
+    //! hands a chunk to the writer thread, returns false if the writer thread failed to write a previous chunk
+    bool enqueue(chunk* c) {
+        block_count++;
+        lock_type lock(mtx);
+        if(failed)
+            return false;
+        jobs.push_back(c);
+        job_cond.notify_one();
+        return true;
+    }
+
+    chunk* acquire() {
+        lock_type lock(mtx);
+        if(free_list.empty()) {
+            // chunks are only allocated by the producer thread
+            if(chunks.size() < max_chunks)
+                return allocate();
+            free_cond.wait(lock, [this]() -> bool { return !free_list.empty(); });
+        }
+        auto* c = free_list.back();
+        free_list.pop_back();
+        return c;
+    }
+
+    void run() {
+        lock_type lock(mtx);
+        while(true) {
+            job_cond.wait(lock, [this]() -> bool { return done || !jobs.empty(); });
+            if(jobs.empty())
+                break;
+            auto* c = jobs.front();
+            jobs.pop_front();
+            lock.unlock();
+            bool ok = true;
+            for(size_t pos = 0; ok && pos < c->size;) {
+                auto written = ::write(file_des, c->data.get() + pos, c->size - pos);
+                ok = written > 0;
+                pos += ok ? written : 0;
+            }
+            c->size = 0;
+            lock.lock();
+            failed |= !ok;
+            free_list.push_back(c);
+            free_cond.notify_one();
+        }
+    }
+
+    std::string const file_name;
+    size_t const chunk_size;
+    size_t const max_chunks;
+    bool const padded;
+    int file_des{-1};
+    uint64_t block_count{0};
+    std::vector<std::unique_ptr<chunk>> chunks;
+    chunk* current{nullptr};
+    std::deque<chunk*> jobs;
+    std::vector<chunk*> free_list;
+    std::mutex mtx;
+    std::condition_variable job_cond;
+    std::condition_variable free_cond;
+    bool done{false};
+    bool failed{false};
+    std::thread writer;
+};
 
-    ~ControlBuffer() { close(file_des); }
+struct ControlBuffer {
+    ControlBuffer(const boost::filesystem::path& name)
+    : file(name, 64 * 1024, false) {}
 
     uint64_t getIdOf(const std::string& str) {
         auto strid = std::hash<std::string>{}(str);
-        if(lookup.find(strid) == lookup.end()) {
-            ByteBufferWriter bw(sizeof(uint32_t) + sizeof(strid) + sizeof(uint32_t) + str.length());
-            bw.append<uint32_t>(1U).append(strid).append<uint32_t>(str.length()).append(str).write(file_des);
-            lookup.insert(strid);
+        if(lookup.insert(strid).second) {
+            // type(4)=1, id(8), length(4), value(...)
+            std::array<unsigned char, sizeof(uint32_t) + sizeof(strid) + sizeof(uint32_t)> hdr;
+            RecordWriter(hdr.data()).append<uint32_t>(1U).append(strid).append<uint32_t>(str.length());
+            file.write(hdr.data(), hdr.size());
+            file.write(reinterpret_cast<const unsigned char*>(str.data()), str.length());
         }
         return strid;
     }
+    /**
+     * interns a string by its address, may only be used for strings with static storage like literals or enum names
+     */
+    uint64_t getIdOf(const char* str) {
+        auto it = static_lookup.find(str);
+        if(it != static_lookup.end())
+            return it->second;
+        auto strid = getIdOf(std::string(str));
+        static_lookup.insert({str, strid});
+        return strid;
+    }
 
     void writeStream(uint64_t id, std::string& name, std::string& kind) {
-        ByteBufferWriter bw;
-        bw.append<uint32_t>(2U).append(id).append(getIdOf(name)).append(getIdOf(kind)).write(file_des);
+        std::array<unsigned char, sizeof(uint32_t) + 3 * sizeof(uint64_t)> rec;
+        RecordWriter(rec.data()).append<uint32_t>(2U).append(id).append(getIdOf(name)).append(getIdOf(kind));
+        file.write(rec.data(), rec.size());
     }
 
     void writeGenerator(uint64_t id, std::string& name, uint64_t stream) {
-        ByteBufferWriter bw;
-        bw.append<uint32_t>(3U).append(id).append(getIdOf(name)).append(stream).write(file_des);
+        std::array<unsigned char, sizeof(uint32_t) + 3 * sizeof(uint64_t)> rec;
+        RecordWriter(rec.data()).append<uint32_t>(3U).append(id).append(getIdOf(name)).append(stream);
+        file.write(rec.data(), rec.size());
     }
 
 private:
-    int file_des = 0;
+    ChunkedFile file;
     std::unordered_set<uint64_t> lookup;
+    std::unordered_map<const char*, uint64_t> static_lookup;
 };
 
 class DataBuffer {
 public:
-    DataBuffer(const boost::filesystem::path& name) { file_des = open(name.string().c_str(), open_flags, open_mode); }
-
-    ~DataBuffer() {
-        if(bufTail > 0) {
-            std::fill(buf.data() + bufTail, buf.data() + buf.size(), 0);
-            write(file_des, buf.data(), buf.size());
-        }
-        close(file_des);
-    }
+    DataBuffer(const boost::filesystem::path& name)
+    : file(name, 1024 * 1024, true) {}
 
     uint64_t writeTx(uint64_t id, uint64_t generator, uint64_t concurrencyLevel) {
         // type(4)=1, id(8), generator(8),concurrencyLevel(4)
-        ByteBufferWriter bw;
-        bw.append<uint32_t>(1U).append(id).append(generator).append(concurrencyLevel);
-        return append(bw(), bw.length());
+        uint64_t offset;
+        auto* p = file.reserve(sizeof(uint32_t) + 3 * sizeof(uint64_t), offset);
+        RecordWriter(p).append<uint32_t>(1U).append(id).append(generator).append(concurrencyLevel);
+        return offset;
     }
 
     void writeAttribute(uint64_t id, EventType event, uint64_t name, data_type typ, uint64_t value) {
         // type(4)=2, tx_id(8),type(2),name(8),data_type(2),data_value(8)
-        ByteBufferWriter bw;
-        bw.append<uint32_t>(2U).append(id).append(event).append(name).append(static_cast<uint16_t>(typ)).append(value);
-        append(bw(), bw.length());
+        uint64_t offset;
+        auto* p = file.reserve(sizeof(uint32_t) + sizeof(id) + sizeof(event) + sizeof(name) + sizeof(uint16_t) +
+                                   sizeof(value),
+                               offset);
+        RecordWriter(p).append<uint32_t>(2U).append(id).append(event).append(name).append(static_cast<uint16_t>(typ)).append(value);
     }
 
     void writeAttribute(uint64_t id, EventType event, uint64_t name, data_type typ, uint64_t value0, uint32_t value1) {
         // type(4)=3, tx_id(8),type(2),name(8),data_type(2),data_value(8)
-        ByteBufferWriter bw;
-        bw.append<uint32_t>(3U)
+        uint64_t offset;
+        auto* p = file.reserve(sizeof(uint32_t) + sizeof(id) + sizeof(event) + sizeof(name) + sizeof(uint16_t) +
+                                   sizeof(value0) + sizeof(value1),
+                               offset);
+        RecordWriter(p)
+            .append<uint32_t>(3U)
             .append(id)
             .append(event)
             .append(name)
             .append(static_cast<uint16_t>(typ))
             .append(value0)
             .append(value1);
-        append(bw(), bw.length());
     }
 
     void writeRelation(uint64_t name, uint64_t src, uint64_t sink) {
         // type(4)=4, id(8), src(8), tgt(8)
-        ByteBufferWriter bw;
-        bw.append<uint32_t>(4U).append(name).append(src).append(sink);
-        append(bw(), bw.length());
-    }
-    /**
-     * returns the offset of the record
-     */
-    template <typename T> uint64_t append(const T& val) {
-        return append(reinterpret_cast<const unsigned char*>(&val), sizeof(T));
+        uint64_t offset;
+        auto* p = file.reserve(sizeof(uint32_t) + 3 * sizeof(uint64_t), offset);
+        RecordWriter(p).append<uint32_t>(4U).append(name).append(src).append(sink);
     }
 
-    uint64_t getActualFilePos() { return blockCount * buf.size() + bufTail; }
-
 private:
-    uint64_t append(const unsigned char* p, size_t len) {
-        if((bufTail + len) > buf.size()) {
-            std::fill(buf.data() + bufTail, buf.data() + buf.size(), 0);
-            auto written = write(file_des, buf.data(), buf.size());
-            if(written != buf.size())
-                throw std::runtime_error("not written"); // TODO: implement error handling
-            blockCount++;
-            bufTail = 0;
-        }
-        uint64_t ret = blockCount * buf.size() + bufTail;
-        std::copy(p, p + len, buf.data() + bufTail);
-        bufTail += len;
-        return ret;
-    }
-
-    int file_des = 0;
-    size_t blockCount = 0;
-    size_t bufTail = 0;
-    std::array<unsigned char, 1024 * 1024> buf;
+    ChunkedFile file;
 };
 
 struct TimingBuffer {
-    TimingBuffer(const boost::filesystem::path& name) { file_des = open(name.string().c_str(), open_flags, open_mode); }
-
-    ~TimingBuffer() {
-        if(bufTail > 0) {
-            std::fill(buf.data() + bufTail, buf.data() + buf.size(), 0);
-            write(file_des, buf.data(), buf.size());
-        }
-        close(file_des);
-    }
+    TimingBuffer(const boost::filesystem::path& name)
+    : file(name, 20 * 1024, true) {}
 
     void append(uint32_t type, uint64_t time, uint64_t file_offset) {
-        const size_t len = sizeof(type) + sizeof(time) + sizeof(file_offset);
-        if((bufTail + len) > buf.size()) {
-            std::fill(buf.data() + bufTail, buf.data() + buf.size(), 0);
-            ssize_t written = write(file_des, buf.data(), buf.size());
-            if(written != buf.size())
-                throw std::runtime_error("not written"); // TODO: implement error handling
-            bufTail = 0;
-        }
-        ByteBufferWriter bw(len);
-        bw.append(type).append(time).append(file_offset);
-        std::copy(bw(), bw() + bw.length(), buf.data() + bufTail);
-        bufTail += len;
+        uint64_t offset;
+        auto* p = file.reserve(sizeof(type) + sizeof(time) + sizeof(file_offset), offset);
+        RecordWriter(p).append(type).append(time).append(file_offset);
     }
 
 private:
-    int file_des = 0;
-    size_t bufTail = 0;
-    std::array<unsigned char, 20 * 1024> buf;
+    ChunkedFile file;
 };
 
 class Base {
@@ -280,6 +405,8 @@ struct Database : Base {
 
     inline uint64_t getIdOf(const std::string& str) { return c.getIdOf(str); }
 
+    inline uint64_t getIdOf(const char* str) { return c.getIdOf(str); }
+
     inline void writeStream(uint64_t id, std::string name, std::string kind) { c.writeStream(id, name, kind); }
 
     inline void writeGenerator(uint64_t id, std::string name, uint64_t stream) { c.writeGenerator(id, name, stream); }
@@ -292,22 +419,39 @@ struct Database : Base {
         t.append(type, time, file_offset);
     }
 
-    inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, const string& value) {
-        d.writeAttribute(id, event, c.getIdOf(name), type, c.getIdOf(value));
+    inline void writeAttribute(uint64_t id, EventType event, uint64_t name, data_type type, const string& value) {
+        d.writeAttribute(id, event, name, type, c.getIdOf(value));
+    }
+
+    inline void writeAttribute(uint64_t id, EventType event, uint64_t name, data_type type, const char* value) {
+        d.writeAttribute(id, event, name, type, c.getIdOf(value));
     }
 
-    inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, uint64_t value) {
-        d.writeAttribute(id, event, c.getIdOf(name), type, value);
+    inline void writeAttribute(uint64_t id, EventType event, uint64_t name, data_type type, uint64_t value) {
+        d.writeAttribute(id, event, name, type, value);
     }
 
-    inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, double value) {
+    inline void writeAttribute(uint64_t id, EventType event, uint64_t name, data_type type, double value) {
         //        int exponent;
         //        const double mantissa = frexp(value, &exponent);
     }
 
-    inline void writeRelation(const std::string& name, uint64_t sink_id, uint64_t src_id) {
-        d.writeRelation(c.getIdOf(name), src_id, sink_id);
+    inline void writeRelation(scv_tr_relation_handle_t relation, const char* name, uint64_t sink_id, uint64_t src_id) {
+        auto it = relation_ids.find(relation);
+        if(it == relation_ids.end())
+            it = relation_ids.insert({relation, c.getIdOf(std::string(name))}).first;
+        d.writeRelation(it->second, src_id, sink_id);
     }
+    /**
+     * returns the ids of the flattened attribute names of a generator, they are filled upon the first transaction
+     */
+    inline std::vector<uint64_t>& getAttributeNameIds(uint64_t generator, EventType event) {
+        return attribute_names[generator][event == BEGIN ? 0 : 1];
+    }
+
+private:
+    std::unordered_map<scv_tr_relation_handle_t, uint64_t> relation_ids;
+    std::unordered_map<uint64_t, std::array<std::vector<uint64_t>, 2>> attribute_names;
 };
 
 vector<vector<uint64_t>*> concurrencyLevel;
@@ -349,7 +493,7 @@ void streamCb(const scv_tr_stream& s, scv_tr_stream::callback_reason reason, voi
     }
 }
 // ----------------------------------------------------------------------------
-void recordAttribute(uint64_t id, EventType event, const string& name, data_type type, const string& value) {
+template <typename T> inline void recordAttribute(uint64_t id, EventType event, uint64_t name, data_type type, T value) {
     try {
         db->writeAttribute(id, event, name, type, value);
     } catch(std::runtime_error& e) {
@@ -357,84 +501,91 @@ void recordAttribute(uint64_t id, EventType event, const string& name, data_type
     }
 }
 // ----------------------------------------------------------------------------
-void recordAttribute(uint64_t id, EventType event, const string& name, data_type type, long long value) {
-    try {
-        db->writeAttribute(id, event, name, type, static_cast<uint64_t>(value));
-    } catch(std::runtime_error& e) {
-        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create attribute entry");
-    }
-}
-// ----------------------------------------------------------------------------
-inline void recordAttribute(uint64_t id, EventType event, const string& name, data_type type, double value) {
-    try {
-        db->writeAttribute(id, event, name, type, value);
-    } catch(std::runtime_error& e) {
-        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create attribute entry");
-    }
-}
+/**
+ * the ids of the attribute names of a transaction. If names is set the ids are cached there in the order of traversal,
+ * subsequent transactions of the same generator use them instead of building and hashing the name strings
+ */
+struct AttributeNames {
+    std::vector<uint64_t>* names;
+    size_t idx;
+};
 // ----------------------------------------------------------------------------
-void recordAttributes(uint64_t id, EventType eventType, string& prefix, const scv_extensions_if* my_exts_p) {
+void recordAttributes(uint64_t id, EventType eventType, string& prefix, const scv_extensions_if* my_exts_p,
+                      AttributeNames& attr_names) {
     if(my_exts_p == nullptr)
         return;
-    string name;
-    if(prefix == "") {
-        name = my_exts_p->get_name();
-    } else {
-        if((my_exts_p->get_name() == nullptr) || (strlen(my_exts_p->get_name()) == 0)) {
-            name = prefix;
+    auto name = [&]() -> uint64_t {
+        if(attr_names.names && attr_names.idx < attr_names.names->size())
+            return (*attr_names.names)[attr_names.idx++];
+        string name;
+        if(prefix == "") {
+            name = my_exts_p->get_name();
         } else {
-            name = prefix + "." + my_exts_p->get_name();
+            if((my_exts_p->get_name() == nullptr) || (strlen(my_exts_p->get_name()) == 0)) {
+                name = prefix;
+            } else {
+                name = prefix + "." + my_exts_p->get_name();
+            }
         }
-    }
-    if(name == "")
-        name = "<unnamed>";
+        if(name == "")
+            name = "<unnamed>";
+        auto ret = db->getIdOf(name);
+        if(attr_names.names) {
+            attr_names.names->push_back(ret);
+            attr_names.idx++;
+        }
+        return ret;
+    };
     switch(my_exts_p->get_type()) {
     case scv_extensions_if::RECORD: {
         int num_fields = my_exts_p->get_num_fields();
         if(num_fields > 0) {
             for(int field_counter = 0; field_counter < num_fields; field_counter++) {
                 const scv_extensions_if* field_data_p = my_exts_p->get_field(field_counter);
-                recordAttributes(id, eventType, prefix, field_data_p);
+                recordAttributes(id, eventType, prefix, field_data_p, attr_names);
             }
         }
     } break;
     case scv_extensions_if::ENUMERATION:
-        recordAttribute(id, eventType, name, scv_extensions_if::ENUMERATION,
+        recordAttribute(id, eventType, name(), scv_extensions_if::ENUMERATION,
                         my_exts_p->get_enum_string((int)(my_exts_p->get_integer())));
         break;
     case scv_extensions_if::BOOLEAN:
-        recordAttribute(id, eventType, name, scv_extensions_if::BOOLEAN, my_exts_p->get_bool() ? "TRUE" : "FALSE");
+        recordAttribute(id, eventType, name(), scv_extensions_if::BOOLEAN, my_exts_p->get_bool() ? "TRUE" : "FALSE");
         break;
     case scv_extensions_if::INTEGER:
     case scv_extensions_if::FIXED_POINT_INTEGER:
-        recordAttribute(id, eventType, name, scv_extensions_if::INTEGER, my_exts_p->get_integer());
+        recordAttribute(id, eventType, name(), scv_extensions_if::INTEGER,
+                        static_cast<uint64_t>(my_exts_p->get_integer()));
         break;
     case scv_extensions_if::UNSIGNED:
-        recordAttribute(id, eventType, name, scv_extensions_if::UNSIGNED, my_exts_p->get_integer());
+        recordAttribute(id, eventType, name(), scv_extensions_if::UNSIGNED,
+                        static_cast<uint64_t>(my_exts_p->get_integer()));
         break;
     case scv_extensions_if::POINTER:
-        recordAttribute(id, eventType, name, scv_extensions_if::POINTER, (long long)my_exts_p->get_pointer());
+        recordAttribute(id, eventType, name(), scv_extensions_if::POINTER,
+                        static_cast<uint64_t>((long long)my_exts_p->get_pointer()));
         break;
     case scv_extensions_if::STRING:
-        recordAttribute(id, eventType, name, scv_extensions_if::STRING, my_exts_p->get_string());
+        recordAttribute(id, eventType, name(), scv_extensions_if::STRING, my_exts_p->get_string());
         break;
     case scv_extensions_if::FLOATING_POINT_NUMBER:
-        recordAttribute(id, eventType, name, scv_extensions_if::FLOATING_POINT_NUMBER, my_exts_p->get_double());
+        recordAttribute(id, eventType, name(), scv_extensions_if::FLOATING_POINT_NUMBER, my_exts_p->get_double());
         break;
     case scv_extensions_if::BIT_VECTOR: {
         sc_bv_base tmp_bv(my_exts_p->get_bitwidth());
         my_exts_p->get_value(tmp_bv);
-        recordAttribute(id, eventType, name, scv_extensions_if::BIT_VECTOR, tmp_bv.to_string());
+        recordAttribute(id, eventType, name(), scv_extensions_if::BIT_VECTOR, tmp_bv.to_string());
     } break;
     case scv_extensions_if::LOGIC_VECTOR: {
         sc_lv_base tmp_lv(my_exts_p->get_bitwidth());
         my_exts_p->get_value(tmp_lv);
-        recordAttribute(id, eventType, name, scv_extensions_if::LOGIC_VECTOR, tmp_lv.to_string());
+        recordAttribute(id, eventType, name(), scv_extensions_if::LOGIC_VECTOR, tmp_lv.to_string());
     } break;
     case scv_extensions_if::ARRAY:
         for(int array_elt_index = 0; array_elt_index < my_exts_p->get_array_size(); array_elt_index++) {
             const scv_extensions_if* field_data_p = my_exts_p->get_array_elt(array_elt_index);
-            recordAttributes(id, eventType, prefix, field_data_p);
+            recordAttributes(id, eventType, prefix, field_data_p, attr_names);
         }
         break;
     default: {
@@ -475,7 +626,7 @@ void transactionCb(const scv_tr_handle& t, scv_tr_handle::callback_reason reason
             vector<uint64_t>* levels = concurrencyLevel.at(streamId);
             if(levels == nullptr) {
                 levels = new vector<uint64_t>();
-                concurrencyLevel[id] = levels;
+                concurrencyLevel[streamId] = levels;
             }
             for(concurrencyIdx = 0; concurrencyIdx < levels->size(); ++concurrencyIdx)
                 if((*levels)[concurrencyIdx] == 0)
@@ -497,7 +648,8 @@ void transactionCb(const scv_tr_handle& t, scv_tr_handle::callback_reason reason
             string tmp_str = t.get_scv_tr_generator_base().get_begin_attribute_name()
                                  ? t.get_scv_tr_generator_base().get_begin_attribute_name()
                                  : "";
-            recordAttributes(id, BEGIN, tmp_str, my_exts_p);
+            AttributeNames attr_names{&db->getAttributeNameIds(t.get_scv_tr_generator_base().get_id(), BEGIN), 0};
+            recordAttributes(id, BEGIN, tmp_str, my_exts_p, attr_names);
         }
     } break;
     case scv_tr_handle::END: {
@@ -522,7 +674,8 @@ void transactionCb(const scv_tr_handle& t, scv_tr_handle::callback_reason reason
             string tmp_str = t.get_scv_tr_generator_base().get_end_attribute_name()
                                  ? t.get_scv_tr_generator_base().get_end_attribute_name()
                                  : "";
-            recordAttributes(t.get_id(), END, tmp_str, my_exts_p);
+            AttributeNames attr_names{&db->getAttributeNameIds(t.get_scv_tr_generator_base().get_id(), END), 0};
+            recordAttributes(t.get_id(), END, tmp_str, my_exts_p, attr_names);
         }
     } break;
     default:;
@@ -537,7 +690,8 @@ void attributeCb(const scv_tr_handle& t, const char* name, const scv_extensions_
     if(t.get_scv_tr_stream().get_scv_tr_db()->get_recording() == false)
         return;
     string tmp_str(name == nullptr ? "" : name);
-    recordAttributes(t.get_id(), RECORD, tmp_str, ext);
+    AttributeNames attr_names{nullptr, 0};
+    recordAttributes(t.get_id(), RECORD, tmp_str, ext, attr_names);
 }
 // ----------------------------------------------------------------------------
 void relationCb(const scv_tr_handle& tr_1, const scv_tr_handle& tr_2, void* data,
@@ -549,7 +703,8 @@ void relationCb(const scv_tr_handle& tr_1, const scv_tr_handle& tr_2, void* data
     if(tr_1.get_scv_tr_stream().get_scv_tr_db()->get_recording() == false)
         return;
     try {
-        db->writeRelation(tr_1.get_scv_tr_stream().get_scv_tr_db()->get_relation_name(relation_handle), tr_1.get_id(),
+        db->writeRelation(relation_handle,
+                          tr_1.get_scv_tr_stream().get_scv_tr_db()->get_relation_name(relation_handle), tr_1.get_id(),
                           tr_2.get_id());
     } catch(std::runtime_error& e) {
         _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create transaction relation");
@@ -16,6 +16,9 @@
 
 #ifndef _SCC_SCV_TR_DB_H_
 #define _SCC_SCV_TR_DB_H_
+
+#include <cstddef>
+#include <cstdint>
 #ifndef HAS_SCV
 namespace scv_tr {
 #endif
@@ -42,6 +45,27 @@ void scv_tr_compressed_init();
  *
  */
 void scv_tr_plain_init();
+/**
+ * @fn void scv_tr_set_rotation(uint64_t, uint64_t)
+ * @brief enables the rotation of the plain text and LZ4 compressed transaction recording database into segments. Each
+ * segment is a standalone database, the segments are listed in a JSON manifest named after the database. Needs to be
+ * called before the database is created.
+ *
+ * @param max_size the (uncompressed) size of a segment in bytes, 0 means no size limit
+ * @param max_time the duration of a segment in ps, 0 means no time limit
+ */
+void scv_tr_set_rotation(uint64_t max_size, uint64_t max_time);
+/**
+ * @fn void scv_tr_set_attribute_dictionary(bool)
+ * @brief selects the version 2 of the plain text, LZ4 compressed and shared memory transaction recording database.
+ * Recorded attribute names are written once as attribute_name records and referred to by their ID instead of being
+ * repeated in each tx_record_attribute record. Files of version 2 start with a 'scv_tr_format_version 2' line, readers
+ * of the SCV text format need them to be converted using util::txlog_reader. Needs to be called before the database is
+ * created.
+ *
+ * @param enable if true the attribute dictionary is used, the default is false
+ */
+void scv_tr_set_attribute_dictionary(bool enable);
 #ifdef WITH_LZ4
 /**
  * @fn void scv_tr_lz4_init()
@@ -55,10 +79,23 @@ void scv_tr_lz4_init();
 /**
  * @fn void scv_tr_mtc_init()
  * @brief initializes the infrastructure to use a compressed text based transaction recording database with a
- * multithreaded writer
+ * multithreaded writer. The simulation thread only serializes the transactions, formatting and LZ4 compression is done
+ * by worker threads. If LZ4 is not available the text is written uncompressed.
  *
  */
 void scv_tr_mtc_init();
+/**
+ * @fn void scv_tr_shm_init(size_t, bool)
+ * @brief initializes the infrastructure to publish the transactions in the text format of scv_tr_lz4_init() into a
+ * POSIX shared memory ring buffer named after the database (see util::shm_ring_writer) so that a local consumer can
+ * follow the simulation live. No file is written. The simulation never waits for the consumer, if the ring is full
+ * records are dropped or overwritten and counted in the ring header. A consumer may request a snapshot holding the
+ * stream, generator and attribute name definitions and the begin of all open transactions.
+ *
+ * @param capacity the size of the ring buffer in bytes
+ * @param overwrite if true the oldest records are overwritten if the ring is full, otherwise new records are dropped
+ */
+void scv_tr_shm_init(size_t capacity = 16 * 1024 * 1024, bool overwrite = false);
 
 #ifdef USE_EXTENDED_DB
 /**
@@ -69,6 +106,16 @@ void scv_tr_binary_init();
  * initializes the infrastructure to use a LevelDB based transaction recording database
  */
 void scv_tr_ldb_init();
+/**
+ * @fn void scv_tr_ldb_set_options(bool, size_t, size_t)
+ * @brief configures the LevelDB based transaction recording database. Needs to be called before the database is
+ * created.
+ *
+ * @param compression use snappy compression of the table files
+ * @param block_cache_size the size of the LRU block cache in bytes, 0 selects the LevelDB default
+ * @param write_buffer_size the size of the memtable in bytes before it is converted to a table file
+ */
+void scv_tr_ldb_set_options(bool compression, size_t block_cache_size, size_t write_buffer_size);
 
 #endif
 #ifndef HAS_SCV
@@ -13,22 +13,26 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  *******************************************************************************/
+#include "leveldb/cache.h"
 #include "leveldb/db.h"
-#include <json/json.h>
+#include "leveldb/write_batch.h"
 
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
-#include <fcntl.h>
-#include <iomanip>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 // clang-format off
 #include "scv/scv_util.h"
@@ -39,59 +43,103 @@
 // ----------------------------------------------------------------------------
 using namespace std;
 using namespace leveldb;
-using namespace Json;
-
-#ifdef _MSC_VER
-#define scv_tr_TEXT_LLU "%I64u"
-#define scv_tr_TEXT_LLX "%I64x"
-#define scv_tr_TEXT_16LLX "%016I64x"
-#else
-#define scv_tr_TEXT_LLU "%llu"
-#define scv_tr_TEXT_LLX "%llx"
-#define scv_tr_TEXT_16LLX "%016lx"
-#endif
-
+/**
+ * Key/value layout, all numbers in keys are 64bit big endian so that the keys sort numerically, numbers in values are
+ * 64bit little endian (fixed) or LEB128 (varint), strings are a varint length followed by the characters:
+ *
+ * key                                  value
+ * "__config"                           time resolution in fs(fixed)
+ * 's' stream                           name(str), kind(str)
+ * 'g' stream generator                 name(str)
+ * 'c' stream generator tx              - (the transactions of a generator)
+ * 't' stream time type(1) tx           - (the begin (0) and end (2) events of a stream ordered by time)
+ * 'x' tx                               the transaction record:
+ *                                          start time(fixed), end time(fixed), stream(varint), generator(varint),
+ *                                          concurrency level(varint) followed by the attributes:
+ *                                          event(1), data type(1), name(str), value kind(1), value(fixed or str)
+ * 'o' src sink name                    - (outgoing relation)
+ * 'i' sink src name                    - (incoming relation)
+ */
 // ----------------------------------------------------------------------------
 enum EventType { BEGIN, RECORD, END };
-const char* EventTypeStr[] = {"BEGIN", "RECORD", "END"};
 using data_type = scv_extensions_if::data_type;
 // ----------------------------------------------------------------------------
 namespace {
+enum ValueKind : char { INTEGER_VALUE, REAL_VALUE, STRING_VALUE };
+
+struct DbOptions {
+    bool compression{true};
+    size_t block_cache_size{8 * 1024 * 1024};
+    size_t write_buffer_size{4 * 1024 * 1024};
+} db_options;
+
+inline void putKey(string& s, uint64_t v) {
+    char buf[8];
+    for(auto i = 0; i < 8; ++i)
+        buf[i] = static_cast<char>(v >> (56 - 8 * i));
+    s.append(buf, 8);
+}
+
+inline void putFixed(string& s, uint64_t v) {
+    char buf[8];
+    for(auto i = 0; i < 8; ++i)
+        buf[i] = static_cast<char>(v >> (8 * i));
+    s.append(buf, 8);
+}
+
+inline void putVarint(string& s, uint64_t v) {
+    while(v >= 0x80) {
+        s.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    s.push_back(static_cast<char>(v));
+}
+
+inline void putString(string& s, const string& v) {
+    putVarint(s, v.size());
+    s.append(v);
+}
 
 struct Database {
+    //! the size in bytes after which a batch is handed over to the writer thread
+    static const size_t batch_size = 4 * 1024 * 1024;
+    //! the maximum time a record stays in the batch of the simulation thread
+    static constexpr std::chrono::milliseconds flush_interval{100};
+    //! the number of batches which may be pending before the simulation thread waits
+    static const size_t max_pending = 4;
 
-    Database(const string& name)
-    : key_len(1024) {
-        wbuilder.settings_["indentation"] = "";
-        CharReaderBuilder::strictMode(&rbuilder.settings_);
+    Database(const string& name) {
         Options options;
         options.create_if_missing = true;
-        options.compression = kSnappyCompression;
+        options.compression = db_options.compression ? kSnappyCompression : kNoCompression;
+        options.write_buffer_size = db_options.write_buffer_size;
+        if(db_options.block_cache_size) {
+            cache.reset(NewLRUCache(db_options.block_cache_size));
+            options.block_cache = cache.get();
+        }
         DestroyDB(name, options);
         if(!DB::Open(options, name, &db).ok())
             throw runtime_error("Could not create database");
-        key_buf = new char[key_len];
+        current = acquire();
+        last_flush = std::chrono::steady_clock::now();
+        writer = std::thread([this]() { run(); });
     }
 
     ~Database() {
+        submit();
+        {
+            lock_type lock(mtx);
+            done = true;
+        }
+        cond.notify_all();
+        writer.join();
         delete db;
-        delete key_buf;
     }
-    /**
-     *
-     * @param key   the database key
-     * @param val   the JSON Value to write
-     */
-    inline bool writeEntry(string& key, Value& val) {
-        return db->Put(write_options, Slice(key.c_str(), key.size()), writeString(wbuilder, val)).ok();
-    }
-    /**
-     *
-     * @param key   the database key
-     * @param val   the JSON Value to write
-     */
-    inline bool writeEntry(string&& key, Value& val) {
-        return db->Put(write_options, Slice(key.c_str(), key.size()), writeString(wbuilder, val)).ok();
+
+    inline void writeConfig(uint64_t resolution) {
+        value.clear();
+        putFixed(value, resolution);
+        put("__config", value);
     }
     /**
      *
@@ -100,12 +148,12 @@ struct Database {
      * @param kind  stream kind
      */
     inline void writeStream(uint64_t id, string name, string kind) {
-        auto len = sprintf(key_buf, "s~" scv_tr_TEXT_16LLX, id);
-        Value node{objectValue};
-        node["id"] = id;
-        node["name"] = name;
-        node["kind"] = kind;
-        db->Put(write_options, Slice(key_buf, len), writeString(wbuilder, node));
+        key.assign(1, 's');
+        putKey(key, id);
+        value.clear();
+        putString(value, name);
+        putString(value, kind);
+        put(key, value);
     }
     /**
      *
@@ -114,12 +162,12 @@ struct Database {
      * @param stream
      */
     inline void writeGenerator(uint64_t id, string name, uint64_t stream) {
-        auto len = sprintf(key_buf, "sg~" scv_tr_TEXT_16LLX "~" scv_tr_TEXT_16LLX, stream, id);
-        Value node{objectValue};
-        node["id"] = id;
-        node["name"] = name;
-        node["stream"] = stream;
-        db->Put(write_options, Slice(key_buf, len), writeString(wbuilder, node));
+        key.assign(1, 'g');
+        putKey(key, stream);
+        putKey(key, id);
+        value.clear();
+        putString(value, name);
+        put(key, value);
     }
     /**
      *
@@ -128,17 +176,19 @@ struct Database {
      * @param concurrencyLevel
      */
     inline void writeTransaction(uint64_t id, uint64_t stream_id, uint64_t generator_id, uint64_t concurrencyLevel) {
-        Value val{objectValue};
-        val["id"] = id;
-        val["s"] = stream_id;
-        val["g"] = generator_id;
-        val["conc"] = concurrencyLevel;
-        db->Put(write_options,
-                Slice(key_buf, sprintf(key_buf, "sgx~" scv_tr_TEXT_16LLX "~" scv_tr_TEXT_16LLX "~" scv_tr_TEXT_16LLX,
-                                       stream_id, generator_id, id)),
-                "");
-        tx_lut[id] = val;
-        // db->Put(write_options, Slice(key, sprintf(key, "x~" scv_tr_TEXT_16LLX, id)), writeString(wbuilder, val));
+        key.assign(1, 'c');
+        putKey(key, stream_id);
+        putKey(key, generator_id);
+        putKey(key, id);
+        put(key, Slice());
+        // the record is completed when the transaction ends, the times are filled in by writeTxTimepoint
+        auto& rec = tx_lut[id];
+        rec.clear();
+        putFixed(rec, 0);
+        putFixed(rec, 0);
+        putVarint(rec, stream_id);
+        putVarint(rec, generator_id);
+        putVarint(rec, concurrencyLevel);
     }
     /**
      *
@@ -148,44 +198,24 @@ struct Database {
      * @param time
      */
     inline void writeTxTimepoint(uint64_t id, uint64_t streamid, EventType type, uint64_t time) {
-        string value;
-        Value node{arrayValue};
-        auto len =
-            sprintf(key_buf, "st~" scv_tr_TEXT_16LLX "~" scv_tr_TEXT_16LLX "~%s", streamid, time, EventTypeStr[type]);
-        if(db->Get(read_options, key_buf, &value).ok() &&
-           rbuilder.newCharReader()->parse(value.data(), value.data() + value.size(), &node, nullptr)) {
-            node[node.size()] = Value(id);
-        } else {
-            node[0u] = Value(id);
-        }
-        db->Put(write_options, Slice(key_buf, len), writeString(wbuilder, node));
-        updateTx(id, type, time);
-    }
-
-    inline void updateTx(uint64_t id, EventType type, uint64_t time) {
-        static const char* typeStr[] = {"START_TIME", "", "END_TIME"};
-        auto& node = tx_lut[id];
-        node[typeStr[type]] = time;
+        key.assign(1, 't');
+        putKey(key, streamid);
+        putKey(key, time);
+        key.push_back(static_cast<char>(type));
+        putKey(key, id);
+        put(key, Slice());
+        auto it = tx_lut.find(id);
+        if(it == tx_lut.end())
+            return;
+        for(auto i = 0; i < 8; ++i)
+            it->second[(type == END ? 8 : 0) + i] = static_cast<char>(time >> (8 * i));
         if(type == END) {
-            db->Put(write_options, Slice(key_buf, sprintf(key_buf, "x~" scv_tr_TEXT_16LLX, id)),
-                    writeString(wbuilder, node));
-            tx_lut.erase(id);
+            key.assign(1, 'x');
+            putKey(key, id);
+            put(key, it->second);
+            tx_lut.erase(it);
         }
     }
-
-    inline void updateTx(uint64_t id, Value&& val) {
-        auto len = sprintf(key_buf, "x~" scv_tr_TEXT_16LLX, id);
-        auto& node = tx_lut[id];
-        auto& arrNode = node["attr"];
-        if(arrNode.isNull()) {
-            Value newNode{arrayValue};
-            newNode.append(val);
-            node["attr"] = newNode;
-        } else {
-            arrNode.append(val);
-        }
-    }
-
     /**
      *
      * @param id        transaction id
@@ -195,12 +225,8 @@ struct Database {
      * @param value
      */
     inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, const string& value) {
-        Value val;
-        val["name"] = name;
-        val["type"] = type;
-        val["value"] = value;
-        val["assoc"] = event;
-        updateTx(id, move(val));
+        if(auto* rec = attributeRecord(id, event, name, type, STRING_VALUE))
+            putString(*rec, value);
     }
     /**
      *
@@ -211,12 +237,8 @@ struct Database {
      * @param value
      */
     inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, uint64_t value) {
-        Value val;
-        val["name"] = name;
-        val["type"] = type;
-        val["value"] = value;
-        val["assoc"] = event;
-        updateTx(id, move(val));
+        if(auto* rec = attributeRecord(id, event, name, type, INTEGER_VALUE))
+            putFixed(*rec, value);
     }
     /**
      *
@@ -227,12 +249,11 @@ struct Database {
      * @param value
      */
     inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, double value) {
-        Value val;
-        val["name"] = name;
-        val["type"] = type;
-        val["value"] = value;
-        val["assoc"] = event;
-        updateTx(id, move(val));
+        if(auto* rec = attributeRecord(id, event, name, type, REAL_VALUE)) {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            putFixed(*rec, bits);
+        }
     }
     /**
      *
@@ -241,32 +262,107 @@ struct Database {
      * @param src_id
      */
     inline void writeRelation(const string& name, uint64_t sink_id, uint64_t src_id) {
-        if(key_len < (name.size() + 32 + 5)) { // reallocate buffer if needed, making sure no buffer overflow
-            delete key_buf;
-            key_len = name.size() + 32 + 5;
-            key_buf = new char[key_len];
-        }
-        db->Put(write_options,
-                Slice(key_buf, sprintf(key_buf, "ro~" scv_tr_TEXT_16LLX "~" scv_tr_TEXT_16LLX "~%s", src_id, sink_id,
-                                       name.c_str())),
-                "");
-        db->Put(write_options,
-                Slice(key_buf, sprintf(key_buf, "ri~" scv_tr_TEXT_16LLX "~" scv_tr_TEXT_16LLX "~%s", sink_id, src_id,
-                                       name.c_str())),
-                "");
+        key.assign(1, 'o');
+        putKey(key, src_id);
+        putKey(key, sink_id);
+        key.append(name);
+        put(key, Slice());
+        key.assign(1, 'i');
+        putKey(key, sink_id);
+        putKey(key, src_id);
+        key.append(name);
+        put(key, Slice());
     }
 
 private:
-    DB* db;
-    ReadOptions read_options;
+    using lock_type = std::unique_lock<std::mutex>;
+
+    inline string* attributeRecord(uint64_t id, EventType event, const string& name, data_type type, ValueKind kind) {
+        auto it = tx_lut.find(id);
+        if(it == tx_lut.end())
+            return nullptr;
+        auto& rec = it->second;
+        rec.push_back(static_cast<char>(event));
+        rec.push_back(static_cast<char>(type));
+        putString(rec, name);
+        rec.push_back(kind);
+        return &rec;
+    }
+
+    inline void put(Slice const& k, Slice const& v) {
+        current->Put(k, v);
+        pending_bytes += k.size() + v.size();
+        // checking the time is comparably expensive so it is only done every 256 records
+        if(pending_bytes >= batch_size ||
+           (!(++puts & 0xff) && std::chrono::steady_clock::now() - last_flush >= flush_interval))
+            submit();
+    }
+
+    WriteBatch* acquire() {
+        lock_type lock(mtx);
+        if(free_list.empty()) {
+            if(batches.size() < max_pending + 1) {
+                batches.emplace_back(new WriteBatch);
+                return batches.back().get();
+            }
+            cond.wait(lock, [this]() -> bool { return !free_list.empty(); });
+        }
+        auto* b = free_list.back();
+        free_list.pop_back();
+        return b;
+    }
+
+    void submit() {
+        last_flush = std::chrono::steady_clock::now();
+        if(!pending_bytes)
+            return;
+        {
+            lock_type lock(mtx);
+            pending.push_back(current);
+        }
+        cond.notify_all();
+        pending_bytes = 0;
+        current = acquire();
+    }
+
+    void run() {
+        lock_type lock(mtx);
+        while(true) {
+            cond.wait(lock, [this]() -> bool { return done || !pending.empty(); });
+            if(pending.empty())
+                break;
+            auto* b = pending.front();
+            pending.pop_front();
+            lock.unlock();
+            if(!db->Write(write_options, b).ok())
+                _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't write to recording file");
+            b->Clear();
+            lock.lock();
+            free_list.push_back(b);
+            cond.notify_all();
+        }
+    }
+
+    DB* db{nullptr};
+    std::unique_ptr<Cache> cache;
     WriteOptions write_options;
-    char* key_buf;
-    size_t key_len;
-    StreamWriterBuilder wbuilder;
-    CharReaderBuilder rbuilder;
-    unordered_map<uint64_t, Value> tx_lut;
+    string key, value;
+    unordered_map<uint64_t, string> tx_lut;
+    vector<std::unique_ptr<WriteBatch>> batches;
+    WriteBatch* current{nullptr};
+    size_t pending_bytes{0};
+    unsigned puts{0};
+    std::chrono::steady_clock::time_point last_flush;
+    std::deque<WriteBatch*> pending;
+    vector<WriteBatch*> free_list;
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool done{false};
+    std::thread writer;
 };
 
+constexpr std::chrono::milliseconds Database::flush_interval;
+
 vector<vector<uint64_t>> concurrencyLevel;
 
 Database* db;
@@ -280,9 +376,7 @@ void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason, void*
             fName = _scv_tr_db.get_name();
         try {
             db = new Database(fName);
-            Value val{objectValue};
-            val["resolution"] = (long)(sc_get_time_resolution().to_seconds() * 1e15);
-            db->writeEntry("__config", val);
+            db->writeConfig((uint64_t)(sc_get_time_resolution().to_seconds() * 1e15));
         } catch(runtime_error& e) {
             _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, e.what());
         } catch(...) {
@@ -292,6 +386,7 @@ void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason, void*
     case scv_tr_db::DELETE:
         try {
             delete db;
+            db = nullptr;
         } catch(...) {
             _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't close recording file");
         }
@@ -523,3 +618,9 @@ void scv_tr_ldb_init() {
     scv_tr_handle::register_relation_cb(relationCb);
 }
 // ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+void scv_tr_ldb_set_options(bool compression, size_t block_cache_size, size_t write_buffer_size) {
+    db_options.compression = compression;
+    db_options.block_cache_size = block_cache_size;
+    db_options.write_buffer_size = write_buffer_size;
+}
@@ -21,6 +21,7 @@
 #include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -28,9 +29,11 @@
 #include <unordered_set>
 #include <vector>
 #include <fmt/format.h>
+#include <scc/trace/segment_manifest.hh>
 #ifdef WITH_LZ4
 #include <util/lz4_streambuf.h>
 #endif
+#include <util/shm_ring.h>
 // clang-format off
 #ifdef HAS_SCV
 #include <scv.h>
@@ -71,7 +74,14 @@ const std::array<char const*, scv_extensions_if::STRING+1> data_type_str={{
         "STRING"                        // string, std::string
 
 }};
-class PlainWriter {
+//! the behavior of writers without a live consumer
+struct FileWriter {
+    //! writers with a live consumer keep the definitions and open transactions to answer a resync request
+    static constexpr bool live = false;
+    inline bool resync_requested() { return false; }
+    inline void snapshot(std::string const&) {}
+};
+class PlainWriter : public FileWriter {
 public:
     std::ofstream out;
     PlainWriter(const std::string& name) : out(name) {}
@@ -81,7 +91,7 @@ public:
     bool is_open(){return out.is_open();}
 };
 #ifdef WITH_LZ4
-class LZ4Writer {
+class LZ4Writer : public FileWriter {
     std::ofstream ofs;
     std::unique_ptr<util::lz4c_steambuf> strbuf;
 public:
@@ -101,7 +111,69 @@ public:
     bool is_open(){return ofs.is_open();}
 };
 #endif
+struct {
+    size_t capacity{16 * 1024 * 1024};
+    util::shm::policy policy{util::shm::policy::DROP};
+} shm_options;
+/**
+ * Publishes the text records into a POSIX shared memory ring buffer named after the database (see
+ * util::shm::object_name()) instead of writing a file. Each record holds one or more complete lines. If the ring
+ * cannot be created an error is reported and nothing is published.
+ */
+class ShmWriter {
+    std::unique_ptr<util::shm_ring_writer> ring;
+public:
+    static constexpr bool live = true;
+    struct Publisher {
+        util::shm_ring_writer* ring{nullptr};
+        inline void write(char const* data, size_t size) { publish(ring, util::shm::DATA, data, size); }
+    } out;
+    ShmWriter(const std::string& name) {
+        try {
+            ring.reset(new util::shm_ring_writer(util::shm::object_name(name), shm_options.capacity,
+                                                 shm_options.policy, "txlog"));
+        } catch(std::runtime_error& e) {
+            SC_REPORT_ERROR("scv_tr_shm", e.what());
+        }
+        out.ring = ring.get();
+    }
+    bool is_open() { return ring != nullptr; }
+    inline bool resync_requested() { return ring && ring->resync_requested(); }
+    inline void snapshot(std::string const& state) {
+        publish(ring.get(), util::shm::SNAPSHOT, state.data(), state.size());
+    }
+    static inline void publish(util::shm_ring_writer* ring, util::shm::record_type type, char const* data,
+                               size_t size) {
+        if(ring)
+            try {
+                ring->write(type, data, size);
+            } catch(std::length_error& e) {
+                SC_REPORT_ERROR("scv_tr_shm", e.what());
+            }
+    }
+};
 
+/**
+ * Writes the SCV text format. By default attributes recorded during a transaction are written as by the SCV text
+ * database:
+ *
+ *     tx_record_attribute <tx id> "<name>" <data type> = <value>
+ *
+ * If the attribute dictionary is enabled (see scv_tr_set_attribute_dictionary()) the output starts with
+ *
+ *     scv_tr_format_version 2
+ *
+ * and recorded attributes do not repeat their name and type in each record. The first use of a name with a data type
+ * is announced by
+ *
+ *     attribute_name (ID <name id>, name "<name>", type "<data type>")
+ *
+ * and the attribute values are written as
+ *
+ *     r <tx id> <name id> <value>
+ *
+ * Readers not knowing version 2 need the file to be converted using util::txlog_reader.
+ */
 template<typename WRITER>
 struct Formatter {
     std::unique_ptr<WRITER> writer;
@@ -112,91 +184,257 @@ struct Formatter {
     {}
 
     inline bool open(const std::string& name) {
-        writer.reset(new WRITER(name));
-        return writer->is_open();
+        written = 0;
+        for(auto& ids : attribute_ids)
+            ids.clear();
+        attribute_ids_count = 0;
+        if(rotating()) {
+            manifest.reset(new scc::trace::segment_manifest(name + ".json", "txlog"));
+            auto pos = name.find_last_of('.');
+            auto ext = pos != std::string::npos && name.find_first_of("/\\", pos) == std::string::npos ? name.substr(pos) : "";
+            base_name = name.substr(0, name.size() - ext.size());
+            extension = ext;
+            auto segment = scc::trace::segment_manifest::segment_name(base_name, 0, extension);
+            writer.reset(new WRITER(segment));
+            manifest->add(segment, 0);
+        } else
+            writer.reset(new WRITER(name));
+        if(!writer->is_open())
+            return false;
+        if(dictionary) {
+            std::string buf{"scv_tr_format_version 2\n"};
+            if(keep_state())
+                definitions += buf;
+            write(buf);
+        }
+        return true;
+    }
+
+    inline void close() {
+        delete writer.release();
+        if(manifest)
+            manifest->close(last_time);
+        manifest.reset();
+    }
+    /**
+     * @fn void set_rotation(uint64_t, uint64_t)
+     * @brief enables the rotation of the output into segments, needs to be called before the database is opened
+     *
+     * @param size the (uncompressed) size of a segment in bytes after which a new segment is started, 0 disables it
+     * @param time the duration of a segment in ps after which a new segment is started, 0 disables it
+     */
+    inline void set_rotation(uint64_t size, uint64_t time) {
+        max_size = size;
+        max_time = time;
     }
 
-    inline void close() { delete writer.release(); }
+    inline bool rotating() const { return max_size || max_time; }
+    /**
+     * @fn void set_attribute_dictionary(bool)
+     * @brief selects the version 2 format using the attribute name dictionary, needs to be called before the database
+     * is opened
+     */
+    inline void set_attribute_dictionary(bool enable) { dictionary = enable; }
+    //! the definitions and open transactions are kept if they need to be repeated in a new segment or a snapshot
+    inline bool keep_state() const { return rotating() || WRITER::live; }
 
-    inline void writeStream(uint64_t id, std::string const& name, std::string const& kind) {            auto buf = fmt::format("scv_tr_stream (ID {}, name \"{}\", kind \"{}\")\n", id, name.c_str(), kind.c_str());
-    writer->out.write(buf.c_str(), buf.size());
+    inline void write(char const* data, size_t size) {
+        if(!writer) // the database could not be opened
+            return;
+        if(writer->resync_requested()) {
+            std::string state = definitions;
+            for(auto& e : open_tx)
+                state += e.second;
+            writer->snapshot(state);
+        }
+        writer->out.write(data, size);
+        written += size;
+    }
+
+    inline void write(std::string const& buf) { write(buf.data(), buf.size()); }
+
+    inline void write(fmt::memory_buffer const& buf, uint64_t id, EventType event) {
+        write(buf.data(), buf.size());
+        if(event == BEGIN && keep_state()) {
+            auto it = open_tx.find(id);
+            if(it != open_tx.end())
+                it->second.append(buf.data(), buf.size());
+        }
+    }
+    /**
+     * @fn void rotate(uint64_t)
+     * @brief closes the current segment and starts a new one. The new segment repeats the stream and generator
+     * definitions as well as the begin of all open transactions so that it can be read on its own
+     *
+     * @param time the start time of the new segment
+     */
+    void rotate(uint64_t time) {
+        auto segment = scc::trace::segment_manifest::segment_name(base_name, manifest->size(), extension);
+        writer.reset(new WRITER(segment));
+        manifest->add(segment, time);
+        segment_start = time;
+        written = 0;
+        write(definitions);
+        for(auto& e : open_tx)
+            write(e.second);
+    }
+
+    inline void writeStream(uint64_t id, std::string const& name, std::string const& kind) {
+        auto buf = fmt::format("scv_tr_stream (ID {}, name \"{}\", kind \"{}\")\n", id, name.c_str(), kind.c_str());
+        if(keep_state())
+            definitions += buf;
+        write(buf);
     }
 
     inline void writeGenerator(uint64_t id, std::string const& name, uint64_t stream, std::vector<AttrDesc> const& attributes) {
         auto buf = fmt::format("scv_tr_generator (ID {}, name \"{}\", scv_tr_stream {},\n", id,
                 name.c_str(), stream);
-        writer->out.write(buf.c_str(), buf.size());
         auto idx=0U;
         for(auto attr: attributes){
             if(attr.evt==BEGIN){
-                auto buf = fmt::format("begin_attribute (ID {}, name \"{}\", type \"{}\")\n",
+                buf += fmt::format("begin_attribute (ID {}, name \"{}\", type \"{}\")\n",
                         idx, attr.name, data_type_str[attr.type]);
-                writer->out.write(buf.c_str(), buf.size());
             } else if(attr.evt==END){
-                auto buf = fmt::format("end_attribute (ID {}, name \"{}\", type \"{}\")\n",
+                buf += fmt::format("end_attribute (ID {}, name \"{}\", type \"{}\")\n",
                         idx, attr.name, data_type_str[attr.type]);
-                writer->out.write(buf.c_str(), buf.size());
             }
             ++idx;
         }
-        writer->out.write(")\n", 2);
+        buf += ")\n";
+        if(keep_state())
+            definitions += buf;
+        write(buf);
     }
 
     inline void writeTransaction(uint64_t id, uint64_t generator, EventType type, uint64_t time) {
-        auto buf = type==BEGIN?
-                fmt::format("tx_begin {} {} {} ps\n", id, generator, time):
-                fmt::format("tx_end {} {} {} ps\n", id, generator, time);
-        writer->out.write(buf.c_str(), buf.size());
+        if(type == BEGIN && rotating() &&
+           ((max_size && written >= max_size) || (max_time && time - segment_start >= max_time)))
+            rotate(time);
+        line.clear();
+        append(type == BEGIN ? "tx_begin " : "tx_end ");
+        append(id);
+        line.push_back(' ');
+        append(generator);
+        line.push_back(' ');
+        append(time);
+        append(" ps\n");
+        write(line.data(), line.size());
+        if(keep_state()) {
+            last_time = time;
+            if(type == BEGIN)
+                open_tx[id].assign(line.data(), line.size());
+            else
+                open_tx.erase(id);
+        }
     }
 
     inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, const string& value) {
         //data_type::BOOLEAN, data_type::ENUMERATION, data_type::BIT_VECTOR, data_type::LOGIC_VECTOR, data_type::STRING
-        auto buf = event == EventType::RECORD?
-                fmt::format("tx_record_attribute {} \"{}\" {} = \"{}\"\n", id, name, data_type_str[type], value):
-                fmt::format("a \"{}\"\n", value);
-        writer->out.write(buf.c_str(), buf.size());
+        startAttribute(id, event, name, type);
+        line.push_back('"');
+        append(value);
+        append("\"\n");
+        write(line, id, event);
     }
 
     inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, int64_t value) {
         // data_type::INTEGER, data_type::UNSIGNED, data_type::FIXED_POINT_INTEGER, data_type::UNSIGNED_FIXED_POINT_INTEGER
-        auto buf = event == EventType::RECORD?
-                fmt::format("tx_record_attribute {} \"{}\" {} = {}\n", id, name, data_type_str[type], value):
-                fmt::format("a {}\n", value);
-        writer->out.write(buf.c_str(), buf.size());
+        startAttribute(id, event, name, type);
+        append(value);
+        line.push_back('\n');
+        write(line, id, event);
     }
 
     inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, uint64_t value) {
         // data_type::INTEGER, data_type::UNSIGNED, data_type::FIXED_POINT_INTEGER, data_type::UNSIGNED_FIXED_POINT_INTEGER
-        auto buf = event == EventType::RECORD?
-                fmt::format("tx_record_attribute {} \"{}\" {} = {}\n", id, name, data_type_str[type], value):
-                fmt::format("a {}\n", value);
-        writer->out.write(buf.c_str(), buf.size());
+        startAttribute(id, event, name, type);
+        append(value);
+        line.push_back('\n');
+        write(line, id, event);
     }
 
     inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, bool value) {
-        // data_type::INTEGER, data_type::UNSIGNED, data_type::FIXED_POINT_INTEGER, data_type::UNSIGNED_FIXED_POINT_INTEGER
-        auto buf = event == EventType::RECORD?
-                fmt::format("tx_record_attribute {} \"{}\" {} = {}\n", id, name, data_type_str[type], value?"true":"false"):
-                fmt::format("a {}\n", value?"true":"false");
-        writer->out.write(buf.c_str(), buf.size());
+        // data_type::BOOLEAN
+        startAttribute(id, event, name, type);
+        append(value ? "true\n" : "false\n");
+        write(line, id, event);
     }
 
     inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, double value) {
         // data_type::FLOATING_POINT_NUMBER
-        auto buf = event == EventType::RECORD?
-                fmt::format("tx_record_attribute {} \"{}\" {} = {}\n", id, name, data_type_str[type], value):
-                fmt::format("a {}\n", value);
-        writer->out.write(buf.c_str(), buf.size());
+        startAttribute(id, event, name, type);
+        fmt::format_to(std::back_inserter(line), "{}\n", value);
+        write(line, id, event);
     }
 
     inline void writeRelation(const std::string& name, uint64_t sink_id, uint64_t src_id) {
         auto buf = fmt::format("tx_relation \"{}\" {} {}\n", name, sink_id, src_id);
-        writer->out.write(buf.c_str(), buf.size());
+        write(buf);
+    }
+    /**
+     * @fn void startAttribute(uint64_t, EventType, const string&, data_type)
+     * @brief starts the line of an attribute in the line buffer. Begin and end attributes use the positional 'a'
+     * record. Recorded attributes either use a tx_record_attribute record or, with the attribute dictionary, refer to
+     * their name using the ID of an attribute_name record which is written the first time the name is used with a
+     * particular data type
+     */
+    inline void startAttribute(uint64_t id, EventType event, const string& name, data_type type) {
+        line.clear();
+        if(event == EventType::RECORD && !dictionary) {
+            append("tx_record_attribute ");
+            append(id);
+            append(" \"");
+            append(name);
+            append("\" ");
+            append(data_type_str[type]);
+            append(" = ");
+        } else if(event == EventType::RECORD) {
+            auto& ids = attribute_ids[type];
+            auto it = ids.find(name);
+            if(it == ids.end()) {
+                it = ids.emplace(name, attribute_ids_count++).first;
+                auto buf = fmt::format("attribute_name (ID {}, name \"{}\", type \"{}\")\n", it->second, name,
+                                       data_type_str[type]);
+                if(keep_state())
+                    definitions += buf;
+                write(buf);
+            }
+            append("r ");
+            append(id);
+            line.push_back(' ');
+            append(it->second);
+            line.push_back(' ');
+        } else
+            append("a ");
     }
+
+    inline void append(char const* str) { line.append(str, str + strlen(str)); }
+
+    inline void append(std::string const& str) { line.append(str.data(), str.data() + str.size()); }
+
+    template <typename T> inline void append(T value) {
+        fmt::format_int f(value);
+        line.append(f.data(), f.data() + f.size());
+    }
+
     static Formatter &get() {
         static Formatter db;
         return db;
     }
+
+    std::string base_name, extension;
+    //! the stream and generator definitions being repeated in each segment
+    std::string definitions;
+    //! the begin records of the transactions not yet ended
+    std::map<uint64_t, std::string> open_tx;
+    std::unique_ptr<scc::trace::segment_manifest> manifest;
+    //! the buffer the transaction and attribute lines are formatted into
+    fmt::memory_buffer line;
+    //! the IDs of the recorded attribute names per data type
+    std::array<std::unordered_map<std::string, uint64_t>, scv_extensions_if::STRING + 1> attribute_ids;
+    uint64_t attribute_ids_count{0};
+    bool dictionary{false};
+    uint64_t written{0}, max_size{0}, max_time{0}, segment_start{0}, last_time{0};
 };
 #ifdef WITH_LZ4
 //using DB=Formatter<LZ4Writer>;
@@ -425,6 +663,29 @@ void scv_tr_lz4_init() {
     scv_tr_handle::register_relation_cb(relationCb<Formatter<LZ4Writer>>);
 }
 #endif
+void scv_tr_set_rotation(uint64_t max_size, uint64_t max_time) {
+#ifdef WITH_LZ4
+    Formatter<LZ4Writer>::get().set_rotation(max_size, max_time);
+#endif
+    Formatter<PlainWriter>::get().set_rotation(max_size, max_time);
+}
+void scv_tr_set_attribute_dictionary(bool enable) {
+#ifdef WITH_LZ4
+    Formatter<LZ4Writer>::get().set_attribute_dictionary(enable);
+#endif
+    Formatter<PlainWriter>::get().set_attribute_dictionary(enable);
+    Formatter<ShmWriter>::get().set_attribute_dictionary(enable);
+}
+void scv_tr_shm_init(size_t capacity, bool overwrite) {
+    shm_options.capacity = capacity;
+    shm_options.policy = overwrite ? util::shm::policy::OVERWRITE : util::shm::policy::DROP;
+    scv_tr_db::register_class_cb(dbCb<Formatter<ShmWriter>>);
+    scv_tr_stream::register_class_cb(streamCb<Formatter<ShmWriter>>);
+    scv_tr_generator_base::register_class_cb(generatorCb<Formatter<ShmWriter>>);
+    scv_tr_handle::register_class_cb(transactionCb<Formatter<ShmWriter>>);
+    scv_tr_handle::register_record_attribute_cb(attributeCb<Formatter<ShmWriter>>);
+    scv_tr_handle::register_relation_cb(relationCb<Formatter<ShmWriter>>);
+}
 void scv_tr_plain_init() {
     scv_tr_db::register_class_cb(dbCb<Formatter<PlainWriter>>);
     scv_tr_stream::register_class_cb(streamCb<Formatter<PlainWriter>>);
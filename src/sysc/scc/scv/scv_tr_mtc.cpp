@@ -14,19 +14,25 @@
  * limitations under the License.
  *******************************************************************************/
 #include <array>
-#include <boost/filesystem.hpp>
-#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
-#include <fcntl.h>
-#include <fstream>
-#include <iostream>
-#include <sstream>
+#include <deque>
+#include <fmt/format.h>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
-#include <unordered_set>
+#include <util/thread_pool.h>
 #include <vector>
+#ifdef HAS_LZ4
+#include <lz4frame.h>
+#endif
 // clang-format off
 #ifdef HAS_SCV
 #include <scv.h>
@@ -44,87 +50,459 @@ enum EventType { BEGIN, RECORD, END };
 using data_type = scv_extensions_if::data_type;
 // ----------------------------------------------------------------------------
 namespace {
-class Base {
-protected:
-    boost::filesystem::path dir;
-    std::ofstream out;
-    bool const is_open;
-    std::array<char, 1024> buffer;
-    Base(const std::string& name)
-    : dir(name.c_str())
-    , out(name)
-    , is_open(out.is_open()) {
-        //        if(boost::filesystem::exists(dir))
-        //            boost::filesystem::remove_all(dir);
-        //        boost::filesystem::create_directory(dir);
-    }
-    ~Base() {
-        if(is_open)
-            out.close();
+const std::array<char const*, scv_extensions_if::STRING + 1> data_type_str = {{
+    "BOOLEAN",                      // bool
+    "ENUMERATION",                  // enum
+    "INTEGER",                      // char, short, int, long, long long, sc_int, sc_bigint
+    "UNSIGNED",                     // unsigned { char, short, int, long, long long }, sc_uint, sc_biguint
+    "FLOATING_POINT_NUMBER",        // float, double
+    "BIT_VECTOR",                   // sc_bit, sc_bv
+    "LOGIC_VECTOR",                 // sc_logic, sc_lv
+    "FIXED_POINT_INTEGER",          // sc_fixed
+    "UNSIGNED_FIXED_POINT_INTEGER", // sc_ufixed
+    "RECORD",                       // struct/class
+    "POINTER",                      // T*
+    "ARRAY",                        // T[N]
+    "STRING"                        // string, std::string
+}};
+/**
+ * the records the simulation thread serializes into the chunks, all values are stored in native byte order, strings
+ * are stored as 32bit length followed by the characters:
+ *     STREAM:    id(8), name(str), kind(str)
+ *     GENERATOR: id(8), stream(8), name(str), count(4), count x [event(1), type(1), name(str)]
+ *     TX_BEGIN:  id(8), generator(8), time(8)
+ *     TX_END:    id(8), generator(8), time(8)
+ *     ATTRIBUTE: id(8), event(1), type(1), value kind(1), name(str), value(8 or str)
+ *     RELATION:  sink(8), src(8), name(str)
+ */
+enum RecordType : uint8_t { STREAM = 1, GENERATOR, TX_BEGIN, TX_END, ATTRIBUTE, RELATION };
+enum ValueKind : uint8_t { SIGNED_VALUE, UNSIGNED_VALUE, REAL_VALUE, BOOL_VALUE, STRING_VALUE };
+
+struct AttrDesc {
+    EventType const evt;
+    data_type const type;
+    std::string const name;
+    AttrDesc(EventType evt, data_type type, std::string const& name)
+    : evt(evt)
+    , type(type)
+    , name(name) {}
+};
+/**
+ * a bounded single producer single consumer queue, neither side takes a lock
+ */
+template <typename T, size_t SIZE> class spsc_queue {
+public:
+    bool push(T v) {
+        auto tail = tail_idx.load(std::memory_order_relaxed);
+        auto next = (tail + 1) % SIZE;
+        if(next == head_idx.load(std::memory_order_acquire))
+            return false;
+        ring[tail] = v;
+        tail_idx.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& v) {
+        auto head = head_idx.load(std::memory_order_relaxed);
+        if(head == tail_idx.load(std::memory_order_acquire))
+            return false;
+        v = ring[head];
+        head_idx.store((head + 1) % SIZE, std::memory_order_release);
+        return true;
+    }
+    //! may only be called by the consumer
+    bool empty() const {
+        return head_idx.load(std::memory_order_relaxed) == tail_idx.load(std::memory_order_acquire);
     }
+
+private:
+    std::array<T, SIZE> ring;
+    std::atomic<size_t> head_idx{0};
+    std::atomic<size_t> tail_idx{0};
 };
 
-struct Database : Base {
-    uint64_t idx{0};
-    Database(const std::string& name)
-    : Base(name) {}
+struct chunk {
+    std::unique_ptr<char[]> data;
+    size_t capacity{0};
+    size_t size{0};
+};
+/**
+ * reads the records of a chunk
+ */
+struct RecordReader {
+    char const* ptr;
+    template <typename T> T get() {
+        T ret;
+        memcpy(&ret, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return ret;
+    }
+    fmt::string_view get_str() {
+        auto len = get<uint32_t>();
+        fmt::string_view ret(ptr, len);
+        ptr += len;
+        return ret;
+    }
+};
+/**
+ * writes a record into a chunk, the space needs to be reserved upfront
+ */
+struct RecordWriter {
+    RecordWriter(char* buf)
+    : ptr(buf) {}
 
-    inline uint64_t getIdOf(const std::string& str) { return idx; }
+    char* ptr;
+    template <typename T> RecordWriter& put(T const& v) {
+        memcpy(ptr, &v, sizeof(T));
+        ptr += sizeof(T);
+        return *this;
+    }
+    RecordWriter& put_str(char const* str, uint32_t len) {
+        put(len);
+        memcpy(ptr, str, len);
+        ptr += len;
+        return *this;
+    }
+};
+inline size_t str_size(size_t len) { return sizeof(uint32_t) + len; }
+/**
+ * The database with a multi-threaded writer. The simulation thread serializes the events in a compact binary form into
+ * chunks of 1MB. Full chunks are handed over to the writer thread using a lock-free queue and get formatted into the
+ * text based txlog format and LZ4 compressed by a pool of worker threads. Each chunk becomes an independent LZ4 frame,
+ * the frames are written in order so that the file is a valid LZ4 stream. If LZ4 is not available the text is written
+ * uncompressed. Free chunks are returned to the simulation thread using a second lock-free queue, the number of chunks
+ * is bounded so the simulation thread waits if the writer cannot keep up. Both sides block on a condition variable
+ * if their queue is empty, the pushes are done under the mutex so that no notification gets lost. Errors of the
+ * writer and worker threads are reported by the simulation thread.
+ *
+ * Only the simulation thread may record transactions.
+ */
+class Database {
+public:
+    static const size_t chunk_size = 1024 * 1024;
+    static const size_t max_chunks = 32;
 
-    inline void writeStream(uint64_t id, std::string const& name, std::string const& kind) {
-        if(is_open) {
-            auto len = sprintf(buffer.data(), "scv_tr_stream (ID %lu, name \"%s\", kind \"%s\")\n", id, name.c_str(),
-                               kind.c_str());
-            out.write(buffer.data(), len);
+    Database(const std::string& name, unsigned threads) {
+        out = fopen(name.c_str(), "wb");
+        if(!out)
+            throw std::runtime_error("could not open " + name);
+        pool.start(threads);
+        current = allocate();
+        writer = std::thread([this]() { run(); });
+    }
+
+    ~Database() {
+        if(current->size)
+            submit(current);
+        {
+            lock_type lock(mtx);
+            done.store(true, std::memory_order_release);
         }
+        cond.notify_one();
+        writer.join();
+        fclose(out);
+        report_error();
+    }
+
+    inline void writeStream(uint64_t id, std::string const& name, std::string const& kind) {
+        RecordWriter(reserve(1 + sizeof(id) + str_size(name.size()) + str_size(kind.size())))
+            .put(STREAM)
+            .put(id)
+            .put_str(name.c_str(), name.size())
+            .put_str(kind.c_str(), kind.size());
     }
 
-    inline void writeGenerator(uint64_t id, std::string const& name, uint64_t stream) {
-        if(is_open) {
-            auto len = sprintf(buffer.data(), "scv_tr_generator (ID %lu, name \"%s\", scv_tr_stream %lu,\n", id,
-                               name.c_str(), stream);
-            out.write(buffer.data(), len);
+    inline void writeGenerator(uint64_t id, std::string const& name, uint64_t stream,
+                               std::vector<AttrDesc> const& attributes) {
+        auto len = 1 + sizeof(id) + sizeof(stream) + str_size(name.size()) + sizeof(uint32_t);
+        for(auto& attr : attributes)
+            len += 2 + str_size(attr.name.size());
+        auto w = RecordWriter(reserve(len))
+                     .put(GENERATOR)
+                     .put(id)
+                     .put(stream)
+                     .put_str(name.c_str(), name.size())
+                     .put(static_cast<uint32_t>(attributes.size()));
+        for(auto& attr : attributes)
+            w.put(static_cast<uint8_t>(attr.evt)).put(static_cast<uint8_t>(attr.type)).put_str(attr.name.c_str(), attr.name.size());
+    }
+
+    inline void writeTransaction(uint64_t id, uint64_t generator, EventType type, uint64_t time) {
+        RecordWriter(reserve(1 + 3 * sizeof(uint64_t)))
+            .put(type == BEGIN ? TX_BEGIN : TX_END)
+            .put(id)
+            .put(generator)
+            .put(time);
+    }
+
+    inline void writeAttribute(uint64_t id, EventType event, std::string const& name, data_type type, ValueKind kind,
+                               uint64_t value) {
+        RecordWriter(reserve(1 + sizeof(id) + 3 + str_size(name.size()) + sizeof(value)))
+            .put(ATTRIBUTE)
+            .put(id)
+            .put(static_cast<uint8_t>(event))
+            .put(static_cast<uint8_t>(type))
+            .put(kind)
+            .put_str(name.c_str(), name.size())
+            .put(value);
+    }
+
+    inline void writeAttribute(uint64_t id, EventType event, std::string const& name, data_type type, char const* value,
+                               size_t len) {
+        RecordWriter(reserve(1 + sizeof(id) + 3 + str_size(name.size()) + str_size(len)))
+            .put(ATTRIBUTE)
+            .put(id)
+            .put(static_cast<uint8_t>(event))
+            .put(static_cast<uint8_t>(type))
+            .put(STRING_VALUE)
+            .put_str(name.c_str(), name.size())
+            .put_str(value, len);
+    }
+
+    inline void writeRelation(const char* name, uint64_t sink_id, uint64_t src_id) {
+        auto len = strlen(name);
+        RecordWriter(reserve(1 + 2 * sizeof(uint64_t) + str_size(len))).put(RELATION).put(sink_id).put(src_id).put_str(name, len);
+    }
+    /**
+     * returns the names of the flattened attributes of a generator, they are filled upon the first transaction
+     */
+    inline std::vector<std::string>& getAttributeNames(uint64_t generator, EventType event) {
+        return attribute_names[generator][event == BEGIN ? 0 : 1];
+    }
+
+private:
+    using lock_type = std::unique_lock<std::mutex>;
+
+    inline char* reserve(size_t len) {
+        if(current->size + len > current->capacity) {
+            if(current->size) {
+                submit(current);
+                current = acquire();
+            }
+            if(len > current->capacity) {
+                current->data.reset(new char[len]);
+                current->capacity = len;
+            }
         }
+        auto* ret = current->data.get() + current->size;
+        current->size += len;
+        return ret;
     }
 
-    inline uint64_t writeTransaction(uint64_t id, uint64_t generator) {
-        return ++idx; // d.writeTx(id, generator, concurrencyLevel);
+    chunk* allocate() {
+        chunks.emplace_back(new chunk);
+        chunks.back()->data.reset(new char[chunk_size]);
+        chunks.back()->capacity = chunk_size;
+        return chunks.back().get();
     }
 
-    inline void writeTxTimepoint(uint64_t id, int type, uint64_t time, uint64_t file_offset) {
-        //        t.append(type, time, file_offset);
+    void submit(chunk* c) {
+        {
+            // the queue can hold all chunks so this never fails
+            lock_type lock(mtx);
+            full.push(c);
+        }
+        cond.notify_one();
+        report_error();
     }
 
-    inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, const string& value) {
-        //        d.writeAttribute(id, event, c.getIdOf(name), type, c.getIdOf(value));
+    chunk* acquire() {
+        chunk* c;
+        if(free.pop(c))
+            return c;
+        if(chunks.size() < max_chunks)
+            return allocate();
+        lock_type lock(mtx);
+        free_cond.wait(lock, [this, &c]() { return free.pop(c); });
+        return c;
+    }
+    //! reports the first error of the writer or worker threads, may only be called by the simulation thread
+    void report_error() {
+        if(!failed.load(std::memory_order_acquire) || error_reported)
+            return;
+        error_reported = true;
+        std::string msg;
+        {
+            lock_type lock(mtx);
+            msg = error;
+        }
+        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, msg.c_str());
     }
 
-    inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, uint64_t value) {
-        //        d.writeAttribute(id, event, c.getIdOf(name), type, value);
+    void set_error(std::string const& msg) {
+        lock_type lock(mtx);
+        if(!failed.load(std::memory_order_relaxed)) {
+            error = msg;
+            failed.store(true, std::memory_order_release);
+        }
     }
 
-    inline void writeAttribute(uint64_t id, EventType event, const string& name, data_type type, double value) {
-        //        int exponent;
-        //        const double mantissa = frexp(value, &exponent);
+    struct encoded {
+        std::vector<char> data;
+        std::string error;
+    };
+
+    static encoded encode(chunk const* c) {
+        encoded res;
+        fmt::memory_buffer buf;
+        auto out = std::back_inserter(buf);
+        RecordReader r{c->data.get()};
+        auto const* end = c->data.get() + c->size;
+        while(r.ptr < end) {
+            switch(r.get<RecordType>()) {
+            case STREAM: {
+                auto id = r.get<uint64_t>();
+                auto name = r.get_str();
+                auto kind = r.get_str();
+                fmt::format_to(out, "scv_tr_stream (ID {}, name \"{}\", kind \"{}\")\n", id, name, kind);
+            } break;
+            case GENERATOR: {
+                auto id = r.get<uint64_t>();
+                auto stream = r.get<uint64_t>();
+                auto name = r.get_str();
+                fmt::format_to(out, "scv_tr_generator (ID {}, name \"{}\", scv_tr_stream {},\n", id, name, stream);
+                auto count = r.get<uint32_t>();
+                for(auto idx = 0U; idx < count; ++idx) {
+                    auto evt = r.get<uint8_t>();
+                    auto type = r.get<uint8_t>();
+                    auto attr_name = r.get_str();
+                    if(evt == BEGIN)
+                        fmt::format_to(out, "begin_attribute (ID {}, name \"{}\", type \"{}\")\n", idx, attr_name,
+                                       data_type_str[type]);
+                    else if(evt == END)
+                        fmt::format_to(out, "end_attribute (ID {}, name \"{}\", type \"{}\")\n", idx, attr_name,
+                                       data_type_str[type]);
+                }
+                fmt::format_to(out, ")\n");
+            } break;
+            case TX_BEGIN:
+            case TX_END: {
+                auto type = *(r.ptr - 1);
+                auto id = r.get<uint64_t>();
+                auto generator = r.get<uint64_t>();
+                auto time = r.get<uint64_t>();
+                fmt::format_to(out, type == TX_BEGIN ? "tx_begin {} {} {} ps\n" : "tx_end {} {} {} ps\n", id, generator,
+                               time);
+            } break;
+            case ATTRIBUTE: {
+                auto id = r.get<uint64_t>();
+                auto event = r.get<uint8_t>();
+                auto type = r.get<uint8_t>();
+                auto kind = r.get<ValueKind>();
+                auto name = r.get_str();
+                if(event == RECORD)
+                    fmt::format_to(out, "tx_record_attribute {} \"{}\" {} = ", id, name, data_type_str[type]);
+                else
+                    fmt::format_to(out, "a ");
+                switch(kind) {
+                case SIGNED_VALUE:
+                    fmt::format_to(out, "{}\n", r.get<int64_t>());
+                    break;
+                case UNSIGNED_VALUE:
+                    fmt::format_to(out, "{}\n", r.get<uint64_t>());
+                    break;
+                case REAL_VALUE:
+                    fmt::format_to(out, "{}\n", r.get<double>());
+                    break;
+                case BOOL_VALUE:
+                    fmt::format_to(out, "{}\n", r.get<uint64_t>() ? "true" : "false");
+                    break;
+                case STRING_VALUE:
+                    fmt::format_to(out, "\"{}\"\n", r.get_str());
+                    break;
+                }
+            } break;
+            case RELATION: {
+                auto sink = r.get<uint64_t>();
+                auto src = r.get<uint64_t>();
+                auto name = r.get_str();
+                fmt::format_to(out, "tx_relation \"{}\" {} {}\n", name, sink, src);
+            } break;
+            default:
+                // the records before are kept, the remainder of the chunk cannot be decoded
+                res.error = fmt::format("unknown record type {} in transaction recording chunk, {} bytes dropped",
+                                        static_cast<unsigned>(*(r.ptr - 1)), end - r.ptr + 1);
+                r.ptr = end;
+            }
+        }
+#ifdef HAS_LZ4
+        LZ4F_preferences_t prefs;
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.blockSizeID = LZ4F_max1MB;
+        res.data.resize(LZ4F_compressFrameBound(buf.size(), &prefs));
+        auto len = LZ4F_compressFrame(res.data.data(), res.data.size(), buf.data(), buf.size(), &prefs);
+        if(LZ4F_isError(len)) {
+            res.error = fmt::format("LZ4 compression of transaction recording chunk failed ({}), {} bytes dropped",
+                                    LZ4F_getErrorName(len), buf.size());
+            res.data.clear();
+        } else
+            res.data.resize(len);
+#else
+        res.data.assign(buf.data(), buf.data() + buf.size());
+#endif
+        return res;
     }
 
-    inline void writeRelation(const std::string& name, uint64_t sink_id, uint64_t src_id) {
-        //        d.writeRelation(c.getIdOf(name), src_id, sink_id);
+    void run() {
+        std::deque<std::pair<chunk*, std::future<encoded>>> pending;
+        while(true) {
+            // read the flag before draining the queue so that no chunk submitted before it is missed
+            auto finished = done.load(std::memory_order_acquire);
+            chunk* c;
+            while(full.pop(c))
+                pending.emplace_back(c, pool.enqueue([c]() -> encoded { return encode(c); }));
+            if(pending.empty()) {
+                if(finished)
+                    break;
+                lock_type lock(mtx);
+                cond.wait(lock, [this]() { return !full.empty() || done.load(std::memory_order_relaxed); });
+                continue;
+            }
+            auto res = pending.front().second.get();
+            if(res.error.size())
+                set_error(res.error);
+            if(res.data.size() && fwrite(res.data.data(), 1, res.data.size(), out) != res.data.size())
+                set_error("could not write the transaction recording file");
+            c = pending.front().first;
+            pending.pop_front();
+            c->size = 0;
+            {
+                lock_type lock(mtx);
+                free.push(c);
+            }
+            free_cond.notify_one();
+        }
     }
+
+    FILE* out{nullptr};
+    std::vector<std::unique_ptr<chunk>> chunks;
+    chunk* current{nullptr};
+    spsc_queue<chunk*, max_chunks + 1> full;
+    spsc_queue<chunk*, max_chunks + 1> free;
+    std::atomic<bool> done{false};
+    std::atomic<bool> failed{false};
+    bool error_reported{false};
+    std::string error;
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::condition_variable free_cond;
+    util::thread_pool pool;
+    std::thread writer;
+    std::unordered_map<uint64_t, std::array<std::vector<std::string>, 2>> attribute_names;
 };
 
 Database* db;
-std::unordered_map<uint64_t, uint64_t> id2offset;
 
 void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason, void* data) {
     // This is called from the scv_tr_db ctor.
-    static string fName("DEFAULT_scv_tr_sqlite");
+    static string fName("DEFAULT_scv_tr_mtc");
     switch(reason) {
     case scv_tr_db::CREATE:
         if((_scv_tr_db.get_name() != nullptr) && (strlen(_scv_tr_db.get_name()) != 0))
             fName = _scv_tr_db.get_name();
         try {
-            db = new Database(fName);
+            auto hw = std::thread::hardware_concurrency();
+            db = new Database(fName, hw > 2 ? std::min(hw - 1, 8U) : 1U);
         } catch(...) {
             _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't open recording file");
         }
@@ -132,6 +510,7 @@ void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason, void*
     case scv_tr_db::DELETE:
         try {
             delete db;
+            db = nullptr;
         } catch(...) {
             _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't close recording file");
         }
@@ -142,7 +521,7 @@ void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason, void*
 }
 // ----------------------------------------------------------------------------
 void streamCb(const scv_tr_stream& s, scv_tr_stream::callback_reason reason, void* data) {
-    if(reason == scv_tr_stream::CREATE) {
+    if(reason == scv_tr_stream::CREATE && db) {
         try {
             db->writeStream(s.get_id(), s.get_name(), s.get_stream_kind());
         } catch(std::runtime_error& e) {
@@ -151,35 +530,19 @@ void streamCb(const scv_tr_stream& s, scv_tr_stream::callback_reason reason, voi
     }
 }
 // ----------------------------------------------------------------------------
-inline void recordAttribute(uint64_t id, EventType event, const string& name, data_type type, const string& value) {
-    try {
-        db->writeAttribute(id, event, name, type, value);
-    } catch(std::runtime_error& e) {
-        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create attribute entry");
-    }
-}
-// ----------------------------------------------------------------------------
-inline void recordAttribute(uint64_t id, EventType event, const string& name, data_type type, long long value) {
-    try {
-        db->writeAttribute(id, event, name, type, static_cast<uint64_t>(value));
-    } catch(std::runtime_error& e) {
-        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create attribute entry");
-    }
-}
+/**
+ * the names of the attributes of a transaction. If names is set they are cached there in the order of traversal,
+ * subsequent transactions of the same generator use them instead of building the name strings again
+ */
+struct AttributeNames {
+    std::vector<std::string>* names;
+    size_t idx;
+    std::string tmp;
+};
 // ----------------------------------------------------------------------------
-inline void recordAttribute(uint64_t id, EventType event, const string& name, data_type type, double value) {
-    try {
-        db->writeAttribute(id, event, name, type, value);
-    } catch(std::runtime_error& e) {
-        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create attribute entry");
-    }
-}
-
-inline std::string get_name(const char* prefix, const scv_extensions_if* my_exts_p) {
-    static thread_local std::unordered_map<const scv_extensions_if*, std::string> name_lut;
-    auto it = name_lut.find(my_exts_p);
-    if(it != name_lut.end())
-        return it->second;
+inline std::string const& get_name(const char* prefix, const scv_extensions_if* my_exts_p, AttributeNames& attr_names) {
+    if(attr_names.names && attr_names.idx < attr_names.names->size())
+        return (*attr_names.names)[attr_names.idx++];
     string name;
     if(!prefix || strlen(prefix) == 0) {
         name = my_exts_p->get_name();
@@ -190,76 +553,109 @@ inline std::string get_name(const char* prefix, const scv_extensions_if* my_exts
             name = std::string(prefix) + "." + my_exts_p->get_name();
         }
     }
-    name_lut[my_exts_p] = (name == "") ? "<unnamed>" : name;
-    return (name == "") ? "<unnamed>" : name;
+    if(name == "")
+        name = "<unnamed>";
+    if(!attr_names.names) {
+        attr_names.tmp = name;
+        return attr_names.tmp;
+    }
+    attr_names.names->push_back(name);
+    return (*attr_names.names)[attr_names.idx++];
 }
-
 // ----------------------------------------------------------------------------
-void recordAttributes(uint64_t id, EventType eventType, char const* prefix, const scv_extensions_if* my_exts_p) {
+void recordAttributes(uint64_t id, EventType eventType, char const* prefix, const scv_extensions_if* my_exts_p,
+                      AttributeNames& attr_names) {
     if(my_exts_p == nullptr)
         return;
-    auto name = get_name(prefix, my_exts_p);
-    switch(my_exts_p->get_type()) {
-    case scv_extensions_if::RECORD: {
-        int num_fields = my_exts_p->get_num_fields();
-        if(num_fields > 0) {
-            for(int field_counter = 0; field_counter < num_fields; field_counter++) {
-                const scv_extensions_if* field_data_p = my_exts_p->get_field(field_counter);
-                recordAttributes(id, eventType, prefix, field_data_p);
+    try {
+        switch(my_exts_p->get_type()) {
+        case scv_extensions_if::RECORD: {
+            int num_fields = my_exts_p->get_num_fields();
+            if(num_fields > 0) {
+                for(int field_counter = 0; field_counter < num_fields; field_counter++) {
+                    const scv_extensions_if* field_data_p = my_exts_p->get_field(field_counter);
+                    recordAttributes(id, eventType, prefix, field_data_p, attr_names);
+                }
             }
+        } break;
+        case scv_extensions_if::ENUMERATION: {
+            auto* value = my_exts_p->get_enum_string((int)(my_exts_p->get_integer()));
+            db->writeAttribute(id, eventType, get_name(prefix, my_exts_p, attr_names), scv_extensions_if::ENUMERATION,
+                               value, strlen(value));
+        } break;
+        case scv_extensions_if::BOOLEAN:
+            db->writeAttribute(id, eventType, get_name(prefix, my_exts_p, attr_names), scv_extensions_if::BOOLEAN,
+                               BOOL_VALUE, my_exts_p->get_bool());
+            break;
+        case scv_extensions_if::INTEGER:
+        case scv_extensions_if::FIXED_POINT_INTEGER:
+            db->writeAttribute(id, eventType, get_name(prefix, my_exts_p, attr_names), scv_extensions_if::INTEGER,
+                               SIGNED_VALUE, my_exts_p->get_integer());
+            break;
+        case scv_extensions_if::UNSIGNED:
+            db->writeAttribute(id, eventType, get_name(prefix, my_exts_p, attr_names), scv_extensions_if::UNSIGNED,
+                               UNSIGNED_VALUE, my_exts_p->get_unsigned());
+            break;
+        case scv_extensions_if::POINTER:
+            db->writeAttribute(id, eventType, get_name(prefix, my_exts_p, attr_names), scv_extensions_if::POINTER,
+                               UNSIGNED_VALUE, reinterpret_cast<uint64_t>(my_exts_p->get_pointer()));
+            break;
+        case scv_extensions_if::STRING: {
+            auto value = my_exts_p->get_string();
+            db->writeAttribute(id, eventType, get_name(prefix, my_exts_p, attr_names), scv_extensions_if::STRING,
+                               value.c_str(), value.size());
+        } break;
+        case scv_extensions_if::FLOATING_POINT_NUMBER: {
+            auto value = my_exts_p->get_double();
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            db->writeAttribute(id, eventType, get_name(prefix, my_exts_p, attr_names),
+                               scv_extensions_if::FLOATING_POINT_NUMBER, REAL_VALUE, bits);
+        } break;
+        case scv_extensions_if::BIT_VECTOR: {
+            sc_bv_base tmp_bv(my_exts_p->get_bitwidth());
+            my_exts_p->get_value(tmp_bv);
+            auto value = tmp_bv.to_string();
+            db->writeAttribute(id, eventType, get_name(prefix, my_exts_p, attr_names), scv_extensions_if::BIT_VECTOR,
+                               value.c_str(), value.size());
+        } break;
+        case scv_extensions_if::LOGIC_VECTOR: {
+            sc_lv_base tmp_lv(my_exts_p->get_bitwidth());
+            my_exts_p->get_value(tmp_lv);
+            auto value = tmp_lv.to_string();
+            db->writeAttribute(id, eventType, get_name(prefix, my_exts_p, attr_names), scv_extensions_if::LOGIC_VECTOR,
+                               value.c_str(), value.size());
+        } break;
+        case scv_extensions_if::ARRAY:
+            for(int array_elt_index = 0; array_elt_index < my_exts_p->get_array_size(); array_elt_index++) {
+                const scv_extensions_if* field_data_p = my_exts_p->get_array_elt(array_elt_index);
+                recordAttributes(id, eventType, prefix, field_data_p, attr_names);
+            }
+            break;
+        default: {
+            std::array<char, 100> tmpString;
+            sprintf(tmpString.data(), "Unsupported attribute type = %d", my_exts_p->get_type());
+            _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, tmpString.data());
         }
-    } break;
-    case scv_extensions_if::ENUMERATION:
-        recordAttribute(id, eventType, name, scv_extensions_if::ENUMERATION,
-                        my_exts_p->get_enum_string((int)(my_exts_p->get_integer())));
-        break;
-    case scv_extensions_if::BOOLEAN:
-        recordAttribute(id, eventType, name, scv_extensions_if::BOOLEAN, my_exts_p->get_bool() ? "TRUE" : "FALSE");
-        break;
-    case scv_extensions_if::INTEGER:
-    case scv_extensions_if::FIXED_POINT_INTEGER:
-        recordAttribute(id, eventType, name, scv_extensions_if::INTEGER, my_exts_p->get_integer());
-        break;
-    case scv_extensions_if::UNSIGNED:
-        recordAttribute(id, eventType, name, scv_extensions_if::UNSIGNED, my_exts_p->get_integer());
-        break;
-    case scv_extensions_if::POINTER:
-        recordAttribute(id, eventType, name, scv_extensions_if::POINTER, (long long)my_exts_p->get_pointer());
-        break;
-    case scv_extensions_if::STRING:
-        recordAttribute(id, eventType, name, scv_extensions_if::STRING, my_exts_p->get_string());
-        break;
-    case scv_extensions_if::FLOATING_POINT_NUMBER:
-        recordAttribute(id, eventType, name, scv_extensions_if::FLOATING_POINT_NUMBER, my_exts_p->get_double());
-        break;
-    case scv_extensions_if::BIT_VECTOR: {
-        sc_bv_base tmp_bv(my_exts_p->get_bitwidth());
-        my_exts_p->get_value(tmp_bv);
-        recordAttribute(id, eventType, name, scv_extensions_if::BIT_VECTOR, tmp_bv.to_string());
-    } break;
-    case scv_extensions_if::LOGIC_VECTOR: {
-        sc_lv_base tmp_lv(my_exts_p->get_bitwidth());
-        my_exts_p->get_value(tmp_lv);
-        recordAttribute(id, eventType, name, scv_extensions_if::LOGIC_VECTOR, tmp_lv.to_string());
-    } break;
-    case scv_extensions_if::ARRAY:
-        for(int array_elt_index = 0; array_elt_index < my_exts_p->get_array_size(); array_elt_index++) {
-            const scv_extensions_if* field_data_p = my_exts_p->get_array_elt(array_elt_index);
-            recordAttributes(id, eventType, prefix, field_data_p);
         }
-        break;
-    default: {
-        std::array<char, 100> tmpString;
-        sprintf(tmpString.data(), "Unsupported attribute type = %d", my_exts_p->get_type());
-        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, tmpString.data());
-    }
+    } catch(std::runtime_error& e) {
+        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create attribute entry");
     }
 }
 // ----------------------------------------------------------------------------
 void generatorCb(const scv_tr_generator_base& g, scv_tr_generator_base::callback_reason reason, void* data) {
     if(reason == scv_tr_generator_base::CREATE && db) {
         try {
-            db->writeGenerator(g.get_id(), g.get_name(), g.get_scv_tr_stream().get_id());
+            std::vector<AttrDesc> attrs;
+            const scv_extensions_if* my_begin_exts_p = g.get_begin_exts_p();
+            if(my_begin_exts_p != nullptr)
+                attrs.emplace_back(BEGIN, my_begin_exts_p->get_type(),
+                                   g.get_begin_attribute_name() ? g.get_begin_attribute_name() : "");
+            const scv_extensions_if* my_end_exts_p = g.get_end_exts_p();
+            if(my_end_exts_p != nullptr)
+                attrs.emplace_back(END, my_end_exts_p->get_type(),
+                                   g.get_end_attribute_name() ? g.get_end_attribute_name() : "");
+            db->writeGenerator(g.get_id(), g.get_name(), g.get_scv_tr_stream().get_id(), attrs);
         } catch(std::runtime_error& e) {
             _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create generator entry");
         }
@@ -275,29 +671,29 @@ void transactionCb(const scv_tr_handle& t, scv_tr_handle::callback_reason reason
         return;
 
     uint64_t id = t.get_id();
-    vector<uint64_t>::size_type concurrencyIdx;
+    auto const& gen = t.get_scv_tr_generator_base();
     const scv_extensions_if* my_exts_p;
     switch(reason) {
     case scv_tr_handle::BEGIN: {
+        db->writeTransaction(id, gen.get_id(), BEGIN, t.get_begin_sc_time().value());
         my_exts_p = t.get_begin_exts_p();
         if(my_exts_p == nullptr)
-            my_exts_p = t.get_scv_tr_generator_base().get_begin_exts_p();
+            my_exts_p = gen.get_begin_exts_p();
         if(my_exts_p) {
-            auto tmp_str = t.get_scv_tr_generator_base().get_begin_attribute_name()
-                               ? t.get_scv_tr_generator_base().get_begin_attribute_name()
-                               : "";
-            recordAttributes(id, BEGIN, tmp_str, my_exts_p);
+            auto tmp_str = gen.get_begin_attribute_name() ? gen.get_begin_attribute_name() : "";
+            AttributeNames attr_names{&db->getAttributeNames(gen.get_id(), BEGIN), 0, {}};
+            recordAttributes(id, BEGIN, tmp_str, my_exts_p, attr_names);
         }
     } break;
     case scv_tr_handle::END: {
+        db->writeTransaction(id, gen.get_id(), END, t.get_end_sc_time().value());
         my_exts_p = t.get_end_exts_p();
         if(my_exts_p == nullptr)
-            my_exts_p = t.get_scv_tr_generator_base().get_end_exts_p();
+            my_exts_p = gen.get_end_exts_p();
         if(my_exts_p) {
-            auto tmp_str = t.get_scv_tr_generator_base().get_end_attribute_name()
-                               ? t.get_scv_tr_generator_base().get_end_attribute_name()
-                               : "";
-            recordAttributes(t.get_id(), END, tmp_str, my_exts_p);
+            auto tmp_str = gen.get_end_attribute_name() ? gen.get_end_attribute_name() : "";
+            AttributeNames attr_names{&db->getAttributeNames(gen.get_id(), END), 0, {}};
+            recordAttributes(id, END, tmp_str, my_exts_p, attr_names);
         }
     } break;
     default:;
@@ -311,7 +707,8 @@ void attributeCb(const scv_tr_handle& t, const char* name, const scv_extensions_
         return;
     if(t.get_scv_tr_stream().get_scv_tr_db()->get_recording() == false)
         return;
-    recordAttributes(t.get_id(), RECORD, name == nullptr ? "" : name, ext);
+    AttributeNames attr_names{nullptr, 0, {}};
+    recordAttributes(t.get_id(), RECORD, name == nullptr ? "" : name, ext, attr_names);
 }
 // ----------------------------------------------------------------------------
 void relationCb(const scv_tr_handle& tr_1, const scv_tr_handle& tr_2, void* data,
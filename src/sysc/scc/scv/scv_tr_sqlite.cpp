@@ -15,11 +15,17 @@
  *******************************************************************************/
 #include "sqlite3.h"
 #include <array>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 #ifdef HAS_SCV
 #include <scv.h>
@@ -104,8 +110,12 @@ public:
         if(nRet == SQLITE_OK || nRet == SQLITE_DONE) {
             sqlite3_reset(stmt);
             return sqlite3_changes(db);
-        } else
-            throw SQLiteException(nRet, sqlite3_errmsg(db));
+        } else {
+            // the message is owned by the connection and needs to be copied before the statement is reset
+            SQLiteException e(nRet, sqlite3_errmsg(db), false);
+            sqlite3_reset(stmt);
+            throw e;
+        }
     }
 
 protected:
@@ -118,11 +128,6 @@ private:
     int busyTimeoutMs{60000};
     sqlite3* db{nullptr};
 };
-// ----------------------------------------------------------------------------
-static SQLiteDB db;
-static vector<vector<uint64_t>*> concurrencyLevel;
-static sqlite3_stmt *stream_stmt, *gen_stmt, *tx_stmt, *evt_stmt, *attr_stmt, *rel_stmt;
-
 // ----------------------------------------------------------------------------
 enum EventType { BEGIN, RECORD, END };
 using data_type = scv_extensions_if::data_type;
@@ -134,7 +139,275 @@ using data_type = scv_extensions_if::data_type;
 #define TX_EVENT_TABLE "ScvTxEvent"
 #define TX_ATTRIBUTE_TABLE "ScvTxAttribute"
 #define TX_RELATION_TABLE "ScvTxRelation"
+// ----------------------------------------------------------------------------
+/**
+ * the rows recorded by the simulation thread which are inserted as a whole by the writer thread
+ */
+struct Batch {
+    struct Stream {
+        int64_t id;
+        string name, kind;
+    };
+    struct Generator {
+        int64_t id, stream;
+        string name;
+    };
+    struct Tx {
+        int64_t id, generator, stream, concurrencyLevel;
+    };
+    struct Event {
+        int64_t tx;
+        int type;
+        int64_t time;
+    };
+    enum ValueKind { INTEGER_VALUE, REAL_VALUE, TEXT_VALUE };
+    struct Attribute {
+        int64_t tx;
+        int event;
+        string name;
+        int type;
+        ValueKind kind;
+        int64_t ival;
+        double dval;
+        string sval;
+    };
+    struct Relation {
+        string name;
+        int64_t sink, src;
+    };
+    vector<Stream> streams;
+    vector<Generator> generators;
+    vector<Tx> txs;
+    vector<Event> events;
+    vector<Attribute> attributes;
+    vector<Relation> relations;
+
+    size_t size() const {
+        return streams.size() + generators.size() + txs.size() + events.size() + attributes.size() + relations.size();
+    }
+
+    void clear() {
+        streams.clear();
+        generators.clear();
+        txs.clear();
+        events.clear();
+        attributes.clear();
+        relations.clear();
+    }
+};
+/**
+ * owns the database connection and inserts the batches handed over by the simulation thread in a separate thread.
+ * Rows are inserted using prepared multi-row statements, the database transaction is committed periodically. The
+ * indexes are created when the recording is closed.
+ */
+class BatchWriter {
+public:
+    //! the number of rows after which a batch is handed over to the writer thread
+    static const size_t batch_size = 16384;
+    //! the number of rows inserted by a single multi-row statement
+    static const unsigned rows_per_stmt = 64;
+    //! the number of rows after which the database transaction is committed
+    static const size_t commit_interval = 1 << 20;
+    //! the number of batches which may be pending before the simulation thread waits
+    static const size_t max_pending = 8;
+
+    BatchWriter(SQLiteDB& db)
+    : db(db)
+    , stream_stmt(prepare(STREAM_TABLE, "id,name,kind", 3))
+    , gen_stmt(prepare(GENERATOR_TABLE, "id,stream,name", 3))
+    , tx_stmt(prepare(TX_TABLE, "id,generator,stream,concurrencyLevel", 4))
+    , evt_stmt(prepare(TX_EVENT_TABLE, "tx,type,time", 3))
+    , attr_stmt(prepare(TX_ATTRIBUTE_TABLE, "tx,type,name,data_type,data_value", 5))
+    , rel_stmt(prepare(TX_RELATION_TABLE, "name,sink,src", 3)) {
+        current = acquire();
+        writer = std::thread([this]() { run(); });
+    }
+
+    ~BatchWriter() {
+        submit();
+        {
+            lock_type lock(mtx);
+            done = true;
+        }
+        cond.notify_all();
+        writer.join();
+        report_error();
+        for(auto& s : {stream_stmt, gen_stmt, tx_stmt, evt_stmt, attr_stmt, rel_stmt}) {
+            sqlite3_finalize(s.first);
+            sqlite3_finalize(s.second);
+        }
+    }
+
+    inline Batch& rows() { return *current; }
 
+    inline void row_added() {
+        if(current->size() >= batch_size)
+            submit();
+    }
+
+private:
+    using lock_type = std::unique_lock<std::mutex>;
+    //! a multi-row and a single-row insert statement
+    using stmt_pair = std::pair<sqlite3_stmt*, sqlite3_stmt*>;
+
+    stmt_pair prepare(char const* table, char const* columns, unsigned cols) {
+        std::string row = "(?";
+        for(auto i = 1U; i < cols; ++i)
+            row += ",?";
+        row += ")";
+        std::string sql = std::string("INSERT INTO ") + table + " (" + columns + ") values " + row;
+        auto single = db.prepare(sql + ";");
+        for(auto i = 1U; i < rows_per_stmt; ++i)
+            sql += "," + row;
+        return {db.prepare(sql + ";"), single};
+    }
+
+    template <typename T, typename BIND> void insert(vector<T> const& rows, stmt_pair const& stmt, unsigned cols, BIND bind) {
+        size_t idx = 0;
+        for(; idx + rows_per_stmt <= rows.size(); idx += rows_per_stmt) {
+            for(auto i = 0U; i < rows_per_stmt; ++i)
+                bind(stmt.first, i * cols, rows[idx + i]);
+            db.exec(stmt.first);
+        }
+        for(; idx < rows.size(); ++idx) {
+            bind(stmt.second, 0, rows[idx]);
+            db.exec(stmt.second);
+        }
+    }
+
+    void write(Batch const& b) {
+        insert(b.streams, stream_stmt, 3, [](sqlite3_stmt* s, int i, Batch::Stream const& r) {
+            sqlite3_bind_int64(s, i + 1, r.id);
+            sqlite3_bind_text(s, i + 2, r.name.c_str(), r.name.size(), SQLITE_STATIC);
+            sqlite3_bind_text(s, i + 3, r.kind.c_str(), r.kind.size(), SQLITE_STATIC);
+        });
+        insert(b.generators, gen_stmt, 3, [](sqlite3_stmt* s, int i, Batch::Generator const& r) {
+            sqlite3_bind_int64(s, i + 1, r.id);
+            sqlite3_bind_int64(s, i + 2, r.stream);
+            sqlite3_bind_text(s, i + 3, r.name.c_str(), r.name.size(), SQLITE_STATIC);
+        });
+        insert(b.txs, tx_stmt, 4, [](sqlite3_stmt* s, int i, Batch::Tx const& r) {
+            sqlite3_bind_int64(s, i + 1, r.id);
+            sqlite3_bind_int64(s, i + 2, r.generator);
+            sqlite3_bind_int64(s, i + 3, r.stream);
+            sqlite3_bind_int64(s, i + 4, r.concurrencyLevel);
+        });
+        insert(b.events, evt_stmt, 3, [](sqlite3_stmt* s, int i, Batch::Event const& r) {
+            sqlite3_bind_int64(s, i + 1, r.tx);
+            sqlite3_bind_int(s, i + 2, r.type);
+            sqlite3_bind_int64(s, i + 3, r.time);
+        });
+        insert(b.attributes, attr_stmt, 5, [](sqlite3_stmt* s, int i, Batch::Attribute const& r) {
+            sqlite3_bind_int64(s, i + 1, r.tx);
+            sqlite3_bind_int(s, i + 2, r.event);
+            sqlite3_bind_text(s, i + 3, r.name.c_str(), r.name.size(), SQLITE_STATIC);
+            sqlite3_bind_int(s, i + 4, r.type);
+            switch(r.kind) {
+            case Batch::INTEGER_VALUE:
+                sqlite3_bind_int64(s, i + 5, r.ival);
+                break;
+            case Batch::REAL_VALUE:
+                sqlite3_bind_double(s, i + 5, r.dval);
+                break;
+            default:
+                sqlite3_bind_text(s, i + 5, r.sval.c_str(), r.sval.size(), SQLITE_STATIC);
+            }
+        });
+        insert(b.relations, rel_stmt, 3, [](sqlite3_stmt* s, int i, Batch::Relation const& r) {
+            sqlite3_bind_text(s, i + 1, r.name.c_str(), r.name.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(s, i + 2, r.sink);
+            sqlite3_bind_int64(s, i + 3, r.src);
+        });
+        uncommitted += b.size();
+        if(uncommitted >= commit_interval) {
+            db.exec("COMMIT TRANSACTION");
+            db.exec("BEGIN TRANSACTION");
+            uncommitted = 0;
+        }
+    }
+
+    Batch* acquire() {
+        lock_type lock(mtx);
+        if(free_list.empty()) {
+            if(batches.size() < max_pending + 1) {
+                batches.emplace_back(new Batch);
+                return batches.back().get();
+            }
+            cond.wait(lock, [this]() -> bool { return !free_list.empty(); });
+        }
+        auto* b = free_list.back();
+        free_list.pop_back();
+        return b;
+    }
+
+    void submit() {
+        if(!current->size())
+            return;
+        {
+            lock_type lock(mtx);
+            pending.push_back(current);
+        }
+        cond.notify_all();
+        current = acquire();
+        report_error();
+    }
+    //! reports the first error of the writer thread, may only be called by the simulation thread
+    void report_error() {
+        string msg;
+        {
+            lock_type lock(mtx);
+            if(error.empty() || error_reported)
+                return;
+            error_reported = true;
+            msg = error;
+        }
+        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, msg.c_str());
+    }
+
+    void run() {
+        lock_type lock(mtx);
+        while(true) {
+            cond.wait(lock, [this]() -> bool { return done || !pending.empty(); });
+            if(pending.empty())
+                break;
+            auto* b = pending.front();
+            pending.pop_front();
+            lock.unlock();
+            string msg;
+            try {
+                write(*b);
+            } catch(SQLiteDB::SQLiteException& e) {
+                msg = e.errorMessage();
+            }
+            b->clear();
+            lock.lock();
+            if(error.empty())
+                error = msg;
+            free_list.push_back(b);
+            cond.notify_all();
+        }
+    }
+
+    SQLiteDB& db;
+    stmt_pair stream_stmt, gen_stmt, tx_stmt, evt_stmt, attr_stmt, rel_stmt;
+    vector<std::unique_ptr<Batch>> batches;
+    Batch* current{nullptr};
+    std::deque<Batch*> pending;
+    vector<Batch*> free_list;
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool done{false};
+    //! the first error of the writer thread, guarded by mtx
+    string error;
+    bool error_reported{false};
+    size_t uncommitted{0};
+    std::thread writer;
+};
+// ----------------------------------------------------------------------------
+static SQLiteDB db;
+static std::unique_ptr<BatchWriter> writer;
+static vector<vector<uint64_t>*> concurrencyLevel;
+// ----------------------------------------------------------------------------
 static void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason, void* data) {
     char* tail = nullptr;
     // This is called from the scv_tr_db ctor.
@@ -145,12 +418,14 @@ static void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason,
             fName = _scv_tr_db.get_name();
         try {
             remove(fName.c_str());
+            remove((fName + "-wal").c_str());
             db.open(fName);
             // performance related according to
             // http://blog.quibb.org/2010/08/fast-bulk-inserts-into-sqlite/
+            // the WAL keeps the database file consistent and readable while the simulation runs
             db.exec("PRAGMA synchronous=OFF");
             db.exec("PRAGMA count_changes=OFF");
-            db.exec("PRAGMA journal_mode=MEMORY");
+            db.exec("PRAGMA journal_mode=WAL");
             db.exec("PRAGMA temp_store=MEMORY");
             // scv_out << "TB Transaction Recording has started, file = " <<
             // my_sqlite_file_name << endl;
@@ -163,10 +438,11 @@ static void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason,
                     "(id), concurrencyLevel INTEGER);");
             db.exec("CREATE TABLE  IF NOT EXISTS " TX_EVENT_TABLE "(tx INTEGER REFERENCES " TX_TABLE
                     "(id), type INTEGER, time INTEGER);");
+            // data_value has no type affinity so integer and real values are stored as such
             db.exec("CREATE TABLE  IF NOT EXISTS " TX_ATTRIBUTE_TABLE "(tx INTEGER REFERENCES " TX_TABLE
                     "(id), type INTEGER, name "
                     "TEXT, data_type INTEGER, "
-                    "data_value TEXT);");
+                    "data_value);");
             db.exec("CREATE TABLE  IF NOT EXISTS " TX_RELATION_TABLE "(name TEXT, src INTEGER REFERENCES " TX_TABLE
                     "(id), sink INTEGER REFERENCES " TX_TABLE "(id));");
             db.exec("CREATE TABLE  IF NOT EXISTS " SIM_PROPS "(time_resolution INTEGER);");
@@ -175,18 +451,7 @@ static void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason,
             ss << "INSERT INTO " SIM_PROPS " (time_resolution) values ("
                << (long)(sc_core::sc_get_time_resolution().to_seconds() * 1e15) << ");";
             db.exec(ss.str().c_str());
-            stream_stmt = db.prepare("INSERT INTO " STREAM_TABLE " (id, name, kind) values (@ID,@NAME,@KIND);");
-            gen_stmt = db.prepare("INSERT INTO " GENERATOR_TABLE " (id,stream, name)"
-                                  " values (@ID,@STRM_DI,@NAME);");
-            tx_stmt = db.prepare("INSERT INTO " TX_TABLE " (id,generator,stream, concurrencyLevel)"
-                                 " values (@ID,@GEN_ID,@STREAM_ID,@CONC_LEVEL);");
-            evt_stmt = db.prepare("INSERT INTO " TX_EVENT_TABLE " (tx,type,time)"
-                                  " values (@TX_ID,@TYPE,@TIMESTAMP);");
-            attr_stmt = db.prepare("INSERT INTO " TX_ATTRIBUTE_TABLE " (tx,type,name,data_type,data_value) "
-                                   "values (@ID,@EVENTID,@NAME,@TYPE,@VALUE);");
-            rel_stmt = db.prepare("INSERT INTO " TX_RELATION_TABLE " (name,sink,src)"
-                                  "values (@NAME,@ID1,@ID2);");
-
+            writer.reset(new BatchWriter(db));
         } catch(SQLiteDB::SQLiteException& e) {
             _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't open recording file");
         }
@@ -195,7 +460,17 @@ static void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason,
         try {
             // scv_out << "Transaction Recording is closing file: " <<
             // my_sqlite_file_name << endl;
+            writer.reset();
             db.exec("COMMIT TRANSACTION");
+            // creating the indexes after all rows are inserted is much faster than maintaining them while inserting
+            db.exec("CREATE INDEX IF NOT EXISTS " TX_TABLE "_stream ON " TX_TABLE "(stream);");
+            db.exec("CREATE INDEX IF NOT EXISTS " TX_TABLE "_generator ON " TX_TABLE "(generator);");
+            db.exec("CREATE INDEX IF NOT EXISTS " TX_EVENT_TABLE "_tx ON " TX_EVENT_TABLE "(tx);");
+            db.exec("CREATE INDEX IF NOT EXISTS " TX_ATTRIBUTE_TABLE "_tx ON " TX_ATTRIBUTE_TABLE "(tx);");
+            db.exec("CREATE INDEX IF NOT EXISTS " TX_RELATION_TABLE "_src ON " TX_RELATION_TABLE "(src);");
+            db.exec("CREATE INDEX IF NOT EXISTS " TX_RELATION_TABLE "_sink ON " TX_RELATION_TABLE "(sink);");
+            // fold the WAL back so the database is a single file
+            db.exec("PRAGMA journal_mode=DELETE");
             db.close();
         } catch(SQLiteDB::SQLiteException& e) {
             _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't close recording file");
@@ -207,41 +482,42 @@ static void dbCb(const scv_tr_db& _scv_tr_db, scv_tr_db::callback_reason reason,
 }
 // ----------------------------------------------------------------------------
 static void streamCb(const scv_tr_stream& s, scv_tr_stream::callback_reason reason, void* data) {
-    if(reason == scv_tr_stream::CREATE && db.isOpen()) {
-        try {
-            sqlite3_bind_int64(stream_stmt, 1, s.get_id());
-            sqlite3_bind_text(stream_stmt, 2, s.get_name(), -1, SQLITE_TRANSIENT);
-            sqlite3_bind_text(stream_stmt, 3, s.get_stream_kind() ? s.get_stream_kind() : "<unnamed>", -1,
-                              SQLITE_TRANSIENT);
-            db.exec(stream_stmt);
-            if(concurrencyLevel.size() <= s.get_id())
-                concurrencyLevel.resize(s.get_id() + 1);
-            concurrencyLevel[s.get_id()] = new vector<uint64_t>();
-        } catch(SQLiteDB::SQLiteException& e) {
-            _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create stream");
-        }
+    if(reason == scv_tr_stream::CREATE && writer) {
+        writer->rows().streams.push_back({static_cast<int64_t>(s.get_id()), s.get_name(),
+                                          s.get_stream_kind() ? s.get_stream_kind() : "<unnamed>"});
+        writer->row_added();
+        if(concurrencyLevel.size() <= s.get_id())
+            concurrencyLevel.resize(s.get_id() + 1);
+        concurrencyLevel[s.get_id()] = new vector<uint64_t>();
     }
 }
 // ----------------------------------------------------------------------------
-void recordAttribute(uint64_t id, EventType event, const string& name, data_type type, const string& value) {
-    try {
-        sqlite3_bind_int64(attr_stmt, 1, id);
-        sqlite3_bind_int(attr_stmt, 2, event);
-        sqlite3_bind_text(attr_stmt, 3, name.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_int(attr_stmt, 4, type);
-        sqlite3_bind_text(attr_stmt, 5, value.c_str(), -1, SQLITE_TRANSIENT);
-        db.exec(attr_stmt);
-    } catch(SQLiteDB::SQLiteException& e) {
-        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create attribute entry");
-    }
+inline Batch::Attribute& addAttribute(uint64_t id, EventType event, string&& name, data_type type,
+                                      Batch::ValueKind kind) {
+    auto& attrs = writer->rows().attributes;
+    attrs.emplace_back();
+    auto& attr = attrs.back();
+    attr.tx = id;
+    attr.event = event;
+    attr.name = std::move(name);
+    attr.type = type;
+    attr.kind = kind;
+    return attr;
+}
+// ----------------------------------------------------------------------------
+inline void recordAttribute(uint64_t id, EventType event, string&& name, data_type type, const string& value) {
+    addAttribute(id, event, std::move(name), type, Batch::TEXT_VALUE).sval = value;
+    writer->row_added();
 }
 // ----------------------------------------------------------------------------
-inline void recordAttribute(uint64_t id, EventType event, const string& name, data_type type, long long value) {
-    recordAttribute(id, event, name, type, std::to_string(value));
+inline void recordAttribute(uint64_t id, EventType event, string&& name, data_type type, long long value) {
+    addAttribute(id, event, std::move(name), type, Batch::INTEGER_VALUE).ival = value;
+    writer->row_added();
 }
 // ----------------------------------------------------------------------------
-inline void recordAttribute(uint64_t id, EventType event, const string& name, data_type type, double value) {
-    recordAttribute(id, event, name, type, std::to_string(value));
+inline void recordAttribute(uint64_t id, EventType event, string&& name, data_type type, double value) {
+    addAttribute(id, event, std::move(name), type, Batch::REAL_VALUE).dval = value;
+    writer->row_added();
 }
 // ----------------------------------------------------------------------------
 static void recordAttributes(uint64_t id, EventType eventType, string& prefix, const scv_extensions_if* my_exts_p) {
@@ -270,37 +546,41 @@ static void recordAttributes(uint64_t id, EventType eventType, string& prefix, c
         }
     } break;
     case scv_extensions_if::ENUMERATION:
-        recordAttribute(id, eventType, name, scv_extensions_if::ENUMERATION,
+        recordAttribute(id, eventType, std::move(name), scv_extensions_if::ENUMERATION,
                         my_exts_p->get_enum_string((int)(my_exts_p->get_integer())));
         break;
     case scv_extensions_if::BOOLEAN:
-        recordAttribute(id, eventType, name, scv_extensions_if::BOOLEAN, my_exts_p->get_bool() ? "TRUE" : "FALSE");
+        recordAttribute(id, eventType, std::move(name), scv_extensions_if::BOOLEAN,
+                        my_exts_p->get_bool() ? 1LL : 0LL);
         break;
     case scv_extensions_if::INTEGER:
     case scv_extensions_if::FIXED_POINT_INTEGER:
-        recordAttribute(id, eventType, name, scv_extensions_if::INTEGER, my_exts_p->get_integer());
+        recordAttribute(id, eventType, std::move(name), scv_extensions_if::INTEGER, my_exts_p->get_integer());
         break;
     case scv_extensions_if::UNSIGNED:
-        recordAttribute(id, eventType, name, scv_extensions_if::UNSIGNED, my_exts_p->get_integer());
+        recordAttribute(id, eventType, std::move(name), scv_extensions_if::UNSIGNED,
+                        static_cast<long long>(my_exts_p->get_unsigned()));
         break;
     case scv_extensions_if::POINTER:
-        recordAttribute(id, eventType, name, scv_extensions_if::POINTER, (long long)my_exts_p->get_pointer());
+        recordAttribute(id, eventType, std::move(name), scv_extensions_if::POINTER,
+                        (long long)my_exts_p->get_pointer());
         break;
     case scv_extensions_if::STRING:
-        recordAttribute(id, eventType, name, scv_extensions_if::STRING, my_exts_p->get_string());
+        recordAttribute(id, eventType, std::move(name), scv_extensions_if::STRING, my_exts_p->get_string());
         break;
     case scv_extensions_if::FLOATING_POINT_NUMBER:
-        recordAttribute(id, eventType, name, scv_extensions_if::FLOATING_POINT_NUMBER, my_exts_p->get_double());
+        recordAttribute(id, eventType, std::move(name), scv_extensions_if::FLOATING_POINT_NUMBER,
+                        my_exts_p->get_double());
         break;
     case scv_extensions_if::BIT_VECTOR: {
         sc_bv_base tmp_bv(my_exts_p->get_bitwidth());
         my_exts_p->get_value(tmp_bv);
-        recordAttribute(id, eventType, name, scv_extensions_if::BIT_VECTOR, tmp_bv.to_string());
+        recordAttribute(id, eventType, std::move(name), scv_extensions_if::BIT_VECTOR, tmp_bv.to_string());
     } break;
     case scv_extensions_if::LOGIC_VECTOR: {
         sc_lv_base tmp_lv(my_exts_p->get_bitwidth());
         my_exts_p->get_value(tmp_lv);
-        recordAttribute(id, eventType, name, scv_extensions_if::LOGIC_VECTOR, tmp_lv.to_string());
+        recordAttribute(id, eventType, std::move(name), scv_extensions_if::LOGIC_VECTOR, tmp_lv.to_string());
     } break;
     case scv_extensions_if::ARRAY:
         for(int array_elt_index = 0; array_elt_index < my_exts_p->get_array_size(); array_elt_index++) {
@@ -317,20 +597,15 @@ static void recordAttributes(uint64_t id, EventType eventType, string& prefix, c
 }
 // ----------------------------------------------------------------------------
 static void generatorCb(const scv_tr_generator_base& g, scv_tr_generator_base::callback_reason reason, void* data) {
-    if(reason == scv_tr_generator_base::CREATE && db.isOpen()) {
-        try {
-            sqlite3_bind_int64(gen_stmt, 1, g.get_id());
-            sqlite3_bind_int64(gen_stmt, 2, g.get_scv_tr_stream().get_id());
-            sqlite3_bind_text(gen_stmt, 3, g.get_name(), -1, SQLITE_TRANSIENT);
-            db.exec(gen_stmt);
-        } catch(SQLiteDB::SQLiteException& e) {
-            _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create generator entry");
-        }
+    if(reason == scv_tr_generator_base::CREATE && writer) {
+        writer->rows().generators.push_back(
+            {static_cast<int64_t>(g.get_id()), static_cast<int64_t>(g.get_scv_tr_stream().get_id()), g.get_name()});
+        writer->row_added();
     }
 }
 // ----------------------------------------------------------------------------
 static void transactionCb(const scv_tr_handle& t, scv_tr_handle::callback_reason reason, void* data) {
-    if(!db.isOpen())
+    if(!writer)
         return;
     if(t.get_scv_tr_stream().get_scv_tr_db() == nullptr)
         return;
@@ -343,36 +618,27 @@ static void transactionCb(const scv_tr_handle& t, scv_tr_handle::callback_reason
     const scv_extensions_if* my_exts_p;
     switch(reason) {
     case scv_tr_handle::BEGIN: {
-        try {
-            if(concurrencyLevel.size() <= streamId)
-                concurrencyLevel.resize(streamId + 1);
-            vector<uint64_t>* levels = concurrencyLevel[streamId];
-            if(levels == nullptr) {
-                levels = new vector<uint64_t>();
-                concurrencyLevel[id] = levels;
-            }
-            for(concurrencyIdx = 0; concurrencyIdx < levels->size(); ++concurrencyIdx)
-                if((*levels)[concurrencyIdx] == 0)
-                    break;
-            if(concurrencyIdx == levels->size())
-                levels->push_back(id);
-            else
-                (*levels)[concurrencyIdx] = id;
-
-            sqlite3_bind_int64(tx_stmt, 1, id);
-            sqlite3_bind_int64(tx_stmt, 2, t.get_scv_tr_generator_base().get_id());
-            sqlite3_bind_int64(tx_stmt, 3, t.get_scv_tr_stream().get_id());
-            sqlite3_bind_int64(tx_stmt, 3, concurrencyIdx);
-            db.exec(tx_stmt);
+        if(concurrencyLevel.size() <= streamId)
+            concurrencyLevel.resize(streamId + 1);
+        vector<uint64_t>* levels = concurrencyLevel[streamId];
+        if(levels == nullptr) {
+            levels = new vector<uint64_t>();
+            concurrencyLevel[streamId] = levels;
+        }
+        for(concurrencyIdx = 0; concurrencyIdx < levels->size(); ++concurrencyIdx)
+            if((*levels)[concurrencyIdx] == 0)
+                break;
+        if(concurrencyIdx == levels->size())
+            levels->push_back(id);
+        else
+            (*levels)[concurrencyIdx] = id;
 
-            sqlite3_bind_int64(evt_stmt, 1, id);
-            sqlite3_bind_int(evt_stmt, 2, BEGIN);
-            sqlite3_bind_int64(evt_stmt, 3, t.get_begin_sc_time().value());
-            db.exec(evt_stmt);
+        auto& rows = writer->rows();
+        rows.txs.push_back({static_cast<int64_t>(id), static_cast<int64_t>(t.get_scv_tr_generator_base().get_id()),
+                            static_cast<int64_t>(streamId), static_cast<int64_t>(concurrencyIdx)});
+        rows.events.push_back({static_cast<int64_t>(id), BEGIN, static_cast<int64_t>(t.get_begin_sc_time().value())});
+        writer->row_added();
 
-        } catch(SQLiteDB::SQLiteException& e) {
-            _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, e.errorMessage());
-        }
         my_exts_p = t.get_begin_exts_p();
         if(my_exts_p == nullptr) {
             my_exts_p = t.get_scv_tr_generator_base().get_begin_exts_p();
@@ -383,24 +649,19 @@ static void transactionCb(const scv_tr_handle& t, scv_tr_handle::callback_reason
         recordAttributes(id, BEGIN, tmp_str, my_exts_p);
     } break;
     case scv_tr_handle::END: {
-        try {
-            vector<uint64_t>* levels = concurrencyLevel[streamId];
-            for(concurrencyIdx = 0; concurrencyIdx < levels->size(); ++concurrencyIdx)
-                if((*levels)[concurrencyIdx] == id)
-                    break;
-            if(concurrencyIdx == levels->size())
-                levels->push_back(id);
-            else
-                levels->at(concurrencyIdx) = id;
+        vector<uint64_t>* levels = concurrencyLevel[streamId];
+        for(concurrencyIdx = 0; concurrencyIdx < levels->size(); ++concurrencyIdx)
+            if((*levels)[concurrencyIdx] == id)
+                break;
+        if(concurrencyIdx == levels->size())
+            levels->push_back(id);
+        else
+            levels->at(concurrencyIdx) = id;
 
-            sqlite3_bind_int64(evt_stmt, 1, t.get_id());
-            sqlite3_bind_int(evt_stmt, 2, END);
-            sqlite3_bind_int64(evt_stmt, 3, t.get_end_sc_time().value());
-            db.exec(evt_stmt);
+        writer->rows().events.push_back(
+            {static_cast<int64_t>(id), END, static_cast<int64_t>(t.get_end_sc_time().value())});
+        writer->row_added();
 
-        } catch(SQLiteDB::SQLiteException& e) {
-            _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create transaction end");
-        }
         my_exts_p = t.get_end_exts_p();
         if(my_exts_p == nullptr) {
             my_exts_p = t.get_scv_tr_generator_base().get_end_exts_p();
@@ -415,7 +676,7 @@ static void transactionCb(const scv_tr_handle& t, scv_tr_handle::callback_reason
 }
 // ----------------------------------------------------------------------------
 static void attributeCb(const scv_tr_handle& t, const char* name, const scv_extensions_if* ext, void* data) {
-    if(!db.isOpen())
+    if(!writer)
         return;
     if(t.get_scv_tr_stream().get_scv_tr_db() == nullptr)
         return;
@@ -427,21 +688,15 @@ static void attributeCb(const scv_tr_handle& t, const char* name, const scv_exte
 // ----------------------------------------------------------------------------
 static void relationCb(const scv_tr_handle& tr_1, const scv_tr_handle& tr_2, void* data,
                        scv_tr_relation_handle_t relation_handle) {
-    if(!db.isOpen())
+    if(!writer)
         return;
     if(tr_1.get_scv_tr_stream().get_scv_tr_db() == nullptr)
         return;
     if(tr_1.get_scv_tr_stream().get_scv_tr_db()->get_recording() == false)
         return;
-    try {
-        sqlite3_bind_text(rel_stmt, 1, tr_1.get_scv_tr_stream().get_scv_tr_db()->get_relation_name(relation_handle), -1,
-                          SQLITE_TRANSIENT);
-        sqlite3_bind_int64(rel_stmt, 2, tr_1.get_id());
-        sqlite3_bind_int64(rel_stmt, 3, tr_2.get_id());
-        db.exec(rel_stmt);
-    } catch(SQLiteDB::SQLiteException& e) {
-        _scv_message::message(_scv_message::TRANSACTION_RECORDING_INTERNAL, "Can't create transaction relation");
-    }
+    writer->rows().relations.push_back({tr_1.get_scv_tr_stream().get_scv_tr_db()->get_relation_name(relation_handle),
+                                        static_cast<int64_t>(tr_1.get_id()), static_cast<int64_t>(tr_2.get_id())});
+    writer->row_added();
 }
 // ----------------------------------------------------------------------------
 void scv_tr_sqlite_init() {
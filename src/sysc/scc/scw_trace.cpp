@@ -0,0 +1,390 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#include "scw_trace.hh"
+#include "trace/types.hh"
+#include "utilities.h"
+#include <lz4.h>
+#include <unordered_map>
+#include <util/scw_format.h>
+
+namespace scc {
+namespace trace {
+using util::scw::value_kind;
+
+template <typename T> inline value_kind kind_of() {
+    return std::is_floating_point<T>::value ? value_kind::REAL : value_kind::INTEGER;
+}
+template <> inline value_kind kind_of<sc_dt::sc_logic>() { return value_kind::BITS; }
+template <> inline value_kind kind_of<sc_dt::sc_signed>() { return value_kind::BITS; }
+template <> inline value_kind kind_of<sc_dt::sc_unsigned>() { return value_kind::BITS; }
+template <> inline value_kind kind_of<sc_dt::sc_bv_base>() { return value_kind::BITS; }
+template <> inline value_kind kind_of<sc_dt::sc_lv_base>() { return value_kind::BITS; }
+template <> inline value_kind kind_of<sc_dt::sc_fxval>() { return value_kind::REAL; }
+template <> inline value_kind kind_of<sc_dt::sc_fxval_fast>() { return value_kind::REAL; }
+template <> inline value_kind kind_of<sc_dt::sc_fxnum>() { return value_kind::REAL; }
+template <> inline value_kind kind_of<sc_dt::sc_fxnum_fast>() { return value_kind::REAL; }
+
+struct scw_trace {
+    scw_trace(std::string const& nm, value_kind kind, unsigned bits)
+    : name{nm}
+    , kind{kind}
+    , bits{bits} {}
+    //! appends the encoded current value
+    virtual void record(std::string& os) = 0;
+
+    virtual uintptr_t get_hash() = 0;
+
+    virtual ~scw_trace(){};
+
+    const std::string name;
+    uint32_t column{0};
+    bool is_alias{false};
+    const value_kind kind;
+    const unsigned bits;
+};
+
+template <typename T, typename OT = T> struct scw_trace_t : public scw_trace {
+    scw_trace_t(const T& object_, const std::string& name)
+    : scw_trace(name, kind_of<T>(), trace::traits<T>::get_bits(object_))
+    , act_val(object_)
+    , old_val(object_) {}
+
+    uintptr_t get_hash() override { return reinterpret_cast<uintptr_t>(&act_val); }
+
+    inline bool changed() { return !is_alias && old_val != act_val; }
+
+    inline void update() { old_val = act_val; }
+
+    void record(std::string& os) override;
+
+    OT old_val;
+    const T& act_val;
+};
+
+inline void put_bits(std::string& os, std::string const& val) {
+    util::scw::put_varint(os, val.size());
+    os += val;
+}
+
+template <typename T, typename OT> inline void scw_trace_t<T, OT>::record(std::string& os) {
+    auto val = static_cast<uint64_t>(old_val);
+    util::scw::put_varint(os, bits < 64 ? val & ((1ULL << bits) - 1) : val);
+}
+template <> void scw_trace_t<float, float>::record(std::string& os) {
+    util::scw::put<double>(os, old_val);
+}
+template <> void scw_trace_t<double, double>::record(std::string& os) {
+    util::scw::put<double>(os, old_val);
+}
+template <> void scw_trace_t<sc_dt::sc_bit, sc_dt::sc_bit>::record(std::string& os) {
+    util::scw::put_varint(os, old_val.to_bool() ? 1 : 0);
+}
+#if(SYSTEMC_VERSION >= 20171012)
+template <> void scw_trace_t<sc_core::sc_time, sc_core::sc_time>::record(std::string& os) {
+    util::scw::put_varint(os, old_val.value());
+}
+#endif
+template <> void scw_trace_t<sc_dt::sc_logic, sc_dt::sc_logic>::record(std::string& os) {
+    util::scw::put_varint(os, 1);
+    os += old_val.to_char();
+}
+template <> void scw_trace_t<sc_dt::sc_int_base, sc_dt::sc_int_base>::record(std::string& os) {
+    auto val = static_cast<uint64_t>(old_val.to_int64());
+    util::scw::put_varint(os, bits < 64 ? val & ((1ULL << bits) - 1) : val);
+}
+template <> void scw_trace_t<sc_dt::sc_uint_base, sc_dt::sc_uint_base>::record(std::string& os) {
+    util::scw::put_varint(os, old_val.to_uint64());
+}
+template <> void scw_trace_t<sc_dt::sc_signed, sc_dt::sc_signed>::record(std::string& os) {
+    util::scw::put_varint(os, old_val.length());
+    for(int bitindex = old_val.length() - 1; bitindex >= 0; --bitindex)
+        os += '0' + old_val[bitindex].value();
+}
+template <> void scw_trace_t<sc_dt::sc_unsigned, sc_dt::sc_unsigned>::record(std::string& os) {
+    util::scw::put_varint(os, old_val.length());
+    for(int bitindex = old_val.length() - 1; bitindex >= 0; --bitindex)
+        os += '0' + old_val[bitindex].value();
+}
+template <> void scw_trace_t<sc_dt::sc_fxval, sc_dt::sc_fxval>::record(std::string& os) {
+    util::scw::put<double>(os, old_val.to_double());
+}
+template <> void scw_trace_t<sc_dt::sc_fxval_fast, sc_dt::sc_fxval_fast>::record(std::string& os) {
+    util::scw::put<double>(os, old_val.to_double());
+}
+template <> void scw_trace_t<sc_dt::sc_fxnum, sc_dt::sc_fxval>::record(std::string& os) {
+    util::scw::put<double>(os, old_val.to_double());
+}
+template <> void scw_trace_t<sc_dt::sc_fxnum_fast, sc_dt::sc_fxval_fast>::record(std::string& os) {
+    util::scw::put<double>(os, old_val.to_double());
+}
+template <> void scw_trace_t<sc_dt::sc_bv_base, sc_dt::sc_bv_base>::record(std::string& os) {
+    put_bits(os, old_val.to_string());
+}
+template <> void scw_trace_t<sc_dt::sc_lv_base, sc_dt::sc_lv_base>::record(std::string& os) {
+    put_bits(os, old_val.to_string());
+}
+} // namespace trace
+
+scw_trace_file::scw_trace_file(const char* name, std::function<bool()>& enable, size_t block_size)
+: check_enabled(enable)
+, out(std::string(name) + ".scw", std::ios::binary | std::ios::trunc)
+, block_size(block_size) {
+    std::string header(util::scw::file_magic, util::scw::magic_size);
+    util::scw::put<uint32_t>(header, util::scw::version);
+    util::scw::put<int32_t>(header, -12); // pico seconds
+    out.write(header.data(), header.size());
+    out_offset = header.size();
+#if defined(WITH_SC_TRACING_PHASE_CALLBACKS)
+    // remove from hierarchy
+    sc_object::detach();
+    // register regular (non-delta) callbacks
+    sc_object::register_simulation_phase_callback(SC_BEFORE_TIMESTEP);
+#else // explicitly register with simcontext
+    sc_core::sc_get_curr_simcontext()->add_trace_file(this);
+#endif
+}
+
+scw_trace_file::~scw_trace_file() {
+    // without a cycle the columns have not been set up and the names would refer to non-existing columns
+    if(!initialized) {
+        init();
+        initialized = true;
+    }
+    if(out.is_open()) {
+        for(auto& c : columns)
+            flush(c);
+        write_index();
+        out.close();
+    }
+    for(auto t : all_traces)
+        delete t.trc;
+}
+
+template <typename T, typename OT = T> bool changed(trace::scw_trace* trace) {
+    if(reinterpret_cast<trace::scw_trace_t<T, OT>*>(trace)->changed()) {
+        reinterpret_cast<trace::scw_trace_t<T, OT>*>(trace)->update();
+        return true;
+    } else
+        return false;
+}
+#define DECL_TRACE_METHOD_A(tp)                                                                                        \
+    void scw_trace_file::trace(const tp& object, const std::string& name) {                                            \
+        all_traces.emplace_back(&changed<tp>, new trace::scw_trace_t<tp>(object, name));                               \
+    }
+#define DECL_TRACE_METHOD_B(tp)                                                                                        \
+    void scw_trace_file::trace(const tp& object, const std::string& name, int width) {                                 \
+        all_traces.emplace_back(&changed<tp>, new trace::scw_trace_t<tp>(object, name));                               \
+    }
+#define DECL_TRACE_METHOD_C(tp, tpo)                                                                                   \
+    void scw_trace_file::trace(const tp& object, const std::string& name) {                                            \
+        all_traces.emplace_back(&changed<tp, tpo>, new trace::scw_trace_t<tp, tpo>(object, name));                     \
+    }
+
+#if(SYSTEMC_VERSION >= 20171012)
+void scw_trace_file::trace(const sc_core::sc_event& object, const std::string& name) {}
+DECL_TRACE_METHOD_A(sc_core::sc_time)
+#endif
+DECL_TRACE_METHOD_A(bool)
+DECL_TRACE_METHOD_A(sc_dt::sc_bit)
+DECL_TRACE_METHOD_A(sc_dt::sc_logic)
+
+DECL_TRACE_METHOD_B(unsigned char)
+DECL_TRACE_METHOD_B(unsigned short)
+DECL_TRACE_METHOD_B(unsigned int)
+DECL_TRACE_METHOD_B(unsigned long)
+#ifdef SYSTEMC_64BIT_PATCHES
+DECL_TRACE_METHOD_B(unsigned long long)
+#endif
+DECL_TRACE_METHOD_B(char)
+DECL_TRACE_METHOD_B(short)
+DECL_TRACE_METHOD_B(int)
+DECL_TRACE_METHOD_B(long)
+DECL_TRACE_METHOD_B(sc_dt::int64)
+DECL_TRACE_METHOD_B(sc_dt::uint64)
+
+DECL_TRACE_METHOD_A(float)
+DECL_TRACE_METHOD_A(double)
+DECL_TRACE_METHOD_A(sc_dt::sc_int_base)
+DECL_TRACE_METHOD_A(sc_dt::sc_uint_base)
+DECL_TRACE_METHOD_A(sc_dt::sc_signed)
+DECL_TRACE_METHOD_A(sc_dt::sc_unsigned)
+
+DECL_TRACE_METHOD_A(sc_dt::sc_fxval)
+DECL_TRACE_METHOD_A(sc_dt::sc_fxval_fast)
+DECL_TRACE_METHOD_C(sc_dt::sc_fxnum, sc_dt::sc_fxval)
+DECL_TRACE_METHOD_C(sc_dt::sc_fxnum_fast, sc_dt::sc_fxval_fast)
+
+DECL_TRACE_METHOD_A(sc_dt::sc_bv_base)
+DECL_TRACE_METHOD_A(sc_dt::sc_lv_base)
+#undef DECL_TRACE_METHOD_A
+#undef DECL_TRACE_METHOD_B
+#undef DECL_TRACE_METHOD_C
+
+void scw_trace_file::trace(const unsigned int& object, const std::string& name, const char** enum_literals) {
+    all_traces.emplace_back(&changed<unsigned int>, new trace::scw_trace_t<unsigned int>(object, name));
+}
+
+void scw_trace_file::write_comment(const std::string& comment) {}
+
+void scw_trace_file::init() {
+    std::unordered_map<uintptr_t, uint32_t> alias_map;
+    alias_map.reserve(all_traces.size());
+    columns.reserve(all_traces.size());
+    for(auto& e : all_traces) {
+        auto res = alias_map.emplace(e.trc->get_hash(), columns.size());
+        e.trc->is_alias = !res.second;
+        e.trc->column = res.first->second;
+        if(!e.trc->is_alias) {
+            columns.emplace_back(e.trc);
+            active_traces.push_back(e);
+        }
+    }
+}
+
+void scw_trace_file::cycle(bool delta_cycle) {
+    if(delta_cycle)
+        return;
+    auto time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
+    if(!initialized) {
+        init();
+        initialized = true;
+    } else if(check_enabled && !check_enabled()) {
+        if(pre_trigger_depth)
+            hold(time_stamp);
+        return;
+    }
+    if(holding)
+        release();
+    for(auto& e : active_traces) {
+        if(!e.compare_and_update(e.trc) && columns[e.trc->column].count + columns[e.trc->column].blocks.size())
+            continue;
+        auto& col = columns[e.trc->column];
+        auto size = begin_change(col, time_stamp);
+        e.trc->record(col.raw);
+        end_change(col, time_stamp, size);
+    }
+    // bound the memory used by the columns, each of them gets a (smaller) block
+    if(buffered > max_buffered)
+        for(auto& c : columns)
+            flush(c);
+}
+
+size_t scw_trace_file::begin_change(column& col, uint64_t time_stamp) {
+    auto size = col.raw.size();
+    if(!col.count)
+        col.t_first = col.t_last = time_stamp;
+    util::scw::put_varint(col.raw, time_stamp - col.t_last);
+    return size;
+}
+
+void scw_trace_file::end_change(column& col, uint64_t time_stamp, size_t size) {
+    col.t_last = time_stamp;
+    col.count++;
+    buffered += col.raw.size() - size;
+    if(col.raw.size() >= block_size)
+        flush(col);
+}
+
+void scw_trace_file::hold(uint64_t time_stamp) {
+    for(auto& e : active_traces)
+        if(e.compare_and_update(e.trc)) {
+            auto& held = columns[e.trc->column].held;
+            held.emplace_back(time_stamp, std::string());
+            e.trc->record(held.back().second);
+        }
+    // the last change before the window is kept as value at the beginning of the window
+    auto limit = time_stamp > pre_trigger_depth ? time_stamp - pre_trigger_depth : 0;
+    for(auto& c : columns) {
+        while(c.held.size() > 1 && c.held[1].first <= limit)
+            c.held.pop_front();
+        if(c.held.size() && c.held.front().first < limit)
+            c.held.front().first = limit;
+    }
+    holding = true;
+}
+
+void scw_trace_file::release() {
+    for(auto& c : columns) {
+        for(auto& h : c.held) {
+            auto size = begin_change(c, h.first);
+            c.raw += h.second;
+            end_change(c, h.first, size);
+        }
+        c.held.clear();
+    }
+    holding = false;
+}
+
+void scw_trace_file::flush(column& col) {
+    if(!col.count)
+        return;
+    cbuf.resize(LZ4_compressBound(col.raw.size()));
+    auto csize = LZ4_compress_default(col.raw.data(), cbuf.data(), col.raw.size(), cbuf.size());
+    out.write(cbuf.data(), csize);
+    col.blocks.push_back(block{out_offset, static_cast<uint32_t>(csize), static_cast<uint32_t>(col.raw.size()),
+                               col.t_first, col.t_last, col.count});
+    out_offset += csize;
+    buffered -= col.raw.size();
+    col.raw.clear();
+    col.count = 0;
+}
+
+void scw_trace_file::write_index() {
+    std::string index;
+    util::scw::put<uint32_t>(index, columns.size());
+    for(auto& c : columns) {
+        util::scw::put<uint8_t>(index, static_cast<uint8_t>(c.trc->kind));
+        util::scw::put<uint32_t>(index, c.trc->bits);
+        util::scw::put<uint32_t>(index, c.blocks.size());
+        for(auto& b : c.blocks) {
+            util::scw::put<uint64_t>(index, b.offset);
+            util::scw::put<uint32_t>(index, b.csize);
+            util::scw::put<uint32_t>(index, b.rsize);
+            util::scw::put<uint64_t>(index, b.t_first);
+            util::scw::put<uint64_t>(index, b.t_last);
+            util::scw::put<uint32_t>(index, b.count);
+        }
+    }
+    util::scw::put<uint32_t>(index, all_traces.size());
+    for(auto& e : all_traces) {
+        util::scw::put<uint32_t>(index, e.trc->column);
+        util::scw::put<uint32_t>(index, e.trc->name.size());
+        index += e.trc->name;
+    }
+    util::scw::put<uint64_t>(index, out_offset);
+    index.append(util::scw::index_magic, util::scw::magic_size);
+    out.write(index.data(), index.size());
+}
+
+void scw_trace_file::set_time_unit(double v, sc_core::sc_time_unit tu) {}
+
+void scw_trace_file::set_pre_trigger(sc_core::sc_time const& window) {
+    pre_trigger_depth = window.value() / (1_ps).value();
+}
+
+void scw_trace_file::set_rotation(uint64_t max_size, sc_core::sc_time const& max_time) {
+    if(max_size || max_time != sc_core::SC_ZERO_TIME)
+        SC_REPORT_WARNING("scc::scw_trace_file", "SCW files cannot be rotated, writing a single file");
+}
+
+sc_core::sc_trace_file* create_scw_trace_file(const char* name, std::function<bool()> enable) {
+    return new scw_trace_file(name, enable);
+}
+
+void close_scw_trace_file(sc_core::sc_trace_file* tf) { delete static_cast<scw_trace_file*>(tf); }
+
+} // namespace scc
@@ -0,0 +1,184 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef SCC_SCW_TRACE_H
+#define SCC_SCW_TRACE_H
+
+#include <scc/trace.h>
+#include <sysc/tracing/sc_trace.h>
+#include <sysc/kernel/sc_ver.h>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** \ingroup scc-sysc
+ *  @{
+ */
+/**@{*/
+//! @brief SCC SystemC utilities
+namespace scc {
+namespace trace {
+class scw_trace;
+}
+/**
+ * @class scw_trace_file
+ * @brief trace file writing the SCW waveform format
+ *
+ * The SCW format (see util/scw_format.h) stores the value changes of each signal in separately LZ4 compressed blocks
+ * and an index at the end of the file. util::scw_reader uses the index to extract single signals over a time range
+ * without reading the rest of the file. The values are pulled and compared in each timestep. Since the index covers
+ * the complete file it cannot be segmented, set_rotation() is not supported.
+ */
+struct scw_trace_file : public sc_core::sc_trace_file, public trace_capture_if {
+    /**
+     * @fn  scw_trace_file(const char*, std::function<bool()>&, size_t)
+     * @brief constructor
+     *
+     * @param name the name of the trace file without extension
+     * @param enable the functor returning if tracing is enabled
+     * @param block_size the (uncompressed) size of the value change blocks in bytes
+     */
+    scw_trace_file(const char *name, std::function<bool()>& enable, size_t block_size = 64 * 1024);
+
+    virtual ~scw_trace_file();
+
+    void set_enable(std::function<bool()> enable) override { check_enabled = enable; }
+
+    void set_pre_trigger(sc_core::sc_time const& window) override;
+
+    void set_rotation(uint64_t max_size, sc_core::sc_time const& max_time) override;
+
+protected:
+#define DECL_TRACE_METHOD_A(tp) void trace(const tp& object, const std::string& name) override;
+#define DECL_TRACE_METHOD_B(tp) void trace(const tp& object, const std::string& name, int width) override;
+
+#if (SYSTEMC_VERSION >= 20171012)
+    DECL_TRACE_METHOD_A( sc_core::sc_event )
+    DECL_TRACE_METHOD_A( sc_core::sc_time )
+#endif
+    DECL_TRACE_METHOD_A( bool )
+    DECL_TRACE_METHOD_A( sc_dt::sc_bit )
+    DECL_TRACE_METHOD_A( sc_dt::sc_logic )
+
+    DECL_TRACE_METHOD_B( unsigned char )
+    DECL_TRACE_METHOD_B( unsigned short )
+    DECL_TRACE_METHOD_B( unsigned int )
+    DECL_TRACE_METHOD_B( unsigned long )
+#ifdef SYSTEMC_64BIT_PATCHES
+    DECL_TRACE_METHOD_B( unsigned long long)
+#endif
+    DECL_TRACE_METHOD_B( char )
+    DECL_TRACE_METHOD_B( short )
+    DECL_TRACE_METHOD_B( int )
+    DECL_TRACE_METHOD_B( long )
+    DECL_TRACE_METHOD_B( sc_dt::int64 )
+    DECL_TRACE_METHOD_B( sc_dt::uint64 )
+
+    DECL_TRACE_METHOD_A( float )
+    DECL_TRACE_METHOD_A( double )
+    DECL_TRACE_METHOD_A( sc_dt::sc_int_base )
+    DECL_TRACE_METHOD_A( sc_dt::sc_uint_base )
+    DECL_TRACE_METHOD_A( sc_dt::sc_signed )
+    DECL_TRACE_METHOD_A( sc_dt::sc_unsigned )
+
+    DECL_TRACE_METHOD_A( sc_dt::sc_fxval )
+    DECL_TRACE_METHOD_A( sc_dt::sc_fxval_fast )
+    DECL_TRACE_METHOD_A( sc_dt::sc_fxnum )
+    DECL_TRACE_METHOD_A( sc_dt::sc_fxnum_fast )
+
+    DECL_TRACE_METHOD_A( sc_dt::sc_bv_base )
+    DECL_TRACE_METHOD_A( sc_dt::sc_lv_base )
+#undef DECL_TRACE_METHOD_A
+#undef DECL_TRACE_METHOD_B
+
+    void trace( const unsigned int& object,
+            const std::string& name,
+            const char** enum_literals ) override;
+
+    // Output a comment to the trace file
+     void write_comment(const std::string& comment) override;
+
+    // Write trace info for cycle.
+     void cycle(bool delta_cycle) override;
+
+     void set_time_unit( double v, sc_core::sc_time_unit tu ) override;
+
+private:
+#if WITH_SC_TRACING_PHASE_CALLBACKS
+    // avoid hidden overload warnings
+    virtual void trace( sc_trace_file* ) const;
+#endif
+
+    //! a block of value changes written to the file
+    struct block {
+        uint64_t offset;
+        uint32_t csize, rsize;
+        uint64_t t_first, t_last;
+        uint32_t count;
+    };
+    //! the value changes of a single (non-alias) trace
+    struct column {
+        trace::scw_trace* trc;
+        //! the encoded value changes not yet written
+        std::string raw;
+        uint64_t t_first{0}, t_last{0};
+        uint32_t count{0};
+        std::vector<block> blocks;
+        //! the time stamps and encoded values of the changes in the pre-trigger window while disabled
+        std::deque<std::pair<uint64_t, std::string>> held;
+        column(trace::scw_trace* trc)
+        : trc(trc) {}
+    };
+
+    void init();
+    size_t begin_change(column& col, uint64_t time_stamp);
+    void end_change(column& col, uint64_t time_stamp, size_t size);
+    void hold(uint64_t time_stamp);
+    void release();
+    void flush(column& col);
+    void write_index();
+    std::function<bool()> check_enabled;
+
+    struct trace_entry {
+        bool (*compare_and_update)(trace::scw_trace*);
+        trace::scw_trace* trc;
+        trace_entry(bool (*compare_and_update)(trace::scw_trace*), trace::scw_trace* trc)
+        :compare_and_update{compare_and_update}, trc{trc}{}
+    };
+    std::vector<trace_entry> all_traces, active_traces;
+    std::vector<column> columns;
+    std::ofstream out;
+    uint64_t out_offset{0};
+    size_t const block_size;
+    //! the number of bytes buffered in all columns
+    size_t buffered{0};
+    //! the maximum number of bytes buffered before all columns are written
+    static const size_t max_buffered = 64 * 1024 * 1024;
+    std::vector<char> cbuf;
+    bool initialized{false};
+    //! the length of the pre-trigger window in ps, 0 if disabled
+    uint64_t pre_trigger_depth{0};
+    //! true if value changes are kept in the columns' pre-trigger buffers
+    bool holding{false};
+};
+
+} // namespace scc
+/** @} */ // end of scc-sysc
+
+#endif // SCC_SCW_TRACE_H
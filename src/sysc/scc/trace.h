@@ -19,6 +19,7 @@
 
 #include "observer.h"
 #include <functional>
+#include <sysc/kernel/sc_time.h>
 #include <sysc/tracing/sc_trace.h>
 
 /** \ingroup scc-sysc
@@ -27,28 +28,95 @@
 /**@{*/
 //! @brief SCC SystemC utilities
 namespace scc {
+/**
+ * @class trace_capture_if
+ * @brief interface of the SCC trace files allowing to control when value changes are written
+ */
+struct trace_capture_if {
+    virtual ~trace_capture_if() = default;
+    /**
+     * @fn void set_enable(std::function<bool()>)
+     * @brief sets the functor being polled each cycle, value changes are only written while it returns true
+     *
+     * @param enable the functor
+     */
+    virtual void set_enable(std::function<bool()> enable) = 0;
+    /**
+     * @fn void set_pre_trigger(const sc_core::sc_time&)
+     * @brief sets the length of the window of value changes being kept while disabled. They are written once the
+     * trace file becomes enabled again. A zero time disables the buffering
+     *
+     * @param window the length of the window
+     */
+    virtual void set_pre_trigger(sc_core::sc_time const& window) = 0;
+    /**
+     * @fn void set_rotation(uint64_t, const sc_core::sc_time&)
+     * @brief lets the trace file roll over to a new segment file once a segment reaches the given size or duration.
+     * Each segment starts with a full dump of all values and is listed in a JSON manifest named <name>.<ext>.json.
+     * Needs to be called before the simulation starts, a new segment is only started while tracing is enabled
+     *
+     * @param max_size the maximum (uncompressed) size of a segment in bytes, 0 means unlimited
+     * @param max_time the maximum simulated time covered by a segment, zero means unlimited
+     */
+    virtual void set_rotation(uint64_t max_size, sc_core::sc_time const& max_time) = 0;
+};
 //! create VCD file which uses pull mechanism
 sc_core::sc_trace_file* create_vcd_pull_trace_file(const char* name,
                                                    std::function<bool()> enable = std::function<bool()>());
+//! create VCD file which uses pull mechanism, if compression_threads is not 0 the file is gzip compressed using the
+//! given number of threads in parallel
+sc_core::sc_trace_file* create_vcd_pull_trace_file(const char* name, unsigned compression_threads,
+                                                   std::function<bool()> enable = std::function<bool()>());
 //! close the VCD file
 void close_vcd_pull_trace_file(sc_core::sc_trace_file* tf);
 
 //! create VCD file which uses push mechanism
 sc_core::sc_trace_file* create_vcd_push_trace_file(const char* name,
                                                    std::function<bool()> enable = std::function<bool()>());
+//! create VCD file which uses push mechanism, if compression_threads is not 0 the file is gzip compressed using the
+//! given number of threads in parallel
+sc_core::sc_trace_file* create_vcd_push_trace_file(const char* name, unsigned compression_threads,
+                                                   std::function<bool()> enable = std::function<bool()>());
 //! close the VCD file
 void close_vcd_push_trace_file(sc_core::sc_trace_file* tf);
 
 //! create compressed VCD file which uses push mechanism and multithreading
 sc_core::sc_trace_file* create_vcd_mt_trace_file(const char* name,
                                                  std::function<bool()> enable = std::function<bool()>());
+//! create compressed VCD file which uses push mechanism and multithreading, the compression uses the given number of
+//! threads in parallel
+sc_core::sc_trace_file* create_vcd_mt_trace_file(const char* name, unsigned compression_threads,
+                                                 std::function<bool()> enable = std::function<bool()>());
 //! close the VCD file
 void close_vcd_mt_trace_file(sc_core::sc_trace_file* tf);
 
+//! create a live VCD trace publishing the value changes of each time step into a POSIX shared memory ring buffer named
+//! after the trace (see util::shm_ring_reader) instead of writing a file. If overwrite is true the oldest records are
+//! overwritten if the ring is full, otherwise new records are dropped. Returns nullptr if the ring can't be created.
+//! A snapshot holds the header and the values of all traces, it needs to fit into the ring. See examples/shm-consumer
+//! for a consumer
+sc_core::sc_trace_file* create_vcd_shm_trace_file(const char* name, size_t capacity = 16 * 1024 * 1024,
+                                                  bool overwrite = false,
+                                                  std::function<bool()> enable = std::function<bool()>());
+//! close the live VCD trace
+void close_vcd_shm_trace_file(sc_core::sc_trace_file* tf);
+
+//! the compression algorithms available for the FST value change blocks
+enum class fst_pack_type { ZLIB, FASTLZ, LZ4 };
 //! create FST file which uses pull mechanism
 sc_core::sc_trace_file* create_fst_trace_file(const char* name, std::function<bool()> enable = std::function<bool()>());
+//! create FST file which uses pull mechanism, if background is true the FST writer and the block compression run in
+//! separate threads
+sc_core::sc_trace_file* create_fst_trace_file(const char* name, bool background,
+                                              fst_pack_type pack = fst_pack_type::LZ4,
+                                              std::function<bool()> enable = std::function<bool()>());
 //! close the FST file
 void close_fst_trace_file(sc_core::sc_trace_file* tf);
+
+//! create a SCW file, a columnar waveform format with per-signal LZ4 compressed blocks allowing random access
+sc_core::sc_trace_file* create_scw_trace_file(const char* name, std::function<bool()> enable = std::function<bool()>());
+//! close the SCW file
+void close_scw_trace_file(sc_core::sc_trace_file* tf);
 } // namespace scc
 /** @} */ // end of scc-sysc
 #endif // SCC_SC_VCD_TRACE_H
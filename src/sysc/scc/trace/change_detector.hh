@@ -0,0 +1,276 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _SCC_TRACE_CHANGE_DETECTOR_HH_
+#define _SCC_TRACE_CHANGE_DETECTOR_HH_
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace scc {
+namespace trace {
+/**
+ * @fn unsigned shadow_size()
+ * @brief returns the size of the shadow value of a trace type, 0 if the type cannot be handled by the change_detector
+ *
+ * @return the size in bytes
+ */
+template <typename T> constexpr unsigned shadow_size() { return std::is_integral<T>::value ? sizeof(T) : 0; }
+
+namespace detail {
+/**
+ * @fn void compare_scalar(const T*, const T*, size_t, uint64_t*)
+ * @brief compares two arrays and sets a bit in bitmap for each element being different. The SIMD specializations of
+ * compare() use it for the remainder not filling a complete bitmap word
+ *
+ * @param a the first array
+ * @param b the second array
+ * @param n the number of elements
+ * @param bitmap the bitmap, needs to hold (n+63)/64 words which are overwritten
+ */
+template <typename T> inline void compare_scalar(T const* a, T const* b, size_t n, uint64_t* bitmap) {
+    for(size_t i = 0; i < n; i += 64) {
+        auto end = i + 64 < n ? i + 64 : n;
+        uint64_t bits = 0;
+        for(auto j = i; j < end; ++j)
+            bits |= static_cast<uint64_t>(a[j] != b[j]) << (j - i);
+        bitmap[i / 64] = bits;
+    }
+}
+
+template <typename T> inline void compare(T const* a, T const* b, size_t n, uint64_t* bitmap) {
+    compare_scalar(a, b, n, bitmap);
+}
+#if defined(__AVX512BW__)
+template <> inline void compare<uint8_t>(uint8_t const* a, uint8_t const* b, size_t n, uint64_t* bitmap) {
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64)
+        bitmap[i / 64] = _mm512_cmpneq_epu8_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+    if(i < n)
+        compare_scalar(a + i, b + i, n - i, bitmap + i / 64);
+}
+template <> inline void compare<uint16_t>(uint16_t const* a, uint16_t const* b, size_t n, uint64_t* bitmap) {
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        uint64_t lo = _mm512_cmpneq_epu16_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        uint64_t hi = _mm512_cmpneq_epu16_mask(_mm512_loadu_si512(a + i + 32), _mm512_loadu_si512(b + i + 32));
+        bitmap[i / 64] = lo | hi << 32;
+    }
+    if(i < n)
+        compare_scalar(a + i, b + i, n - i, bitmap + i / 64);
+}
+#elif defined(__AVX2__)
+template <> inline void compare<uint8_t>(uint8_t const* a, uint8_t const* b, size_t n, uint64_t* bitmap) {
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        auto lo = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i)),
+                                    _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i)));
+        auto hi = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i + 32)),
+                                    _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i + 32)));
+        bitmap[i / 64] = ~(static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(lo))) |
+                           static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hi))) << 32);
+    }
+    if(i < n)
+        compare_scalar(a + i, b + i, n - i, bitmap + i / 64);
+}
+template <> inline void compare<uint16_t>(uint16_t const* a, uint16_t const* b, size_t n, uint64_t* bitmap) {
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        uint64_t bits = 0;
+        for(unsigned k = 0; k < 64; k += 32) {
+            auto lo = _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i + k)),
+                                         _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i + k)));
+            auto hi = _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i + k + 16)),
+                                         _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i + k + 16)));
+            // packing interleaves the 128bit lanes, the permutation restores the element order
+            auto packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xd8);
+            bits |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(packed))) << k;
+        }
+        bitmap[i / 64] = ~bits;
+    }
+    if(i < n)
+        compare_scalar(a + i, b + i, n - i, bitmap + i / 64);
+}
+#endif
+#if defined(__AVX512F__)
+template <> inline void compare<uint32_t>(uint32_t const* a, uint32_t const* b, size_t n, uint64_t* bitmap) {
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        uint64_t bits = 0;
+        for(unsigned k = 0; k < 64; k += 16)
+            bits |= static_cast<uint64_t>(
+                        _mm512_cmpneq_epu32_mask(_mm512_loadu_si512(a + i + k), _mm512_loadu_si512(b + i + k)))
+                    << k;
+        bitmap[i / 64] = bits;
+    }
+    if(i < n)
+        compare_scalar(a + i, b + i, n - i, bitmap + i / 64);
+}
+template <> inline void compare<uint64_t>(uint64_t const* a, uint64_t const* b, size_t n, uint64_t* bitmap) {
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        uint64_t bits = 0;
+        for(unsigned k = 0; k < 64; k += 8)
+            bits |= static_cast<uint64_t>(
+                        _mm512_cmpneq_epu64_mask(_mm512_loadu_si512(a + i + k), _mm512_loadu_si512(b + i + k)))
+                    << k;
+        bitmap[i / 64] = bits;
+    }
+    if(i < n)
+        compare_scalar(a + i, b + i, n - i, bitmap + i / 64);
+}
+#elif defined(__AVX2__)
+template <> inline void compare<uint32_t>(uint32_t const* a, uint32_t const* b, size_t n, uint64_t* bitmap) {
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        uint64_t bits = 0;
+        for(unsigned k = 0; k < 64; k += 8) {
+            auto eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i + k)),
+                                         _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i + k)));
+            bits |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(eq))) << k;
+        }
+        bitmap[i / 64] = ~bits;
+    }
+    if(i < n)
+        compare_scalar(a + i, b + i, n - i, bitmap + i / 64);
+}
+template <> inline void compare<uint64_t>(uint64_t const* a, uint64_t const* b, size_t n, uint64_t* bitmap) {
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        uint64_t bits = 0;
+        for(unsigned k = 0; k < 64; k += 4) {
+            auto eq = _mm256_cmpeq_epi64(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i + k)),
+                                         _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i + k)));
+            bits |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(eq))) << k;
+        }
+        bitmap[i / 64] = ~bits;
+    }
+    if(i < n)
+        compare_scalar(a + i, b + i, n - i, bitmap + i / 64);
+}
+#endif
+} // namespace detail
+/**
+ * @class change_detector
+ * @brief detects value changes of scalar traces (bool and integers up to 64 bit)
+ *
+ * The traced values are grouped by their width into structure-of-arrays: per group the addresses of the traced
+ * objects, the values seen in the last scan (shadow) and the entries of the trace file. A scan gathers the current
+ * values into a contiguous array, compares it with the shadow array (using AVX2 or AVX-512 if the compiler targets it)
+ * into a change bitmap and dispatches only the changed entries.
+ *
+ * @tparam E the type of the trace file entries being dispatched
+ */
+template <typename E> class change_detector {
+public:
+    /**
+     * @fn bool add(E*, const void*, unsigned)
+     * @brief adds a traced value, the current value is taken as the shadow value
+     *
+     * @param entry the entry to dispatch if the value changes
+     * @param value the address of the traced value
+     * @param size the size of the traced value as returned by shadow_size()
+     * @return false if the size is not supported and the entry has not been added
+     */
+    bool add(E* entry, void const* value, unsigned size) {
+        switch(size) {
+        case 1:
+            g8.add(entry, value);
+            return true;
+        case 2:
+            g16.add(entry, value);
+            return true;
+        case 4:
+            g32.add(entry, value);
+            return true;
+        case 8:
+            g64.add(entry, value);
+            return true;
+        default:
+            return false;
+        }
+    }
+    /**
+     * @fn size_t size()const
+     * @brief returns the number of added values
+     *
+     * @return the number of values
+     */
+    size_t size() const { return g8.entries.size() + g16.entries.size() + g32.entries.size() + g64.entries.size(); }
+    /**
+     * @fn void scan(F)
+     * @brief scans all values and calls the functor for each changed one
+     *
+     * @param f the functor taking an E&
+     */
+    template <typename F> void scan(F f) {
+        g8.scan(f);
+        g16.scan(f);
+        g32.scan(f);
+        g64.scan(f);
+    }
+
+private:
+    template <typename T> struct group {
+        std::vector<void const*> src;
+        std::vector<T> current, shadow;
+        std::vector<E*> entries;
+        std::vector<uint64_t> bitmap;
+
+        void add(E* entry, void const* value) {
+            T v;
+            memcpy(&v, value, sizeof(T));
+            src.push_back(value);
+            shadow.push_back(v);
+            current.push_back(v);
+            entries.push_back(entry);
+            bitmap.resize((entries.size() + 63) / 64);
+        }
+
+        template <typename F> void scan(F& f) {
+            auto const n = src.size();
+            if(!n)
+                return;
+            auto const* s = src.data();
+            auto* c = current.data();
+            for(size_t i = 0; i < n; ++i)
+                memcpy(c + i, s[i], sizeof(T));
+            detail::compare(c, shadow.data(), n, bitmap.data());
+            // the gathered values become the shadow values of the next scan
+            current.swap(shadow);
+            for(size_t w = 0; w < bitmap.size(); ++w) {
+                auto bits = bitmap[w];
+                while(bits) {
+                    auto idx = w * 64 + __builtin_ctzll(bits);
+                    bits &= bits - 1;
+                    f(*entries[idx]);
+                }
+            }
+        }
+    };
+    group<uint8_t> g8;
+    group<uint16_t> g16;
+    group<uint32_t> g32;
+    group<uint64_t> g64;
+};
+} // namespace trace
+} // namespace scc
+#endif /* _SCC_TRACE_CHANGE_DETECTOR_HH_ */
@@ -8,106 +8,323 @@
 #ifndef _SCC_TRACE_GZ_WRITER_HH_
 #define _SCC_TRACE_GZ_WRITER_HH_
 
-#include <boost/lockfree/spsc_queue.hpp>
-#include <boost/atomic.hpp>
-#include <thread>
-#include <mutex>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
 #include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <cstring>
+#include <thread>
+#include <util/thread_pool.h>
+#include <vector>
 #include <zlib.h>
-#include <chrono>
 
 namespace scc {
 namespace trace {
-
+/**
+ * @class gz_writer
+ * @brief a chunked, multi-buffered writer for gzip compressed output
+ *
+ * The producer (the simulation thread) appends data into the current chunk without any lock or allocation. Full chunks
+ * are handed over to a background thread which writes them in order. The number of chunks is bounded, if all of them
+ * are in flight the producer blocks until the writer thread has released one (back-pressure). The destructor writes all
+ * pending data before closing the file.
+ *
+ * If more than one compression thread is requested the chunks are compressed in parallel (similar to pigz): each chunk
+ * is deflated as an independent, byte aligned block using the last 32kB of the preceding chunk as dictionary. The
+ * blocks are concatenated in order into a single gzip member so the output stays a standard gzip file. If no
+ * compression thread is requested the data is written uncompressed.
+ *
+ * Only a single producer thread is supported.
+ */
 class gz_writer {
-    static const size_t queue_size=16*1024;
-    std::deque<char*> pool;
-    std::deque<char*> write_queue;
-    boost::atomic<bool> done {false};
-    std::condition_variable cond;
+public:
+    //! the default size of a chunk
+    static const size_t default_chunk_size = 1024 * 1024;
+    //! the default maximum number of chunks in flight
+    static const size_t default_max_chunks = 8;
+    /**
+     * @struct statistics
+     * @brief counters describing the operation of the writer
+     */
+    struct statistics {
+        //! number of uncompressed bytes handed to the writer
+        uint64_t bytes{0};
+        //! number of chunks handed to the writer thread
+        uint64_t chunks{0};
+        //! number of times the producer had to wait for a free chunk
+        uint64_t stalls{0};
+    };
+    /**
+     * @fn  gz_writer(const std::string&, unsigned, unsigned, size_t, size_t)
+     * @brief constructor opening the output file and starting the writer thread
+     *
+     * @param filename the name of the output file, if empty nothing is written (e.g. if the output is diverted)
+     * @param threads the number of threads compressing in parallel, 0 writes uncompressed data
+     * @param level the compression level (1..9)
+     * @param chunk_size the size of a single chunk in bytes
+     * @param max_chunks the maximum number of chunks being allocated, bounds the memory used by the writer. If 0 the
+     * default or twice the number of threads is used, whatever is larger
+     */
+    gz_writer(std::string const& filename, unsigned threads = 1, unsigned level = 3,
+              size_t chunk_size = default_chunk_size, size_t max_chunks = 0)
+    : chunk_size(std::max<size_t>(chunk_size, 4096))
+    , max_chunks(std::max<size_t>(max_chunks ? max_chunks : 2 * threads > default_max_chunks ? 2 * threads : default_max_chunks, 2))
+    , level(std::max(1U, std::min(level, 9U)))
+    , compressed(threads > 0) {
+        if(filename.size())
+            out = fopen(filename.c_str(), "wb");
+        if(out && compressed) {
+            // gzip header: magic, deflate, no flags, no mtime, no extra flags, unix
+            unsigned char const header[] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3};
+            fwrite(header, 1, sizeof(header), out);
+        }
+        if(threads > 1) {
+            pool.reset(new util::thread_pool);
+            pool->start(threads);
+        }
+        current = allocate();
+        writer = std::thread([this]() { run(); });
+    }
 
-    std::deque<char*> pool_buffer;
-    gzFile vcd_out{nullptr};
-    std::thread logger;
+    gz_writer(gz_writer const&) = delete;
 
-    inline void write_out(){
-        while (!write_queue.empty()) {
-            auto* value = write_queue.front();
-            write_queue.pop_front();
-            auto len = strlen(value);
-            if(len) gzwrite(vcd_out, value, strlen(value));
-            memset(value, 0, buffer_size);
-            pool.push_back(value);
+    gz_writer& operator=(gz_writer const&) = delete;
+    /**
+     * @fn  ~gz_writer()
+     * @brief destructor, writes all pending data, stops the writer thread and closes the file
+     */
+    ~gz_writer() {
+        if(current->size)
+            submit(current);
+        {
+            lock_type lock(mtx);
+            done = true;
         }
+        job_cond.notify_one();
+        writer.join();
+        pool.reset();
+        if(out) {
+            if(compressed) {
+                // an empty final block with fixed Huffman codes followed by the gzip trailer
+                unsigned char trailer[] = {0x03,
+                                           0x00,
+                                           static_cast<unsigned char>(crc),
+                                           static_cast<unsigned char>(crc >> 8),
+                                           static_cast<unsigned char>(crc >> 16),
+                                           static_cast<unsigned char>(crc >> 24),
+                                           static_cast<unsigned char>(total),
+                                           static_cast<unsigned char>(total >> 8),
+                                           static_cast<unsigned char>(total >> 16),
+                                           static_cast<unsigned char>(total >> 24)};
+                fwrite(trailer, 1, sizeof(trailer), out);
+            }
+            fclose(out);
+        }
+    }
+    /**
+     * @fn void write(const char*, size_t)
+     * @brief appends data to the output
+     *
+     * @param msg pointer to the data
+     * @param size the number of bytes to write
+     */
+    inline void write(char const* msg, size_t size) {
+        if(diversion) {
+            diversion->append(msg, size);
+            return;
+        }
+        stats.bytes += size;
+        while(size > chunk_size - current->size) {
+            auto avail = chunk_size - current->size;
+            memcpy(current->data.get() + current->size, msg, avail);
+            current->size += avail;
+            msg += avail;
+            size -= avail;
+            submit(current);
+            current = acquire();
+        }
+        memcpy(current->data.get() + current->size, msg, size);
+        current->size += size;
     }
-    void log(void){
-        auto const timeout = std::chrono::milliseconds(1);
-        while (!done) {
-            std::unique_lock<std::mutex> lock(writer_mtx);
-            auto now = std::chrono::system_clock::now();
-            cond.wait_until(lock, now+timeout, [this]() -> bool { return done || ! write_queue.empty(); });
-            write_out();
+    /**
+     * @fn void write(const std::string&)
+     * @brief appends a string to the output
+     *
+     * @param msg the string
+     */
+    inline void write(std::string const& msg) { write(msg.c_str(), msg.length()); }
+    /**
+     * @fn void write_single(const std::string&)
+     * @brief appends a string to the output, kept for compatibility, same as write(std::string const&)
+     *
+     * @param msg the string
+     */
+    inline void write_single(std::string const& msg) { write(msg.c_str(), msg.length()); }
+    /**
+     * @fn void flush()
+     * @brief hands the current chunk over to the writer thread even if it is not full
+     */
+    void flush() {
+        if(current->size) {
+            submit(current);
+            current = acquire();
         }
-        write_out();
     }
+    /**
+     * @fn void divert(std::string*)
+     * @brief redirects all subsequent writes into a string instead of the output, used to buffer data temporarily
+     *
+     * @param sink the string to append to, nullptr ends the diversion
+     */
+    void divert(std::string* sink) { diversion = sink; }
+    /**
+     * @fn const statistics& get_statistics()const
+     * @brief returns the statistics of the writer
+     *
+     * @return the statistics
+     */
+    statistics const& get_statistics() const { return stats; }
+
+private:
+    using lock_type = std::unique_lock<std::mutex>;
+    //! the size of the deflate window
+    static const size_t window_size = 32768;
+
+    struct chunk {
+        std::unique_ptr<char[]> data;
+        size_t size{0};
+        std::vector<char> dict;
+    };
+
+    struct block {
+        std::vector<unsigned char> data;
+        uLong crc{0};
+        size_t len{0};
+    };
+
+    struct job {
+        chunk* c;
+        std::future<block> result;
+    };
 
-    void enlarge_pool() {
-        auto buffer_pool = new char[queue_size * buffer_size];
-        for (auto i = 0u; i < queue_size; ++i) {
-            memset(buffer_pool + i * buffer_size, 0, buffer_size);
-            pool.push_back(buffer_pool + i * buffer_size);
+    static block compress(chunk const* c, int level) {
+        block b;
+        b.len = c->size;
+        b.crc = crc32(0L, reinterpret_cast<Bytef const*>(c->data.get()), c->size);
+        z_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        deflateInit2(&strm, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        if(c->dict.size())
+            deflateSetDictionary(&strm, reinterpret_cast<Bytef const*>(c->dict.data()), c->dict.size());
+        b.data.resize(deflateBound(&strm, c->size) + 64);
+        strm.next_in = reinterpret_cast<Bytef*>(c->data.get());
+        strm.avail_in = c->size;
+        size_t written = 0;
+        while(true) {
+            strm.next_out = b.data.data() + written;
+            strm.avail_out = b.data.size() - written;
+            deflate(&strm, Z_SYNC_FLUSH);
+            written = b.data.size() - strm.avail_out;
+            if(strm.avail_out)
+                break;
+            b.data.resize(b.data.size() * 2);
         }
-        pool_buffer.push_back(buffer_pool);
+        b.data.resize(written);
+        deflateEnd(&strm);
+        return b;
     }
 
-public:
-    std::mutex writer_mtx;
-    using lock_type=std::unique_lock<std::mutex>;
-    static const size_t buffer_size=512;
-    gz_writer(std::string const& filename)  {
-        vcd_out = gzopen(filename.c_str(), "w3");
-        logger=std::thread([this](){log();});
-        enlarge_pool();
+    chunk* allocate() {
+        chunks.emplace_back(new chunk);
+        chunks.back()->data.reset(new char[chunk_size]);
+        return chunks.back().get();
     }
 
-    ~gz_writer(){
-        done=true;
+    void submit(chunk* c) {
+        stats.chunks++;
+        if(compressed) {
+            // the tail of this chunk is the dictionary of the next one
+            c->dict.swap(tail);
+            auto n = c->size < window_size ? c->size : window_size;
+            tail.assign(c->data.get() + c->size - n, c->data.get() + c->size);
+        }
+        job j{c, std::future<block>()};
+        if(pool) {
+            auto lvl = level;
+            j.result = pool->enqueue([c, lvl]() -> block { return compress(c, lvl); });
+        }
         {
-            lock_type lock(writer_mtx);
-            write("");
+            lock_type lock(mtx);
+            jobs.push_back(std::move(j));
         }
-        logger.join();
-        gzclose(vcd_out);
-        char* value;
-        pool.clear();
-        for(auto b:pool_buffer) delete b;
+        job_cond.notify_one();
     }
 
-    inline void write_single(std::string const& msg){
-        lock_type lock(writer_mtx);
-        if(pool.empty()) enlarge_pool();
-        auto value = pool.front();
-        pool.pop_front();
-        strncpy(value, msg.c_str(), std::min(buffer_size-1, msg.length()));
-        write_queue.push_back(value);
-    }
-    inline void write(std::string const& msg){
-        if(pool.empty()) enlarge_pool();
-//        auto value = pool.front();
-//        pool.pop_front();
-//        strncpy(value, msg.c_str(), std::min(buffer_size-1, msg.length()));
-//        write_queue.push_back(value);
+    chunk* acquire() {
+        lock_type lock(mtx);
+        if(free_list.empty()) {
+            // chunks are only allocated by the producer thread so reading chunks.size() is safe
+            if(chunks.size() < max_chunks)
+                return allocate();
+            stats.stalls++;
+            free_cond.wait(lock, [this]() -> bool { return !free_list.empty(); });
+        }
+        auto* c = free_list.back();
+        free_list.pop_back();
+        return c;
     }
-    inline void write(char const* msg, size_t size){
-        if(pool.empty()) enlarge_pool();
-//        auto value = pool.front();
-//        pool.pop_front();
-//        strncpy(value, msg, std::min(buffer_size-1, size));
-//        write_queue.push_back(value);
+
+    void run() {
+        lock_type lock(mtx);
+        while(true) {
+            job_cond.wait(lock, [this]() -> bool { return done || !jobs.empty(); });
+            if(jobs.empty())
+                break; // done and nothing left
+            auto j = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            if(!compressed) {
+                if(out && j.c->size)
+                    fwrite(j.c->data.get(), 1, j.c->size, out);
+            } else {
+                auto b = j.result.valid() ? j.result.get() : compress(j.c, level);
+                if(out && b.data.size())
+                    fwrite(b.data.data(), 1, b.data.size(), out);
+                crc = crc32_combine(crc, b.crc, b.len);
+                total += b.len;
+            }
+            j.c->size = 0;
+            lock.lock();
+            free_list.push_back(j.c);
+            free_cond.notify_one();
+        }
     }
+
+    size_t const chunk_size;
+    size_t const max_chunks;
+    int const level;
+    bool const compressed;
+    FILE* out{nullptr};
+    uLong crc{0};
+    uint64_t total{0};
+    std::vector<std::unique_ptr<chunk>> chunks;
+    chunk* current{nullptr};
+    std::vector<char> tail;
+    std::deque<job> jobs;
+    std::vector<chunk*> free_list;
+    std::mutex mtx;
+    std::condition_variable job_cond;
+    std::condition_variable free_cond;
+    bool done{false};
+    std::string* diversion{nullptr};
+    statistics stats;
+    std::unique_ptr<util::thread_pool> pool;
+    std::thread writer;
 };
-}
-}
+} // namespace trace
+} // namespace scc
 #endif /* _SCC_TRACE_GZ_WRITER_HH_ */
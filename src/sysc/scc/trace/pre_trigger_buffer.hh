@@ -0,0 +1,247 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _SCC_TRACE_PRE_TRIGGER_BUFFER_HH_
+#define _SCC_TRACE_PRE_TRIGGER_BUFFER_HH_
+
+#include "gz_writer.hh"
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace scc {
+namespace trace {
+/**
+ * @class pre_trigger_buffer
+ * @brief keeps the value changes of the most recent time window while tracing is disabled
+ *
+ * The value changes are stored per time step. Time steps leaving the window (being older than the depth) are folded
+ * into a base line holding the last value per key. Flushing the buffer yields the base line at the time of the last
+ * folded time step followed by all buffered time steps so that the waveform is correct from the beginning of the
+ * window on. The buffers of the time steps are recycled, hence after warm-up no memory is allocated.
+ *
+ * @tparam K the key identifying a traced object
+ * @tparam H the hash function of the key
+ */
+template <typename K, typename H = std::hash<K>> class pre_trigger_buffer {
+public:
+    /**
+     * @fn void set_depth(uint64_t)
+     * @brief sets the length of the time window to keep, 0 disables buffering
+     *
+     * @param d the depth in trace time units
+     */
+    void set_depth(uint64_t d) { depth = d; }
+    /**
+     * @fn uint64_t get_depth()const
+     * @brief returns the length of the time window to keep
+     *
+     * @return the depth in trace time units
+     */
+    uint64_t get_depth() const { return depth; }
+    /**
+     * @fn bool empty()const
+     * @brief checks if there is anything to flush
+     *
+     * @return true if the buffer holds no value change
+     */
+    bool empty() const { return steps.empty() && base.empty(); }
+    /**
+     * @fn void begin(uint64_t)
+     * @brief starts a new time step, subsequent calls to add() belong to it
+     *
+     * @param ts the time stamp
+     */
+    void begin(uint64_t ts) {
+        if(steps.size() && steps.back().ts == ts)
+            return;
+        if(free_steps.size()) {
+            steps.emplace_back(std::move(free_steps.back()));
+            free_steps.pop_back();
+        } else
+            steps.emplace_back();
+        steps.back().ts = ts;
+    }
+    /**
+     * @fn void add(const K&, const char*, size_t)
+     * @brief adds a value change to the current time step
+     *
+     * @param key the key of the traced object
+     * @param data the encoded value
+     * @param len the length of the encoded value
+     */
+    void add(K const& key, char const* data, size_t len) {
+        if(steps.empty())
+            return;
+        auto& s = steps.back();
+        s.entries.push_back(entry{key, s.data.size(), len});
+        s.data.append(data, len);
+    }
+    /**
+     * @fn void expire(uint64_t)
+     * @brief folds all time steps being older than now-depth into the base line
+     *
+     * @param now the current time stamp
+     */
+    void expire(uint64_t now) {
+        auto limit = now > depth ? now - depth : 0;
+        while(steps.size() && steps.front().ts < limit) {
+            auto& s = steps.front();
+            for(auto& e : s.entries)
+                base[e.key].assign(s.data.data() + e.offset, e.len);
+            base_ts = s.ts;
+            recycle(s);
+            steps.pop_front();
+        }
+    }
+    /**
+     * @fn void flush(T, V)
+     * @brief emits the content of the buffer and clears it
+     *
+     * @param time_cb functor being called with the time stamp (uint64_t) when a time step starts
+     * @param value_cb functor being called with key, data pointer and length of each value change
+     */
+    template <typename T, typename V> void flush(T time_cb, V value_cb) {
+        if(base.size()) {
+            time_cb(base_ts);
+            for(auto& e : base)
+                value_cb(e.first, e.second.data(), e.second.size());
+            base.clear();
+        }
+        for(auto& s : steps) {
+            time_cb(s.ts);
+            for(auto& e : s.entries)
+                value_cb(e.key, s.data.data() + e.offset, e.len);
+            recycle(s);
+        }
+        steps.clear();
+    }
+
+private:
+    struct entry {
+        K key;
+        size_t offset;
+        size_t len;
+    };
+    struct step {
+        uint64_t ts{0};
+        std::string data;
+        std::vector<entry> entries;
+    };
+
+    void recycle(step& s) {
+        s.data.clear();
+        s.entries.clear();
+        free_steps.emplace_back(std::move(s));
+    }
+
+    uint64_t depth{0};
+    uint64_t base_ts{0};
+    std::deque<step> steps;
+    std::vector<step> free_steps;
+    std::unordered_map<K, std::string, H> base;
+};
+/**
+ * @class vcd_pre_trigger
+ * @brief the pre-trigger buffer of the VCD trace files
+ *
+ * While tracing is disabled the output of a cycle is diverted into a string, split into the value change lines and
+ * kept in a pre_trigger_buffer using the VCD identifier as key.
+ */
+class vcd_pre_trigger {
+public:
+    vcd_pre_trigger(uint64_t depth) { buffer.set_depth(depth); }
+    /**
+     * @fn void divert(gz_writer*)
+     * @brief redirects the output of the writer into the buffer
+     *
+     * @param os the writer
+     */
+    void divert(gz_writer* os) { os->divert(&text); }
+    /**
+     * @fn void capture(gz_writer*, uint64_t)
+     * @brief ends the diversion and stores the diverted value changes
+     *
+     * @param os the writer
+     * @param ts the current time stamp
+     */
+    void capture(gz_writer* os, uint64_t ts) {
+        os->divert(nullptr);
+        if(text.size()) {
+            buffer.begin(ts);
+            auto* ptr = text.data();
+            auto* end = ptr + text.size();
+            while(ptr < end) {
+                auto* eol = static_cast<char const*>(memchr(ptr, '\n', end - ptr));
+                if(!eol)
+                    eol = end;
+                // vectors and reals have the identifier after a blank, scalars right after the value. Time stamps and
+                // comments are not kept
+                char const* id = nullptr;
+                switch(*ptr) {
+                case 'b':
+                case 'B':
+                case 'r':
+                case 'R':
+                    id = static_cast<char const*>(memchr(ptr, ' ', eol - ptr));
+                    break;
+                case '0':
+                case '1':
+                case 'x':
+                case 'X':
+                case 'z':
+                case 'Z':
+                    id = ptr;
+                    break;
+                default:
+                    break;
+                }
+                auto* next = eol < end ? eol + 1 : end;
+                if(id && id + 1 < eol) {
+                    key.assign(id + 1, eol);
+                    buffer.add(key, ptr, next - ptr);
+                }
+                ptr = next;
+            }
+            text.clear();
+        }
+        buffer.expire(ts);
+    }
+    /**
+     * @fn void flush(gz_writer*)
+     * @brief writes the buffered value changes to the writer
+     *
+     * @param os the writer
+     */
+    void flush(gz_writer* os) {
+        if(buffer.empty())
+            return;
+        buffer.flush([os](uint64_t ts) { os->write(std::string("#") + std::to_string(ts) + "\n"); },
+                     [os](std::string const&, char const* data, size_t len) { os->write(data, len); });
+    }
+
+private:
+    pre_trigger_buffer<std::string> buffer;
+    std::string text;
+    std::string key;
+};
+} // namespace trace
+} // namespace scc
+#endif /* _SCC_TRACE_PRE_TRIGGER_BUFFER_HH_ */
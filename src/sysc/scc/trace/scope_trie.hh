@@ -0,0 +1,194 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _SCC_TRACE_SCOPE_TRIE_HH_
+#define _SCC_TRACE_SCOPE_TRIE_HH_
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace scc {
+namespace trace {
+/**
+ * @class scope_trie
+ * @brief a trie of the hierarchical names of traces used to build the scope hierarchy of a trace file
+ *
+ * The name components (module and signal names) are interned so that each distinct component is stored and compared
+ * only once, the nodes refer to them by id. After all traces are added sort() orders the nodes by ranking the distinct
+ * components once, the traces are then visited in hierarchical order without comparing full names. Within a scope the
+ * traces precede the sub-scopes.
+ *
+ * @tparam T the type of the traces
+ */
+template <typename T> class scope_trie {
+public:
+    using node_id = uint32_t;
+    //! the id of the root node representing the top level scope
+    static const node_id root = 0;
+    //! a trace within a scope as pair of name component id and trace
+    using leaf = std::pair<uint32_t, T*>;
+    /**
+     * @fn  scope_trie(size_t)
+     * @brief constructor
+     *
+     * @param expected the expected number of traces, used to size the internal tables
+     */
+    scope_trie(size_t expected = 0) {
+        nodes.emplace_back(0);
+        name_ids.reserve(expected / 4);
+        child_ids.reserve(expected / 4);
+    }
+    /**
+     * @fn void add(const std::string&, T*)
+     * @brief adds a trace using its hierarchical name with '.' as separator
+     *
+     * @param name the hierarchical name
+     * @param trace the trace
+     */
+    void add(std::string const& name, T* trace) {
+        node_id cur = root;
+        size_t pos = 0;
+        for(auto dot = name.find('.'); dot != std::string::npos; pos = dot + 1, dot = name.find('.', pos))
+            cur = child(cur, intern(name, pos, dot - pos));
+        nodes[cur].leaves.emplace_back(intern(name, pos, name.size() - pos), trace);
+        ++count;
+    }
+    /**
+     * @fn void sort()
+     * @brief orders the sub-scopes and traces of each scope by their names
+     */
+    void sort() {
+        std::vector<uint32_t> ids(names.size());
+        std::iota(std::begin(ids), std::end(ids), 0);
+        std::sort(std::begin(ids), std::end(ids), [this](uint32_t a, uint32_t b) { return names[a] < names[b]; });
+        std::vector<uint32_t> rank(names.size());
+        for(uint32_t i = 0; i < ids.size(); ++i)
+            rank[ids[i]] = i;
+        for(auto& n : nodes) {
+            std::sort(std::begin(n.children), std::end(n.children),
+                      [this, &rank](node_id a, node_id b) { return rank[nodes[a].name] < rank[nodes[b].name]; });
+            std::stable_sort(std::begin(n.leaves), std::end(n.leaves),
+                             [&rank](leaf const& a, leaf const& b) { return rank[a.first] < rank[b.first]; });
+        }
+    }
+    /**
+     * @fn std::vector<T*> ordered()const
+     * @brief returns all traces in the order they are visited by traverse()
+     *
+     * @return the traces
+     */
+    std::vector<T*> ordered() const {
+        std::vector<T*> res;
+        res.reserve(count);
+        collect(root, res);
+        return res;
+    }
+    /**
+     * @fn void traverse(node_id, ENTER, LEAVE, LEAF)const
+     * @brief visits a scope and its sub-scopes depth first. The root scope itself is not entered
+     *
+     * @param n the scope to start with
+     * @param enter called with the name of a scope being entered
+     * @param leave called when a scope is left
+     * @param visit called with the name of each trace and the trace
+     */
+    template <typename ENTER, typename LEAVE, typename LEAF>
+    void traverse(node_id n, ENTER&& enter, LEAVE&& leave, LEAF&& visit) const {
+        auto const& node = nodes[n];
+        if(n != root)
+            enter(names[node.name]);
+        for(auto const& l : node.leaves)
+            visit(names[l.first], l.second);
+        for(auto c : node.children)
+            traverse(c, enter, leave, visit);
+        if(n != root)
+            leave();
+    }
+    /**
+     * @fn const std::vector<node_id>& children(node_id)const
+     * @brief returns the sub-scopes of a scope
+     */
+    std::vector<node_id> const& children(node_id n) const { return nodes[n].children; }
+    /**
+     * @fn const std::vector<leaf>& leaves(node_id)const
+     * @brief returns the traces of a scope
+     */
+    std::vector<leaf> const& leaves(node_id n) const { return nodes[n].leaves; }
+    /**
+     * @fn const std::string& name(uint32_t)const
+     * @brief returns a name component by its id
+     */
+    std::string const& name(uint32_t id) const { return names[id]; }
+    /**
+     * @fn size_t size()const
+     * @brief returns the number of traces
+     */
+    size_t size() const { return count; }
+
+private:
+    struct node {
+        uint32_t name;
+        std::vector<node_id> children;
+        std::vector<leaf> leaves;
+        node(uint32_t name)
+        : name(name) {}
+    };
+
+    uint32_t intern(std::string const& str, size_t pos, size_t len) {
+        key.assign(str, pos, len);
+        auto it = name_ids.find(key);
+        if(it != std::end(name_ids))
+            return it->second;
+        auto id = static_cast<uint32_t>(names.size());
+        names.push_back(key);
+        name_ids.emplace(key, id);
+        return id;
+    }
+
+    node_id child(node_id parent, uint32_t name) {
+        auto k = (static_cast<uint64_t>(parent) << 32) | name;
+        auto it = child_ids.find(k);
+        if(it != std::end(child_ids))
+            return it->second;
+        auto id = static_cast<node_id>(nodes.size());
+        nodes.emplace_back(name);
+        nodes[parent].children.push_back(id);
+        child_ids.emplace(k, id);
+        return id;
+    }
+
+    void collect(node_id n, std::vector<T*>& res) const {
+        for(auto const& l : nodes[n].leaves)
+            res.push_back(l.second);
+        for(auto c : nodes[n].children)
+            collect(c, res);
+    }
+
+    std::vector<node> nodes;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> name_ids;
+    std::unordered_map<uint64_t, node_id> child_ids;
+    std::string key;
+    size_t count{0};
+};
+} // namespace trace
+} // namespace scc
+#endif /* _SCC_TRACE_SCOPE_TRIE_HH_ */
@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _SCC_TRACE_SEGMENT_MANIFEST_HH_
+#define _SCC_TRACE_SEGMENT_MANIFEST_HH_
+
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/prettywriter.h>
+#include <string>
+#include <vector>
+
+namespace scc {
+namespace trace {
+/**
+ * @class segment_manifest
+ * @brief the index of the segment files of a rotated trace
+ *
+ * The manifest is a small JSON file listing the segment files and the time range (in ps) each of them covers:
+ * @code
+ * { "format": "vcd", "time_unit": "ps",
+ *   "segments": [ { "file": "trace.0000.vcd.gz", "start": 0, "end": 100000 }, ... ] }
+ * @endcode
+ * It is rewritten each time a segment is added so that it stays usable if the simulation terminates abnormally. The
+ * last segment has no end until the manifest is closed.
+ */
+class segment_manifest {
+public:
+    /**
+     * @fn  segment_manifest(const std::string&, const std::string&)
+     * @brief constructor
+     *
+     * @param file_name the name of the manifest file
+     * @param format the format of the segment files
+     */
+    segment_manifest(std::string const& file_name, std::string const& format)
+    : file_name(file_name)
+    , format(format) {}
+    /**
+     * @fn std::string segment_name(const std::string&, unsigned, const std::string&)
+     * @brief composes the file name of a segment
+     *
+     * @param base the base name of the trace
+     * @param index the index of the segment
+     * @param ext the extension of the segment files
+     * @return the file name
+     */
+    static std::string segment_name(std::string const& base, unsigned index, std::string const& ext) {
+        auto idx = std::to_string(index);
+        return base + "." + std::string(idx.size() < 4 ? 4 - idx.size() : 0, '0') + idx + ext;
+    }
+    /**
+     * @fn void add(const std::string&, uint64_t)
+     * @brief adds a segment, the previous segment ends at the start of the new one
+     *
+     * @param segment_file the file name of the segment
+     * @param start the start time of the segment
+     */
+    void add(std::string const& segment_file, uint64_t start) {
+        if(segments.size())
+            segments.back().end = start;
+        auto pos = segment_file.find_last_of("/\\");
+        segments.push_back(segment{pos == std::string::npos ? segment_file : segment_file.substr(pos + 1), start,
+                                   std::numeric_limits<uint64_t>::max()});
+        write();
+    }
+    /**
+     * @fn void close(uint64_t)
+     * @brief sets the end time of the last segment and writes the manifest
+     *
+     * @param end the end time of the last segment
+     */
+    void close(uint64_t end) {
+        if(segments.size()) {
+            segments.back().end = end;
+            write();
+        }
+    }
+    /**
+     * @fn size_t size()const
+     * @brief returns the number of segments
+     *
+     * @return the number of segments
+     */
+    size_t size() const { return segments.size(); }
+
+private:
+    struct segment {
+        std::string file;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    void write() {
+        std::ofstream ofs(file_name);
+        if(!ofs.is_open())
+            return;
+        rapidjson::OStreamWrapper stream(ofs);
+        rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(stream);
+        writer.StartObject();
+        writer.Key("format");
+        writer.String(format.c_str());
+        writer.Key("time_unit");
+        writer.String("ps");
+        writer.Key("segments");
+        writer.StartArray();
+        for(auto& s : segments) {
+            writer.StartObject();
+            writer.Key("file");
+            writer.String(s.file.c_str());
+            writer.Key("start");
+            writer.Uint64(s.start);
+            if(s.end != std::numeric_limits<uint64_t>::max()) {
+                writer.Key("end");
+                writer.Uint64(s.end);
+            }
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+
+    std::string const file_name;
+    std::string const format;
+    std::vector<segment> segments;
+};
+} // namespace trace
+} // namespace scc
+#endif /* _SCC_TRACE_SEGMENT_MANIFEST_HH_ */
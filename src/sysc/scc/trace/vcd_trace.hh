@@ -16,6 +16,7 @@
 #ifndef _SCC_TRACE_VCD_TRACE_HH_
 #define _SCC_TRACE_VCD_TRACE_HH_
 
+#include "scope_trie.hh"
 #include "types.hh"
 #ifndef FWRITE
 #include <cstdio>
@@ -25,6 +26,13 @@
 #include <util/ities.h>
 #include <scc/utilities.h>
 #include <fmt/format.h>
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 
@@ -32,25 +40,125 @@
 namespace scc {
 namespace trace {
 
-inline void vcdEmitValueChange(FPTR os, std::string const& handle, unsigned bits, const char *val) {
-    auto buf = bits==1?fmt::format("{}{}\n", *val, handle):fmt::format("b{} {}\n", val, handle);
-    FWRITE(buf.c_str(), 1, buf.size(), os);
+/**
+ * @struct vcd_handle
+ * @brief the identifier code of a VCD variable stored inline as NUL terminated char array
+ */
+struct vcd_handle {
+    static const size_t max_size = 15;
+    char data[max_size + 1]{};
+    uint8_t len{0};
+
+    vcd_handle& operator=(std::string const& str) {
+        len = str.size() < max_size ? str.size() : max_size;
+        memcpy(data, str.c_str(), len);
+        data[len] = 0;
+        return *this;
+    }
+
+    char const* c_str() const { return data; }
+
+    operator std::string() const { return std::string(data, len); }
+};
+/**
+ * @struct vcd_bin_lut
+ * @brief lookup table converting a byte into its 8 character binary representation (MSB first)
+ */
+struct vcd_bin_lut {
+    char chars[256][8];
+
+    vcd_bin_lut() {
+        for(unsigned i = 0; i < 256; ++i)
+            for(unsigned j = 0; j < 8; ++j)
+                chars[i][j] = (i >> (7 - j)) & 1 ? '1' : '0';
+    }
+
+    static vcd_bin_lut const& get() {
+        static vcd_bin_lut lut;
+        return lut;
+    }
+};
+//! size of the stack buffers used to format a value change, larger values use a heap buffer
+const size_t vcd_stack_buffer_size = 128;
+
+// copies the complete inline array (a fixed size copy is cheaper), buffers need to provide sizeof(vcd_handle::data)+1
+inline char* vcdAppendHandle(char* ptr, vcd_handle const& handle) {
+    memcpy(ptr, handle.data, sizeof(handle.data));
+    ptr += handle.len;
+    *ptr++ = '\n';
+    return ptr;
 }
 
-inline void vcdEmitValueChange32(FPTR os, std::string const& handle, unsigned bits, uint32_t val){
-    auto buf = fmt::format("b{:b} {}\n", val&((1ull<<bits)-1), handle);
-    FWRITE(buf.c_str(), 1, buf.size(), os);
+inline void vcdEmitValueChange(FPTR os, vcd_handle const& handle, unsigned bits, const char *val, size_t len) {
+    char sbuf[vcd_stack_buffer_size];
+    std::unique_ptr<char[]> hbuf;
+    char* buf = sbuf;
+    if(len + sizeof(vcd_handle::data) + 3 > vcd_stack_buffer_size) {
+        hbuf.reset(new char[len + sizeof(vcd_handle::data) + 3]);
+        buf = hbuf.get();
+    }
+    auto* ptr = buf;
+    if(bits == 1) {
+        *ptr++ = *val;
+    } else {
+        *ptr++ = 'b';
+        memcpy(ptr, val, len);
+        ptr += len;
+        *ptr++ = ' ';
+    }
+    ptr = vcdAppendHandle(ptr, handle);
+    FWRITE(buf, 1, ptr - buf, os);
 }
 
-inline void vcdEmitValueChange64(FPTR os, std::string const& handle, unsigned bits, uint64_t val){
-    auto buf = fmt::format("b{:b} {}\n", val&((1ul<<std::min(63u,bits))-1), handle);
-    FWRITE(buf.c_str(), 1, buf.size(), os);
+inline void vcdEmitValueChange(FPTR os, vcd_handle const& handle, unsigned bits, const char *val) {
+    vcdEmitValueChange(os, handle, bits, val, bits == 1 ? 1 : strlen(val));
+}
+
+inline void vcdEmitValueChange64(FPTR os, vcd_handle const& handle, unsigned bits, uint64_t val){
+    auto const& lut = vcd_bin_lut::get().chars;
+    if(bits < 64)
+        val &= (1ULL << bits) - 1;
+    char buf[72 + sizeof(vcd_handle::data) + 3];
+    // the number of significant bits, at least one
+    unsigned sig = val ? 64 - __builtin_clzll(val) : 1;
+    int byte_idx = (sig - 1) / 8;
+    // all bytes are copied completely, the leading zeros of the first one are overwritten by the 'b'
+    auto* ptr = buf + 1;
+    auto* start = ptr + 8 - (sig - byte_idx * 8) - 1;
+    for(; byte_idx >= 0; --byte_idx, ptr += 8)
+        memcpy(ptr, lut[(val >> (byte_idx * 8)) & 0xff], 8);
+    *start = 'b';
+    *ptr++ = ' ';
+    ptr = vcdAppendHandle(ptr, handle);
+    FWRITE(start, 1, ptr - start, os);
+}
+
+inline void vcdEmitValueChange32(FPTR os, vcd_handle const& handle, unsigned bits, uint32_t val){
+    vcdEmitValueChange64(os, handle, bits, val);
 }
 
 template<typename T>
-inline void vcdEmitValueChangeReal(FPTR os, std::string const& handle, unsigned bits, T val){
-    auto buf = fmt::format("r{:.16g} {}\n", val, handle);
-    FWRITE(buf.c_str(), 1, buf.size(), os);
+inline void vcdEmitValueChangeReal(FPTR os, vcd_handle const& handle, unsigned bits, T val){
+    char buf[64 + sizeof(vcd_handle::data) + 3];
+    auto* ptr = buf;
+    *ptr++ = 'r';
+    ptr = fmt::format_to(ptr, "{:.16g}", static_cast<double>(val));
+    *ptr++ = ' ';
+    ptr = vcdAppendHandle(ptr, handle);
+    FWRITE(buf, 1, ptr - buf, os);
+}
+
+inline void vcdEmitTime(FPTR os, uint64_t time_stamp){
+    char buf[24];
+    auto* end = buf + sizeof(buf);
+    auto* ptr = end;
+    *--ptr = '\n';
+    do {
+        *--ptr = '0' + time_stamp % 10;
+        time_stamp /= 10;
+    } while(time_stamp);
+    *--ptr = '#';
+    FWRITE(ptr, 1, end - ptr, os);
 }
 
 inline size_t get_buffer_size(int length){
@@ -58,70 +166,110 @@ inline size_t get_buffer_size(int length){
     return std::max<uint64_t>(1024UL, sz);
 }
 
-/*******************************************************************************************************
+/**
+ * @fn void vcdAssignHandles(const scope_trie<T>&, F)
+ * @brief assigns the identifier codes in hierarchical order, traces of the same object (aliases) share the code of the
+ * first one
  *
- *******************************************************************************************************/
-template<typename T>
-struct vcd_scope_stack {
-    void add_trace(T *trace){
-        auto hier = util::split(trace->name, '.');
-        add_trace_rec(std::begin(hier), std::end(hier), trace);
+ * @param trie the hierarchy of the traces
+ * @param obtain_name the functor returning a new identifier code
+ */
+template<typename T, typename F>
+void vcdAssignHandles(scope_trie<T> const& trie, F&& obtain_name) {
+    std::unordered_map<uintptr_t, T*> alias_map;
+    alias_map.reserve(trie.size());
+    for(auto* trc : trie.ordered()) {
+        auto res = alias_map.emplace(trc->get_hash(), trc);
+        trc->is_alias = !res.second;
+        if(trc->is_alias)
+            trc->trc_hndl = res.first->second->trc_hndl;
+        else
+            trc->trc_hndl = obtain_name();
     }
+}
 
-    void print(FPTR os, const char *scope_name = "SystemC"){
-        auto buf = fmt::format("$scope module {} $end\n", scope_name);
-        FWRITE(buf.c_str(), 1, buf.size(), os);
-        for (auto& e : m_traces)
-            print_variable_declaration_line(os, e.first.c_str(), e.second);
-        for (auto& e : m_scopes)
-            e.second->print(os,e.first.c_str());
-        std::string end = "$upscope $end\n";
-        FWRITE(end.c_str(), 1, end.size(), os);
-    }
+//! the number of traces from which on the declarations are formatted in parallel
+const size_t vcd_parallel_declaration_threshold = 65536;
 
-    ~vcd_scope_stack(){
-        for (auto& s : m_scopes)
-            delete s.second;
-    }
-private:
-    void add_trace_rec(std::vector<std::string>::iterator beg, std::vector<std::string>::iterator const& end, T *trace){
-        if(std::distance(beg,  end)==1){
-            m_traces.push_back(std::make_pair(*beg, trace));
-        } else {
-            auto sc = m_scopes.find(*beg);
-            if(sc == std::end(m_scopes))
-                sc = m_scopes.insert({*beg, new vcd_scope_stack}).first;
-            sc->second->add_trace_rec(++beg, end, trace);
-        }
+template<typename T>
+inline void vcdAppendDeclaration(std::string& out, std::string const& name, T const* trc) {
+    if(trc->bits == 1) {
+        if(trc->type == WIRE)
+            fmt::format_to(std::back_inserter(out), "$var wire {} {}  {} $end\n", trc->bits, trc->trc_hndl.c_str(), name);
+        else
+            fmt::format_to(std::back_inserter(out), "$var real {} {} {} $end\n", trc->bits, trc->trc_hndl.c_str(), name);
+    } else
+        fmt::format_to(std::back_inserter(out), "$var wire {} {} {} [{}:0] $end\n", trc->bits, trc->trc_hndl.c_str(),
+                       name, trc->bits - 1);
+}
+
+template<typename T>
+inline void vcdAppendScopes(scope_trie<T> const& trie, typename scope_trie<T>::node_id const* beg,
+                            typename scope_trie<T>::node_id const* end, std::string& out,
+                            std::vector<std::string>& ignored) {
+    for(; beg != end; ++beg)
+        trie.traverse(*beg,
+                      [&out](std::string const& name) {
+                          out += "$scope module ";
+                          out += name;
+                          out += " $end\n";
+                      },
+                      [&out]() { out += "$upscope $end\n"; },
+                      [&out, &ignored](std::string const& name, T* trc) {
+                          if(trc->bits)
+                              vcdAppendDeclaration(out, name, trc);
+                          else
+                              ignored.push_back(name);
+                      });
+}
+/**
+ * @fn void vcdPrintScopes(FPTR, const scope_trie<T>&, const char*)
+ * @brief writes the scope hierarchy including the variable declarations. For large designs the top level sub-scopes
+ * are formatted in parallel and written in order.
+ *
+ * @param os the output
+ * @param trie the hierarchy of the traces
+ * @param scope_name the name of the top level scope
+ */
+template<typename T>
+void vcdPrintScopes(FPTR os, scope_trie<T> const& trie, const char *scope_name = "SystemC"){
+    using node_id = typename scope_trie<T>::node_id;
+    auto const& top = trie.children(scope_trie<T>::root);
+    unsigned threads = trie.size() < vcd_parallel_declaration_threshold ? 1 :
+            std::max(1U, std::min<unsigned>(std::thread::hardware_concurrency(), top.size()));
+    std::vector<std::string> bufs(threads);
+    std::vector<std::vector<std::string>> ignored(threads);
+    bufs[0] = fmt::format("$scope module {} $end\n", scope_name);
+    for(auto const& l : trie.leaves(scope_trie<T>::root))
+        if(l.second->bits)
+            vcdAppendDeclaration(bufs[0], trie.name(l.first), l.second);
+        else
+            ignored[0].push_back(trie.name(l.first));
+    auto chunk = (top.size() + threads - 1) / threads;
+    std::vector<std::future<void>> jobs;
+    for(unsigned i = 0; i < threads; ++i) {
+        node_id const* beg = top.data() + std::min(top.size(), i * chunk);
+        node_id const* end = top.data() + std::min(top.size(), (i + 1) * chunk);
+        if(i == 0)
+            continue;
+        jobs.push_back(std::async(std::launch::async, [&trie, beg, end, &bufs, &ignored, i]() {
+            vcdAppendScopes(trie, beg, end, bufs[i], ignored[i]);
+        }));
     }
-    void print_variable_declaration_line(FPTR os, const char* scoped_name, T* trc){
-        char buf[2000];
-        switch(trc->bits){
-        case 0:{
+    vcdAppendScopes(trie, top.data(), top.data() + std::min(top.size(), chunk), bufs[0], ignored[0]);
+    for(auto& j : jobs)
+        j.get();
+    for(unsigned i = 0; i < threads; ++i) {
+        FWRITE(bufs[i].c_str(), 1, bufs[i].size(), os);
+        for(auto const& name : ignored[i]) {
             std::stringstream ss;
-            ss << "'" << scoped_name << "' has 0 bits";
+            ss << "'" << name << "' has 0 bits";
             SC_REPORT_ERROR(sc_core::SC_ID_TRACING_OBJECT_IGNORED_, ss.str().c_str() );
-            return;
-        }
-        case 1:
-            if(trc->type==WIRE) {
-                auto buf = fmt::format("$var wire {} {}  {} $end\n", trc->bits, trc->trc_hndl, scoped_name);
-                FWRITE(buf.c_str(), 1, buf.size(), os);
-            } else {
-                auto buf = fmt::format("$var real {} {} {} $end\n", trc->bits, trc->trc_hndl, scoped_name);
-                FWRITE(buf.c_str(), 1, buf.size(), os);
-            }
-            break;
-        default: {
-            auto buf = fmt::format("$var wire {} {} {} [{}:0] $end\n", trc->bits, trc->trc_hndl, scoped_name, trc->bits-1);
-            FWRITE(buf.c_str(), 1, buf.size(), os);
-        }
         }
     }
-
-    std::vector<std::pair<std::string,T*> > m_traces{0};
-    std::unordered_map<std::string, vcd_scope_stack*> m_scopes{0};
-};
+    std::string end = "$upscope $end\n";
+    FWRITE(end.c_str(), 1, end.size(), os);
+}
 
 struct vcd_trace {
     vcd_trace(std::string const& nm, trace_type t, unsigned bits): name{nm}, bits{bits}, type{t}{}
@@ -135,7 +283,7 @@ struct vcd_trace {
     virtual ~vcd_trace(){};
 
     const std::string name;
-    std::string trc_hndl{};
+    vcd_handle trc_hndl{};
     bool is_alias{false};
     bool is_triggered{false};
     const unsigned bits;
@@ -221,54 +369,35 @@ template<> void vcd_trace_t<double, double>::record(FPTR os){
     vcdEmitValueChangeReal(os, trc_hndl, 64, old_val);
 }
 template<> void vcd_trace_t<sc_dt::sc_int_base, sc_dt::sc_int_base>::record(FPTR os){
-    static std::vector<char> rawdata(get_buffer_size(old_val.length()));
-    char *rawdata_ptr  = &rawdata[0];
-    for (int bitindex = old_val.length() - 1; bitindex >= 0; --bitindex) {
-        *rawdata_ptr++ = '0'+old_val[bitindex].value();
-    }
-    vcdEmitValueChange(os, trc_hndl, bits, &rawdata[0]);
+    vcdEmitValueChange64(os, trc_hndl, bits, old_val.value());
 }
 template<> void vcd_trace_t<sc_dt::sc_uint_base, sc_dt::sc_uint_base>::record(FPTR os){
-    static std::vector<char> rawdata(get_buffer_size(old_val.length()));
-    char *rawdata_ptr  = &rawdata[0];
-    for (int bitindex = old_val.length() - 1; bitindex >= 0; --bitindex) {
-        *rawdata_ptr++ = '0'+old_val[bitindex].value();
+    vcdEmitValueChange64(os, trc_hndl, bits, old_val.value());
+}
+template<typename T>
+inline void vcdEmitValueChangeBig(FPTR os, vcd_handle const& handle, unsigned bits, T const& val){
+    char sbuf[vcd_stack_buffer_size];
+    std::unique_ptr<char[]> hbuf;
+    size_t len = val.length();
+    char* buf = sbuf;
+    if(len > vcd_stack_buffer_size) {
+        hbuf.reset(new char[len]);
+        buf = hbuf.get();
     }
-    vcdEmitValueChange(os, trc_hndl, bits, &rawdata[0]);
+    char* ptr = buf;
+    for (int bitindex = len - 1; bitindex >= 0; --bitindex)
+        *ptr++ = '0'+val[bitindex].value();
+    // strip leading zeros, VCD zero-extends values
+    char* start = buf;
+    while(start < ptr - 1 && *start == '0')
+        ++start;
+    vcdEmitValueChange(os, handle, bits, start, ptr - start);
 }
 template<> void vcd_trace_t<sc_dt::sc_signed, sc_dt::sc_signed>::record(FPTR os){
-    static std::vector<char> rawdata(get_buffer_size(old_val.length()));
-    char *rawdata_ptr  = &rawdata[0];
-    bool is_started=false;
-    int bitindex = old_val.length() - 1;
-    *rawdata_ptr++ = '0'+old_val[bitindex--].value();
-    for (; bitindex >= 0; --bitindex) {
-        auto c = '0'+old_val[bitindex].value();
-        if(is_started)
-            *rawdata_ptr++ = c;
-        else if(c=='1' || *(rawdata_ptr-1)!=c ) {
-            *rawdata_ptr++ = c;
-            is_started=true;
-        }
-    }
-    vcdEmitValueChange(os, trc_hndl, bits, &rawdata[0]);
+    vcdEmitValueChangeBig(os, trc_hndl, bits, old_val);
 }
 template<> void vcd_trace_t<sc_dt::sc_unsigned, sc_dt::sc_unsigned>::record(FPTR os){
-    static std::vector<char> rawdata(get_buffer_size(old_val.length()));
-    char *rawdata_ptr  = &rawdata[0];
-    bool is_started=false;
-    int bitindex = old_val.length() - 1;
-    *rawdata_ptr++ = '0'+old_val[bitindex--].value();
-    for (; bitindex >= 0; --bitindex) {
-        auto c = '0'+old_val[bitindex].value();
-        if(is_started)
-            *rawdata_ptr++ = c;
-        else if(c=='1' || *(rawdata_ptr-1)!=c ) {
-            *rawdata_ptr++ = c;
-            is_started=true;
-        }
-    }
-    vcdEmitValueChange(os, trc_hndl, bits, &rawdata[0]);
+    vcdEmitValueChangeBig(os, trc_hndl, bits, old_val);
 }
 template<> void vcd_trace_t<sc_dt::sc_fxval, sc_dt::sc_fxval>::record(FPTR os){
     vcdEmitValueChangeReal(os, trc_hndl, bits, old_val);
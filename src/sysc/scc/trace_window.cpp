@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#define SC_INCLUDE_DYNAMIC_PROCESSES
+#include "trace_window.h"
+#include "report.h"
+
+namespace scc {
+using namespace sc_core;
+
+SC_HAS_PROCESS(trace_window);
+
+trace_window::trace_window(sc_module_name const& nm)
+: sc_module(nm) {
+    SC_THREAD(time_window);
+    SC_METHOD(close_window);
+    sensitive << close_evt;
+    dont_initialize();
+}
+
+void trace_window::attach(sc_trace_file* tf) {
+    if(auto* f = dynamic_cast<trace_capture_if*>(tf)) {
+        f->set_enable(get_enable());
+        files.push_back(f);
+    } else
+        SCCWARN(SCMOD) << "the trace file does not support capture windows, ignoring it";
+}
+
+void trace_window::end_of_elaboration() {
+    sc_time pre_trigger = pre_trigger_time;
+    for(auto* f : files)
+        f->set_pre_trigger(pre_trigger);
+    std::string start_name = start_trigger;
+    if(start_name.empty())
+        return;
+    if(auto const* evt = find_trigger(start_name)) {
+        sc_spawn_options opts;
+        opts.spawn_method();
+        opts.dont_initialize();
+        opts.set_sensitivity(evt);
+        sc_spawn([this]() { open_window(); }, sc_gen_unique_name("start_trigger"), &opts);
+    }
+    std::string stop_name = stop_trigger;
+    if(stop_name.size())
+        if(auto const* evt = find_trigger(stop_name)) {
+            sc_spawn_options opts;
+            opts.spawn_method();
+            opts.dont_initialize();
+            opts.set_sensitivity(evt);
+            sc_spawn([this]() { close_window(); }, sc_gen_unique_name("stop_trigger"), &opts);
+        }
+}
+
+sc_event const* trace_window::find_trigger(std::string const& name) {
+#if SYSTEMC_VERSION >= 20171012
+    if(auto const* evt = sc_find_event(name.c_str()))
+        return evt;
+#endif
+    if(auto* obj = sc_find_object(name.c_str())) {
+        if(auto* sig = dynamic_cast<sc_signal_in_if<bool>*>(obj))
+            return &sig->posedge_event();
+        if(auto* port = dynamic_cast<sc_port_b<sc_signal_in_if<bool>>*>(obj))
+            return &(*port)->posedge_event();
+        if(auto* chan = dynamic_cast<sc_interface*>(obj))
+            return &chan->default_event();
+    }
+    SCCWARN(SCMOD) << "could not find a trigger named " << name;
+    return nullptr;
+}
+
+void trace_window::time_window() {
+    if(std::string(start_trigger).size())
+        return;
+    sc_time start = start_time;
+    sc_time stop = stop_time;
+    sc_time period = repeat_period;
+    if(start > SC_ZERO_TIME)
+        wait(start);
+    while(true) {
+        SCCDEBUG(SCMOD) << "opening trace window";
+        open = true;
+        if(stop <= start)
+            return; // no end of the window
+        auto length = stop - start;
+        wait(length);
+        if(period.value() && period <= length)
+            return; // the windows overlap so it stays open
+        SCCDEBUG(SCMOD) << "closing trace window";
+        open = false;
+        if(!period.value())
+            return;
+        wait(period - length);
+    }
+}
+
+void trace_window::open_window() {
+    SCCDEBUG(SCMOD) << "start trigger fired, opening trace window";
+    open = true;
+    sc_time duration = trigger_duration;
+    if(duration.value()) {
+        close_evt.cancel();
+        close_evt.notify(duration);
+    }
+}
+
+void trace_window::close_window() {
+    if(open)
+        SCCDEBUG(SCMOD) << "closing trace window";
+    open = false;
+}
+} // namespace scc
@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _SCC_TRACE_WINDOW_H_
+#define _SCC_TRACE_WINDOW_H_
+
+#include "trace.h"
+#include <functional>
+#include <string>
+#include <systemc>
+#include <vector>
+#ifdef HAS_CCI
+#include <cci_configuration>
+#endif
+
+/** \ingroup scc-sysc
+ *  @{
+ */
+/**@{*/
+//! @brief SCC SystemC utilities
+namespace scc {
+/**
+ * @class trace_window
+ * @brief controls the time window(s) in which the attached SCC trace files write value changes
+ *
+ * The window is either defined by simulation times or by triggers. In the time based mode the window opens at
+ * start_time and closes at stop_time (a zero stop_time keeps it open until the end of simulation). If a repeat_period
+ * is given the window re-opens every period. If a start_trigger is given the time parameters are ignored and the window
+ * opens each time the trigger fires. It closes either when the stop_trigger fires or after trigger_duration. A trigger
+ * is the hierarchical name of a sc_event, a signal or port of type bool (triggering at the rising edge) or a channel
+ * (triggering at its default event).
+ *
+ * If pre_trigger_time is not zero the trace files keep the value changes of this time window while being disabled
+ * and write them once the window opens.
+ *
+ * Trace files are attached using attach(), alternatively the functor returned by get_enable() can be passed to the
+ * create_*_trace_file() functions.
+ */
+class trace_window : public sc_core::sc_module {
+public:
+    /**
+     * @fn  trace_window(const sc_core::sc_module_name&)
+     * @brief constructor
+     *
+     * @param nm the instance name
+     */
+    trace_window(sc_core::sc_module_name const& nm);
+    /**
+     * @fn  ~trace_window()
+     * @brief destructor
+     */
+    virtual ~trace_window() = default;
+    /**
+     * @fn void attach(sc_core::sc_trace_file*)
+     * @brief lets the window control the given trace file, needs to be called before the end of elaboration
+     *
+     * @param tf the trace file created by one of the create_*_trace_file() functions
+     */
+    void attach(sc_core::sc_trace_file* tf);
+    /**
+     * @fn bool is_open()const
+     * @brief returns if the window is currently open
+     *
+     * @return true if value changes shall be written
+     */
+    bool is_open() const { return open; }
+    /**
+     * @fn std::function<bool()> get_enable()
+     * @brief returns a functor to be used as enable argument of the create_*_trace_file() functions
+     *
+     * @return the functor
+     */
+    std::function<bool()> get_enable() {
+        return [this]() -> bool { return open; };
+    }
+
+#ifdef HAS_CCI
+    cci::cci_param<sc_core::sc_time> start_time{"start_time", sc_core::SC_ZERO_TIME, "time the window opens"};
+    cci::cci_param<sc_core::sc_time> stop_time{"stop_time", sc_core::SC_ZERO_TIME,
+                                               "time the window closes, zero means never"};
+    cci::cci_param<sc_core::sc_time> repeat_period{"repeat_period", sc_core::SC_ZERO_TIME,
+                                                   "period in which the window re-opens, zero means no repetition"};
+    cci::cci_param<std::string> start_trigger{"start_trigger", "",
+                                              "name of the event, signal or port opening the window"};
+    cci::cci_param<std::string> stop_trigger{"stop_trigger", "",
+                                             "name of the event, signal or port closing the window"};
+    cci::cci_param<sc_core::sc_time> trigger_duration{
+        "trigger_duration", sc_core::SC_ZERO_TIME, "time the window stays open after the start trigger, zero means until the stop trigger"};
+    cci::cci_param<sc_core::sc_time> pre_trigger_time{
+        "pre_trigger_time", sc_core::SC_ZERO_TIME, "length of the window of value changes kept before the window opens"};
+#else
+    sc_core::sc_time start_time{sc_core::SC_ZERO_TIME};
+    sc_core::sc_time stop_time{sc_core::SC_ZERO_TIME};
+    sc_core::sc_time repeat_period{sc_core::SC_ZERO_TIME};
+    std::string start_trigger{""};
+    std::string stop_trigger{""};
+    sc_core::sc_time trigger_duration{sc_core::SC_ZERO_TIME};
+    sc_core::sc_time pre_trigger_time{sc_core::SC_ZERO_TIME};
+#endif
+
+protected:
+    void end_of_elaboration() override;
+
+    void time_window();
+
+    void open_window();
+
+    void close_window();
+
+    sc_core::sc_event const* find_trigger(std::string const& name);
+
+    bool open{false};
+    sc_core::sc_event close_evt;
+    std::vector<trace_capture_if*> files;
+};
+} // namespace scc
+/** @} */ // end of scc-sysc
+#endif /* _SCC_TRACE_WINDOW_H_ */
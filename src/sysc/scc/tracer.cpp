@@ -103,6 +103,7 @@ void tracer::init_scv_db(file_type type, std::string const&& name) {
             SCVNS scv_tr_sqlite_init();
             ss << ".txdb";
 #else
+            SCCWARN(SCMOD) << "SQLite support is not compiled in, recording transactions in text format";
             SCVNS scv_tr_text_init();
             ss << ".txlog";
 #endif
@@ -51,7 +51,7 @@ public:
      * @enum file_type
      * @brief defines the transaction trace output type
      *
-     * CUSTOM means the caller needs to initialize the database driver (scv_tr_text_init() or alike)
+     * CUSTOM selects the LZ4 compressed text database written by multiple threads (scv_tr_mtc_init())
      */
     enum file_type { NONE, TEXT, COMPRESSED, SQLITE, CUSTOM };
     /**
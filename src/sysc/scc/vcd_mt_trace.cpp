@@ -16,12 +16,17 @@
 
 #include "vcd_mt_trace.hh"
 #include "trace/gz_writer.hh"
-#define FWRITE(BUF, SZ, LEN, FP) FP->write(BUF, SZ* LEN)
+#include "trace/pre_trigger_buffer.hh"
+#include "trace/segment_manifest.hh"
+#define FWRITE(BUF, SZ, LEN, FP) FP->write(BUF, (SZ) * (LEN))
 #define FPTR gz_writer*
 #include "sc_vcd_trace.h"
 #include "trace/vcd_trace.hh"
 #include "utilities.h"
+#include <util/shm_ring.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <deque>
@@ -41,11 +46,26 @@ namespace scc {
 /*******************************************************************************************************
  *
  *******************************************************************************************************/
-vcd_mt_trace_file::vcd_mt_trace_file(const char* name, std::function<bool()>& enable)
+vcd_mt_trace_file::vcd_mt_trace_file(const char* name, std::function<bool()>& enable, unsigned compression_threads)
 : name(name)
-, check_enabled(enable) {
-    vcd_out = scc::make_unique<trace::gz_writer>(fmt::format("{}.vcd.gz", name));
+, check_enabled(enable)
+, compression_threads(std::max(1U, compression_threads)) {
+    register_trace_file();
+}
 
+vcd_mt_trace_file::vcd_mt_trace_file(const char* name, std::function<bool()>& enable,
+                                     std::unique_ptr<util::shm_ring_writer> live)
+: name(name)
+, check_enabled(enable)
+, compression_threads(0)
+, live(std::move(live)) {
+    // everything written is collected per time step and published into the ring buffer
+    vcd_out = scc::make_unique<trace::gz_writer>(std::string(), 0);
+    vcd_out->divert(&live_buf);
+    register_trace_file();
+}
+
+void vcd_mt_trace_file::register_trace_file() {
 #if defined(WITH_SC_TRACING_PHASE_CALLBACKS)
     // remove from hierarchy
     sc_object::detach();
@@ -59,7 +79,11 @@ vcd_mt_trace_file::vcd_mt_trace_file(const char* name, std::function<bool()>& en
 vcd_mt_trace_file::~vcd_mt_trace_file() {
     if(vcd_out) {
         FPRINTF(vcd_out, "#{}\n", sc_core::sc_time_stamp() / 1_ps);
+        if(live)
+            publish(sc_core::sc_time_stamp().value() / (1_ps).value());
     }
+    if(manifest)
+        manifest->close(sc_core::sc_time_stamp().value() / (1_ps).value());
     for(auto t:all_traces) delete t.trc;
 }
 
@@ -218,23 +242,17 @@ std::string vcd_mt_trace_file::obtain_name() {
 }
 
 void vcd_mt_trace_file::write_comment(const std::string& comment) {
+    if(!vcd_out)
+        open_output();
     FPRINTF(vcd_out, "$comment\n{}\n$end\n\n", comment);
 }
 
 void vcd_mt_trace_file::init() {
-    std::sort(std::begin(all_traces), std::end(all_traces),
-              [](trace_entry const& a, trace_entry const& b) -> bool { return a.trc->name < b.trc->name; });
-    std::unordered_map<uintptr_t, std::string> alias_map;
-
-    trace::vcd_scope_stack<trace::vcd_trace> scope;
-    for(auto& e : all_traces) {
-        auto alias_it = alias_map.find(e.trc->get_hash());
-        e.trc->is_alias = alias_it != std::end(alias_map);
-        e.trc->trc_hndl = e.trc->is_alias ? alias_it->second : obtain_name();
-        if(!e.trc->is_alias)
-            alias_map.insert({e.trc->get_hash(), e.trc->trc_hndl});
-        scope.add_trace(e.trc);
-    }
+    trace::scope_trie<trace::vcd_trace> scope(all_traces.size());
+    for(auto& e : all_traces)
+        scope.add(e.trc->name, e.trc);
+    scope.sort();
+    trace::vcdAssignHandles(scope, [this]() { return obtain_name(); });
     std::copy_if(std::begin(all_traces), std::end(all_traces), std::back_inserter(active_traces),
                  [](trace_entry const& e) { return !(e.trc->is_alias || e.trc->is_triggered); });
     changed_traces.reserve(active_traces.size());
@@ -254,7 +272,7 @@ void vcd_mt_trace_file::init() {
     std::stringstream ss;
     ss << "tracing " << active_traces.size() << " distinct traces out of " << all_traces.size() << " traces";
     write_comment(ss.str());
-    scope.print(vcd_out.get());
+    trace::vcdPrintScopes(vcd_out.get(), scope);
 }
 
 std::string vcd_mt_trace_file::prune_name(std::string const& orig_name) {
@@ -291,28 +309,50 @@ void vcd_mt_trace_file::cycle(bool delta_cycle) {
     if(delta_cycle)
         return;
     if(!initialized) {
+        if(!vcd_out)
+            open_output();
+        if(manifest || live)
+            vcd_out->divert(&header);
         init();
         initialized = true;
-        {
-            scc::trace::gz_writer::lock_type lock(vcd_out->writer_mtx);
-            vcd_out->write("$enddefinitions  $end\n\n$dumpvars\n");
-            for(auto& e : all_traces)
-                if(!e.trc->is_alias) {
-                    e.compare_and_update(e.trc);
-                    e.trc->record(vcd_out.get());
-                }
-            vcd_out->write("$end\n\n");
+        vcd_out->write("$enddefinitions  $end\n\n");
+        if(manifest) {
+            vcd_out->divert(nullptr);
+            vcd_out->write(header);
+        } else if(live) {
+            vcd_out->divert(&live_buf);
+            vcd_out->write(header);
         }
+        vcd_out->write("$dumpvars\n");
+        for(auto& e : all_traces)
+            if(!e.trc->is_alias) {
+                e.compare_and_update(e.trc);
+                e.trc->record(vcd_out.get());
+            }
+        vcd_out->write("$end\n\n");
+        if(live)
+            publish(sc_core::sc_time_stamp().value() / (1_ps).value());
     } else {
-        if(check_enabled && !check_enabled())
+        auto enabled = !check_enabled || check_enabled();
+        if(!enabled && !pre_trigger) {
+            // the changes of triggered traces are kept once per trace and written when tracing is enabled again
+            std::sort(std::begin(triggered_traces), std::end(triggered_traces));
+            triggered_traces.erase(std::unique(std::begin(triggered_traces), std::end(triggered_traces)),
+                                   std::end(triggered_traces));
             return;
+        }
+        if(pre_trigger) {
+            if(enabled)
+                pre_trigger->flush(vcd_out.get());
+            else
+                pre_trigger->divert(vcd_out.get());
+        }
         for(auto& e : active_traces) {
             if(e.compare_and_update(e.trc))
                 changed_traces.push_back(e.trc);
         }
         if(triggered_traces.size() || changed_traces.size()) {
-            scc::trace::gz_writer::lock_type lock(vcd_out->writer_mtx);
-            vcd_out->write(fmt::format("#{}\n", sc_core::sc_time_stamp() / 1_ps));
+            trace::vcdEmitTime(vcd_out.get(), sc_core::sc_time_stamp().value() / (1_ps).value());
             if(triggered_traces.size()) {
                 auto end = std::unique(std::begin(triggered_traces), std::end(triggered_traces));
                 for(auto it = triggered_traces.begin(); it != end; ++it)
@@ -325,14 +365,119 @@ void vcd_mt_trace_file::cycle(bool delta_cycle) {
                 changed_traces.clear();
             }
         }
+        if(!enabled) {
+            pre_trigger->capture(vcd_out.get(), sc_core::sc_time_stamp().value() / (1_ps).value());
+            if(live) // the capture ends the diversion
+                vcd_out->divert(&live_buf);
+        } else if(manifest) {
+            auto time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
+            if((max_segment_size && vcd_out->get_statistics().bytes >= max_segment_size) ||
+               (max_segment_time && time_stamp - segment_start >= max_segment_time))
+                rotate(time_stamp);
+        } else if(live)
+            publish(sc_core::sc_time_stamp().value() / (1_ps).value());
+    }
+}
+
+void vcd_mt_trace_file::set_pre_trigger(sc_core::sc_time const& window) {
+    auto depth = window.value() / (1_ps).value();
+    pre_trigger.reset(depth ? new trace::vcd_pre_trigger(depth) : nullptr);
+}
+
+void vcd_mt_trace_file::set_rotation(uint64_t max_size, sc_core::sc_time const& max_time) {
+    if(live)
+        return;
+    max_segment_size = max_size;
+    max_segment_time = max_time.value() / (1_ps).value();
+    if(!manifest && (max_segment_size || max_segment_time)) {
+        // from now on the output goes into the segment files, the first one is opened with the first output
+        manifest.reset(new trace::segment_manifest(name + ".vcd.json", "vcd"));
+        if(vcd_out) { // output started already, continue in a new segment
+            auto time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
+            if(initialized)
+                rotate(time_stamp);
+            else
+                open_segment(time_stamp);
+        }
+    }
+}
+
+void vcd_mt_trace_file::open_output() {
+    if(manifest)
+        open_segment(sc_core::sc_time_stamp().value() / (1_ps).value());
+    else
+        vcd_out = scc::make_unique<trace::gz_writer>(fmt::format("{}.vcd.gz", name), compression_threads);
+}
+
+void vcd_mt_trace_file::open_segment(uint64_t time_stamp) {
+    auto file_name =
+        trace::segment_manifest::segment_name(name, manifest->size(), compression_threads ? ".vcd.gz" : ".vcd");
+    vcd_out.reset();
+    vcd_out = scc::make_unique<trace::gz_writer>(file_name, compression_threads);
+    manifest->add(file_name, time_stamp);
+    segment_start = time_stamp;
+}
+
+void vcd_mt_trace_file::rotate(uint64_t time_stamp) {
+    open_segment(time_stamp);
+    vcd_out->write(header);
+    FPRINTF(vcd_out, "#{}\n$dumpvars\n", time_stamp);
+    for(auto& e : all_traces)
+        if(!e.trc->is_alias)
+            e.trc->record(vcd_out.get());
+    FPRINT(vcd_out, "$end\n\n");
+}
+
+void vcd_mt_trace_file::publish(uint64_t time_stamp) {
+    try {
+        if(live_buf.size()) {
+            live->write(util::shm::DATA, live_buf.data(), live_buf.size());
+            live_buf.clear();
+        }
+        if(live->resync_requested()) {
+            // same as the start of a rotated segment: the header followed by the current values of all traces
+            live_buf = header;
+            FPRINTF(vcd_out, "#{}\n$dumpvars\n", time_stamp);
+            for(auto& e : all_traces)
+                if(!e.trc->is_alias)
+                    e.trc->record(vcd_out.get());
+            FPRINT(vcd_out, "$end\n\n");
+            live->write(util::shm::SNAPSHOT, live_buf.data(), live_buf.size());
+            live_buf.clear();
+        }
+    } catch(std::length_error& e) {
+        // the ring is too small for the record
+        live_buf.clear();
+        SC_REPORT_ERROR("scc::vcd_mt_trace_file", e.what());
     }
 }
 
 void vcd_mt_trace_file::set_time_unit(double v, sc_core::sc_time_unit tu) {}
 
 sc_core::sc_trace_file* create_vcd_mt_trace_file(const char* name, std::function<bool()> enable) {
-    return new vcd_mt_trace_file(name, enable);
+    return new vcd_mt_trace_file(name, enable, 1);
+}
+
+sc_core::sc_trace_file* create_vcd_mt_trace_file(const char* name, unsigned compression_threads,
+                                                 std::function<bool()> enable) {
+    return new vcd_mt_trace_file(name, enable, compression_threads);
 }
 
 void close_vcd_mt_trace_file(sc_core::sc_trace_file* tf) { delete static_cast<vcd_mt_trace_file*>(tf); }
+
+sc_core::sc_trace_file* create_vcd_shm_trace_file(const char* name, size_t capacity, bool overwrite,
+                                                  std::function<bool()> enable) {
+    std::unique_ptr<util::shm_ring_writer> ring;
+    try {
+        ring.reset(new util::shm_ring_writer(util::shm::object_name(name), capacity,
+                                             overwrite ? util::shm::policy::OVERWRITE : util::shm::policy::DROP,
+                                             "vcd"));
+    } catch(std::runtime_error& e) {
+        SC_REPORT_ERROR("scc::create_vcd_shm_trace_file", e.what());
+        return nullptr;
+    }
+    return new vcd_mt_trace_file(name, enable, std::move(ring));
+}
+
+void close_vcd_shm_trace_file(sc_core::sc_trace_file* tf) { delete static_cast<vcd_mt_trace_file*>(tf); }
 } // namespace scc
@@ -15,7 +15,13 @@
  *******************************************************************************/
 
 #include "vcd_pull_trace.hh"
+#include "trace/gz_writer.hh"
+#include "trace/pre_trigger_buffer.hh"
+#include "trace/segment_manifest.hh"
+#define FWRITE(BUF, SZ, LEN, FP) FP->write(BUF, (SZ) * (LEN))
+#define FPTR gz_writer*
 #include "sc_vcd_trace.h"
+#include "trace/change_detector.hh"
 #include "trace/vcd_trace.hh"
 #include "utilities.h"
 
@@ -33,26 +39,17 @@
 #include <unordered_map>
 #include <vector>
 
-#define FPRINT(FP, FMTSTR)                                                                                             \
-    {                                                                                                                  \
-        auto buf = fmt::format(FMTSTR);                                                                                \
-        std::fwrite(buf.c_str(), 1, buf.size(), FP);                                                                   \
-    }
-#define FPRINTF(FP, FMTSTR, ...)                                                                                       \
-    {                                                                                                                  \
-        auto buf = fmt::format(FMTSTR, __VA_ARGS__);                                                                   \
-        std::fwrite(buf.c_str(), 1, buf.size(), FP);                                                                   \
-    }
+#define FPRINT(FP, FMTSTR) FP->write(fmt::format(FMTSTR));
+#define FPRINTF(FP, FMTSTR, ...) FP->write(fmt::format(FMTSTR, __VA_ARGS__));
 
 namespace scc {
 /*******************************************************************************************************
  *
  *******************************************************************************************************/
-vcd_pull_trace_file::vcd_pull_trace_file(const char* name, std::function<bool()>& enable)
+vcd_pull_trace_file::vcd_pull_trace_file(const char* name, std::function<bool()>& enable, unsigned compression_threads)
 : name(name)
-, check_enabled(enable) {
-    vcd_out = fopen(fmt::format("{}.vcd", name).c_str(), "w");
-
+, check_enabled(enable)
+, compression_threads(compression_threads) {
 #if defined(WITH_SC_TRACING_PHASE_CALLBACKS)
     // remove from hierarchy
     sc_object::detach();
@@ -66,8 +63,9 @@ vcd_pull_trace_file::vcd_pull_trace_file(const char* name, std::function<bool()>
 vcd_pull_trace_file::~vcd_pull_trace_file() {
     if(vcd_out) {
         FPRINTF(vcd_out, "#{}\n", sc_core::sc_time_stamp() / 1_ps);
-        fclose(vcd_out);
     }
+    if(manifest)
+        manifest->close(sc_core::sc_time_stamp().value() / (1_ps).value());
     for(auto t:all_traces) delete t.trc;
 }
 
@@ -80,11 +78,13 @@ template <typename T, typename OT = T> bool changed(trace::vcd_trace* trace) {
 }
 #define DECL_TRACE_METHOD_A(tp)                                                                                        \
     void vcd_pull_trace_file::trace(const tp& object, const std::string& name) {                                       \
-        all_traces.emplace_back(&changed<tp>, new trace::vcd_trace_t<tp>(object, name));                               \
+        all_traces.emplace_back(&changed<tp>, new trace::vcd_trace_t<tp>(object, name),                                \
+                                trace::shadow_size<tp>());                                                             \
     }
 #define DECL_TRACE_METHOD_B(tp)                                                                                        \
     void vcd_pull_trace_file::trace(const tp& object, const std::string& name, int width) {                            \
-        all_traces.emplace_back(&changed<tp>, new trace::vcd_trace_t<tp>(object, name));                               \
+        all_traces.emplace_back(&changed<tp>, new trace::vcd_trace_t<tp>(object, name),                                \
+                                trace::shadow_size<tp>());                                                             \
     }
 #define DECL_TRACE_METHOD_C(tp, tpo)                                                                                   \
     void vcd_pull_trace_file::trace(const tp& object, const std::string& name) {                                       \
@@ -132,7 +132,8 @@ DECL_TRACE_METHOD_A(sc_dt::sc_lv_base)
 #undef DECL_TRACE_METHOD_B
 
 void vcd_pull_trace_file::trace(const unsigned int& object, const std::string& name, const char** enum_literals) {
-    all_traces.emplace_back(&changed<unsigned int>, new trace::vcd_trace_enum(object, name, enum_literals));
+    all_traces.emplace_back(&changed<unsigned int>, new trace::vcd_trace_enum(object, name, enum_literals),
+                            trace::shadow_size<unsigned int>());
 }
 
 std::string vcd_pull_trace_file::obtain_name() {
@@ -163,25 +164,23 @@ std::string vcd_pull_trace_file::obtain_name() {
 }
 
 void vcd_pull_trace_file::write_comment(const std::string& comment) {
+    if(!vcd_out)
+        open_output();
     FPRINTF(vcd_out, "$comment\n{}\n$end\n\n", comment);
 }
 
 void vcd_pull_trace_file::init() {
-    std::sort(std::begin(all_traces), std::end(all_traces),
-              [](trace_entry const& a, trace_entry const& b) -> bool { return a.trc->name < b.trc->name; });
-    std::unordered_map<uintptr_t, std::string> alias_map;
-
-    trace::vcd_scope_stack<trace::vcd_trace> scope;
-    for(auto& e : all_traces) {
-        auto alias_it = alias_map.find(e.trc->get_hash());
-        e.trc->is_alias = alias_it != std::end(alias_map);
-        e.trc->trc_hndl = e.trc->is_alias ? alias_it->second : obtain_name();
-        if(!e.trc->is_alias)
-            alias_map.insert({e.trc->get_hash(), e.trc->trc_hndl});
-        scope.add_trace(e.trc);
-    }
+    trace::scope_trie<trace::vcd_trace> scope(all_traces.size());
+    for(auto& e : all_traces)
+        scope.add(e.trc->name, e.trc);
+    scope.sort();
+    trace::vcdAssignHandles(scope, [this]() { return obtain_name(); });
     std::copy_if(std::begin(all_traces), std::end(all_traces), std::back_inserter(active_traces),
                  [](trace_entry const& e) { return !e.trc->is_alias; });
+    detector.reset(new trace::change_detector<trace_entry>());
+    for(auto& e : active_traces)
+        if(!detector->add(&e, reinterpret_cast<void const*>(e.trc->get_hash()), e.shadow_size))
+            unshadowed_traces.push_back(&e);
     changed_traces.reserve(active_traces.size());
     // date:
     char tbuf[200];
@@ -197,7 +196,7 @@ void vcd_pull_trace_file::init() {
     std::stringstream ss;
     ss << "tracing " << active_traces.size() << " distinct traces out of " << all_traces.size() << " traces";
     write_comment(ss.str());
-    scope.print(vcd_out);
+    trace::vcdPrintScopes(vcd_out.get(), scope);
 }
 
 std::string vcd_pull_trace_file::prune_name(std::string const& orig_name) {
@@ -231,34 +230,114 @@ void vcd_pull_trace_file::cycle(bool delta_cycle) {
     if(delta_cycle)
         return;
     if(!initialized) {
+        if(!vcd_out)
+            open_output();
+        if(manifest)
+            vcd_out->divert(&header);
         init();
         initialized = true;
-        FPRINT(vcd_out, "$enddefinitions  $end\n\n$dumpvars\n");
+        FPRINT(vcd_out, "$enddefinitions  $end\n\n");
+        if(manifest) {
+            vcd_out->divert(nullptr);
+            vcd_out->write(header);
+        }
+        FPRINT(vcd_out, "$dumpvars\n");
         for(auto& e : active_traces) {
             e.compare_and_update(e.trc);
-            e.trc->record(vcd_out);
+            e.trc->record(vcd_out.get());
         }
         FPRINT(vcd_out, "$end\n\n");
     } else {
-        if(check_enabled && !check_enabled())
+        auto enabled = !check_enabled || check_enabled();
+        if(!enabled && !pre_trigger)
             return;
+        if(pre_trigger) {
+            if(enabled)
+                pre_trigger->flush(vcd_out.get());
+            else
+                pre_trigger->divert(vcd_out.get());
+        }
         changed_traces.clear();
-        for(auto& e : active_traces) {
+        detector->scan([this](trace_entry& e) {
             if(e.compare_and_update(e.trc))
                 changed_traces.push_back(e.trc);
+        });
+        for(auto* e : unshadowed_traces) {
+            if(e->compare_and_update(e->trc))
+                changed_traces.push_back(e->trc);
         }
         if(changed_traces.size()) {
-            FPRINTF(vcd_out, "#{}\n", sc_core::sc_time_stamp() / 1_ps);
+            trace::vcdEmitTime(vcd_out.get(), sc_core::sc_time_stamp().value() / (1_ps).value());
             for(auto& t : changed_traces)
-                t->record(vcd_out);
+                t->record(vcd_out.get());
+        }
+        if(!enabled)
+            pre_trigger->capture(vcd_out.get(), sc_core::sc_time_stamp().value() / (1_ps).value());
+        else if(manifest) {
+            auto time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
+            if((max_segment_size && vcd_out->get_statistics().bytes >= max_segment_size) ||
+               (max_segment_time && time_stamp - segment_start >= max_segment_time))
+                rotate(time_stamp);
+        }
+    }
+}
+
+void vcd_pull_trace_file::set_pre_trigger(sc_core::sc_time const& window) {
+    auto depth = window.value() / (1_ps).value();
+    pre_trigger.reset(depth ? new trace::vcd_pre_trigger(depth) : nullptr);
+}
+
+void vcd_pull_trace_file::set_rotation(uint64_t max_size, sc_core::sc_time const& max_time) {
+    max_segment_size = max_size;
+    max_segment_time = max_time.value() / (1_ps).value();
+    if(!manifest && (max_segment_size || max_segment_time)) {
+        // from now on the output goes into the segment files, the first one is opened with the first output
+        manifest.reset(new trace::segment_manifest(name + ".vcd.json", "vcd"));
+        if(vcd_out) { // output started already, continue in a new segment
+            auto time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
+            if(initialized)
+                rotate(time_stamp);
+            else
+                open_segment(time_stamp);
         }
     }
 }
 
+void vcd_pull_trace_file::open_output() {
+    if(manifest)
+        open_segment(sc_core::sc_time_stamp().value() / (1_ps).value());
+    else
+        vcd_out = scc::make_unique<trace::gz_writer>(
+            fmt::format("{}.vcd{}", name, compression_threads ? ".gz" : ""), compression_threads);
+}
+
+void vcd_pull_trace_file::open_segment(uint64_t time_stamp) {
+    auto file_name =
+        trace::segment_manifest::segment_name(name, manifest->size(), compression_threads ? ".vcd.gz" : ".vcd");
+    vcd_out.reset();
+    vcd_out = scc::make_unique<trace::gz_writer>(file_name, compression_threads);
+    manifest->add(file_name, time_stamp);
+    segment_start = time_stamp;
+}
+
+void vcd_pull_trace_file::rotate(uint64_t time_stamp) {
+    open_segment(time_stamp);
+    vcd_out->write(header);
+    FPRINTF(vcd_out, "#{}\n$dumpvars\n", time_stamp);
+    for(auto& e : active_traces)
+        e.trc->record(vcd_out.get());
+    FPRINT(vcd_out, "$end\n\n");
+}
+
 void vcd_pull_trace_file::set_time_unit(double v, sc_core::sc_time_unit tu) {}
 
 sc_core::sc_trace_file* create_vcd_pull_trace_file(const char* name, std::function<bool()> enable) {
-    return new vcd_pull_trace_file(name, enable);
+    return new vcd_pull_trace_file(name, enable, 0);
+}
+
+sc_core::sc_trace_file* create_vcd_pull_trace_file(const char* name, unsigned compression_threads,
+                                                  std::function<bool()> enable) {
+    return new vcd_pull_trace_file(name, enable, compression_threads);
 }
 
 void close_vcd_pull_trace_file(sc_core::sc_trace_file* tf) {
@@ -15,6 +15,11 @@
  *******************************************************************************/
 
 #include "vcd_push_trace.hh"
+#include "trace/gz_writer.hh"
+#include "trace/pre_trigger_buffer.hh"
+#include "trace/segment_manifest.hh"
+#define FWRITE(BUF, SZ, LEN, FP) FP->write(BUF, (SZ) * (LEN))
+#define FPTR gz_writer*
 #include "sc_vcd_trace.h"
 #include "trace/vcd_trace.hh"
 #include "utilities.h"
@@ -32,26 +37,17 @@
 #include <unordered_map>
 #include <vector>
 
-#define FPRINT(FP, FMTSTR)                                                                                             \
-    {                                                                                                                  \
-        auto buf = fmt::format(FMTSTR);                                                                                \
-        std::fwrite(buf.c_str(), 1, buf.size(), FP);                                                                   \
-    }
-#define FPRINTF(FP, FMTSTR, ...)                                                                                       \
-    {                                                                                                                  \
-        auto buf = fmt::format(FMTSTR, __VA_ARGS__);                                                                   \
-        std::fwrite(buf.c_str(), 1, buf.size(), FP);                                                                   \
-    }
+#define FPRINT(FP, FMTSTR) FP->write(fmt::format(FMTSTR));
+#define FPRINTF(FP, FMTSTR, ...) FP->write(fmt::format(FMTSTR, __VA_ARGS__));
 
 namespace scc {
 /*******************************************************************************************************
  *
  *******************************************************************************************************/
-vcd_push_trace_file::vcd_push_trace_file(const char* name, std::function<bool()>& enable)
+vcd_push_trace_file::vcd_push_trace_file(const char* name, std::function<bool()>& enable, unsigned compression_threads)
 : name(name)
-, check_enabled(enable) {
-    vcd_out = fopen(fmt::format("{}.vcd", name).c_str(), "w");
-
+, check_enabled(enable)
+, compression_threads(compression_threads) {
 #if defined(WITH_SC_TRACING_PHASE_CALLBACKS)
     // remove from hierarchy
     sc_object::detach();
@@ -65,8 +61,9 @@ vcd_push_trace_file::vcd_push_trace_file(const char* name, std::function<bool()>
 vcd_push_trace_file::~vcd_push_trace_file() {
     if(vcd_out) {
         FPRINTF(vcd_out, "#{}\n", sc_core::sc_time_stamp() / 1_ps);
-        fclose(vcd_out);
     }
+    if(manifest)
+        manifest->close(sc_core::sc_time_stamp().value() / (1_ps).value());
     for(auto t:all_traces) delete t.trc;
 }
 
@@ -224,31 +221,22 @@ std::string vcd_push_trace_file::obtain_name() {
 }
 
 void vcd_push_trace_file::write_comment(const std::string& comment) {
+    if(!vcd_out)
+        open_output();
     FPRINTF(vcd_out, "$comment\n{}\n$end\n\n", comment);
 }
 
 void vcd_push_trace_file::init() {
-    std::vector<trace_entry*> traces;
-    traces.reserve(all_traces.size());
+    trace::scope_trie<trace::vcd_trace> scope(all_traces.size());
     for(auto& e : all_traces)
-        traces.push_back(&e);
-    std::sort(std::begin(traces), std::end(traces),
-              [](trace_entry const* a, trace_entry const* b) -> bool { return a->trc->name < b->trc->name; });
-
-    std::unordered_map<uintptr_t, std::string> alias_map;
-    trace::vcd_scope_stack<trace::vcd_trace> scope;
-    for(auto e : traces) {
-        auto alias_it = alias_map.find(e->trc->get_hash());
-        e->trc->is_alias = alias_it != std::end(alias_map);
-        e->trc->trc_hndl = e->trc->is_alias ? alias_it->second : obtain_name();
-        if(!e->trc->is_alias)
-            alias_map.insert({e->trc->get_hash(), e->trc->trc_hndl});
-        scope.add_trace(e->trc);
-    }
-    std::copy_if(std::begin(traces), std::end(traces), std::back_inserter(pull_traces),
-                 [](trace_entry const* e) { return !(e->trc->is_alias || e->trc->is_triggered); });
+        scope.add(e.trc->name, e.trc);
+    scope.sort();
+    trace::vcdAssignHandles(scope, [this]() { return obtain_name(); });
+    for(auto& e : all_traces)
+        if(!(e.trc->is_alias || e.trc->is_triggered))
+            pull_traces.push_back(&e);
     changed_traces.reserve(pull_traces.size());
-    triggered_traces.reserve(traces.size());
+    triggered_traces.reserve(all_traces.size());
     // date:
     char tbuf[200];
     time_t long_time;
@@ -263,7 +251,7 @@ void vcd_push_trace_file::init() {
     std::stringstream ss;
     ss << "tracing " << pull_traces.size() << " distinct traces out of " << all_traces.size() << " traces";
     write_comment(ss.str());
-    scope.print(vcd_out);
+    trace::vcdPrintScopes(vcd_out.get(), scope);
 }
 
 std::string vcd_push_trace_file::prune_name(std::string const& orig_name) {
@@ -297,47 +285,124 @@ void vcd_push_trace_file::cycle(bool delta_cycle) {
     if(delta_cycle)
         return;
     if(last_emitted_ts==std::numeric_limits<uint64_t>::max()) {
+        if(!vcd_out)
+            open_output();
+        if(manifest)
+            vcd_out->divert(&header);
         init();
-        FPRINT(vcd_out, "$enddefinitions  $end\n\n$dumpvars\n");
+        FPRINT(vcd_out, "$enddefinitions  $end\n\n");
+        if(manifest) {
+            vcd_out->divert(nullptr);
+            vcd_out->write(header);
+        }
+        FPRINT(vcd_out, "$dumpvars\n");
         for(auto& e : all_traces)
             if(!e.trc->is_alias) {
                 e.compare_and_update(e.trc);
-                e.trc->record(vcd_out);
+                e.trc->record(vcd_out.get());
             }
         FPRINT(vcd_out, "$end\n\n");
         last_emitted_ts = sc_core::sc_time_stamp().value() / (1_ps).value();
     } else {
-        if(check_enabled && !check_enabled())
+        auto enabled = !check_enabled || check_enabled();
+        if(!enabled && !pre_trigger)
             return;
+        if(pre_trigger) {
+            if(enabled)
+                pre_trigger->flush(vcd_out.get());
+            else
+                pre_trigger->divert(vcd_out.get());
+        }
         for(auto e : pull_traces) {
             if(e->compare_and_update(e->trc))
                 changed_traces.push_back(e->trc);
         }
         if(triggered_traces.size() || changed_traces.size()) {
             uint64_t time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
-            FPRINTF(vcd_out, "#{}\n", time_stamp);
+            trace::vcdEmitTime(vcd_out.get(), time_stamp);
             auto end = std::unique(std::begin(triggered_traces), std::end(triggered_traces));
             triggered_traces.erase(end, triggered_traces.end());
             if(triggered_traces.size()) {
                 auto end = std::unique(std::begin(triggered_traces), std::end(triggered_traces));
                 for(auto it = triggered_traces.begin(); it != end; ++it)
-                    (*it)->record(vcd_out);
+                    (*it)->record(vcd_out.get());
                 triggered_traces.clear();
             }
             if(changed_traces.size()) {
                 for(auto t : changed_traces)
-                    t->record(vcd_out);
+                    t->record(vcd_out.get());
                 changed_traces.clear();
             }
             last_emitted_ts = time_stamp;
         }
+        if(!enabled)
+            pre_trigger->capture(vcd_out.get(), sc_core::sc_time_stamp().value() / (1_ps).value());
+        else if(manifest) {
+            auto time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
+            if((max_segment_size && vcd_out->get_statistics().bytes >= max_segment_size) ||
+               (max_segment_time && time_stamp - segment_start >= max_segment_time))
+                rotate(time_stamp);
+        }
     }
 }
 
+void vcd_push_trace_file::set_pre_trigger(sc_core::sc_time const& window) {
+    auto depth = window.value() / (1_ps).value();
+    pre_trigger.reset(depth ? new trace::vcd_pre_trigger(depth) : nullptr);
+}
+
+void vcd_push_trace_file::set_rotation(uint64_t max_size, sc_core::sc_time const& max_time) {
+    max_segment_size = max_size;
+    max_segment_time = max_time.value() / (1_ps).value();
+    if(!manifest && (max_segment_size || max_segment_time)) {
+        // from now on the output goes into the segment files, the first one is opened with the first output
+        manifest.reset(new trace::segment_manifest(name + ".vcd.json", "vcd"));
+        if(vcd_out) { // output started already, continue in a new segment
+            auto time_stamp = sc_core::sc_time_stamp().value() / (1_ps).value();
+            if(last_emitted_ts != std::numeric_limits<uint64_t>::max())
+                rotate(time_stamp);
+            else
+                open_segment(time_stamp);
+        }
+    }
+}
+
+void vcd_push_trace_file::open_output() {
+    if(manifest)
+        open_segment(sc_core::sc_time_stamp().value() / (1_ps).value());
+    else
+        vcd_out = scc::make_unique<trace::gz_writer>(
+            fmt::format("{}.vcd{}", name, compression_threads ? ".gz" : ""), compression_threads);
+}
+
+void vcd_push_trace_file::open_segment(uint64_t time_stamp) {
+    auto file_name =
+        trace::segment_manifest::segment_name(name, manifest->size(), compression_threads ? ".vcd.gz" : ".vcd");
+    vcd_out.reset();
+    vcd_out = scc::make_unique<trace::gz_writer>(file_name, compression_threads);
+    manifest->add(file_name, time_stamp);
+    segment_start = time_stamp;
+}
+
+void vcd_push_trace_file::rotate(uint64_t time_stamp) {
+    open_segment(time_stamp);
+    vcd_out->write(header);
+    FPRINTF(vcd_out, "#{}\n$dumpvars\n", time_stamp);
+    for(auto& e : all_traces)
+        if(!e.trc->is_alias)
+            e.trc->record(vcd_out.get());
+    FPRINT(vcd_out, "$end\n\n");
+}
+
 void vcd_push_trace_file::set_time_unit(double v, sc_core::sc_time_unit tu) {}
 
 sc_core::sc_trace_file* create_vcd_push_trace_file(const char* name, std::function<bool()> enable) {
-    return new vcd_push_trace_file(name, enable);
+    return new vcd_push_trace_file(name, enable, 0);
+}
+
+sc_core::sc_trace_file* create_vcd_push_trace_file(const char* name, unsigned compression_threads,
+                                                  std::function<bool()> enable) {
+    return new vcd_push_trace_file(name, enable, compression_threads);
 }
 
 void close_vcd_push_trace_file(sc_core::sc_trace_file* tf) { delete static_cast<vcd_push_trace_file*>(tf); }
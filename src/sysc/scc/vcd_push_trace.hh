@@ -19,11 +19,13 @@
 #define SCC_VCD_PUSH_TRACE_H
 
 #include <scc/observer.h>
+#include <scc/trace.h>
 #include <sysc/tracing/sc_trace.h>
 #include <sysc/kernel/sc_ver.h>
 #include <deque>
 #include <vector>
 #include <functional>
+#include <memory>
 
 namespace sc_core {
 class sc_time;
@@ -36,13 +38,22 @@ class sc_time;
 namespace scc {
 namespace trace {
 class vcd_trace;
+class gz_writer;
+class vcd_pre_trigger;
+class segment_manifest;
 }
-struct vcd_push_trace_file : public sc_core::sc_trace_file, public observer {
+struct vcd_push_trace_file : public sc_core::sc_trace_file, public observer, public trace_capture_if {
 
-    vcd_push_trace_file(const char *name, std::function<bool()>& enable);
+    vcd_push_trace_file(const char *name, std::function<bool()>& enable, unsigned compression_threads);
 
     virtual ~vcd_push_trace_file();
 
+    void set_enable(std::function<bool()> enable) override { check_enabled = enable; }
+
+    void set_pre_trigger(sc_core::sc_time const& window) override;
+
+    void set_rotation(uint64_t max_size, sc_core::sc_time const& max_time) override;
+
 protected:
 #define DECL_TRACE_METHOD_A(tp) void trace(const tp& object, const std::string& name) override;
 #define DECL_TRACE_METHOD_B(tp) void trace(const tp& object, const std::string& name, int width) override;
@@ -138,9 +149,14 @@ private:
     void init();
     std::string prune_name(std::string const& name);
     std::string obtain_name();
+    void open_output();
+    void open_segment(uint64_t time_stamp);
+    void rotate(uint64_t time_stamp);
     std::function<bool()> check_enabled;
 
-    FILE* vcd_out{nullptr};
+    std::unique_ptr<trace::gz_writer> vcd_out{nullptr};
+    //! keeps the value changes while tracing is disabled
+    std::unique_ptr<trace::vcd_pre_trigger> pre_trigger;
     struct trace_entry: public observer::notification_handle {
         bool (*compare_and_update)(trace::vcd_trace*);
         trace::vcd_trace* trc;
@@ -157,6 +173,12 @@ private:
     uint64_t last_emitted_ts{std::numeric_limits<uint64_t>::max()};
     unsigned vcd_name_index{0};
     std::string name;
+    unsigned const compression_threads;
+    //! the index of the segment files if the output is rotated
+    std::unique_ptr<trace::segment_manifest> manifest;
+    //! the definitions written at the beginning of each segment
+    std::string header;
+    uint64_t max_segment_size{0}, max_segment_time{0}, segment_start{0};
 };
 
 } // namespace scc
@@ -35,6 +35,7 @@
 #include "scc/perf_estimator.h"
 #include "scc/report.h"
 #include "scc/sc_logic_7.h"
+#include "scc/sc_observable_signal.h"
 #include "scc/sc_owning_signal.h"
 #include "scc/sc_variable.h"
 #include "scc/sc_vcd_trace.h"
@@ -42,6 +43,8 @@
 #include "scc/tick2time.h"
 #include "scc/time2tick.h"
 #include "scc/trace.h"
+#include "scc/trace_window.h"
+#include "scc/flight_recorder.h"
 #include "scc/traceable.h"
 #include "scc/tracer.h"
 #include "scc/tracer_base.h"
@@ -57,7 +60,9 @@
 #include "tlm/scc/scv/tlm_recorder_module.h"
 #include "tlm/scc/scv/tlm_recording_extension.h"
 
+#include "tlm/scc/async_offload_target.h"
 #include "tlm/scc/initiator_mixin.h"
+#include "tlm/scc/quantum_keeper.h"
 #include "tlm/scc/tlm2_pv_av.h"
 #include "tlm/scc/tlm_extensions.h"
 #include "tlm/scc/tlm_id.h"
@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _TLM_SCC_ASYNC_OFFLOAD_TARGET_H_
+#define _TLM_SCC_ASYNC_OFFLOAD_TARGET_H_
+
+#include "scc/report.h"
+#include "target_mixin.h"
+#ifdef HAS_CCI
+#include <cci_configuration>
+#endif
+#include <deque>
+#include <functional>
+#include <future>
+#include <tlm>
+#include <util/thread_pool.h>
+#include <util/thread_syncronizer.h>
+#include <vector>
+
+//! @brief SystemC TLM
+namespace tlm {
+//! @brief SCC TLM utilities
+namespace scc {
+/**
+ * @class async_offload_target
+ * @brief a target adapter executing the functional part of a transaction in a host worker thread
+ *
+ * The registered functor is executed in a thread of a util::thread_pool while the SystemC kernel continues to
+ * simulate. Therefore the functor must not call any SystemC API, it only may update the payload and the annotated
+ * delay. The delay passed to b_transport is the minimum latency of the target.
+ *
+ * In deterministic mode the calling thread waits for the minimum latency, if the functor did not finish by then the
+ * kernel is blocked until the result is available. Afterwards the remaining delay (if the functor increased it) is
+ * waited for. Hence the simulation result does not depend on the host timing.
+ *
+ * Otherwise (requires SystemC 2.3.2 or newer) the worker hands the result back to the kernel using
+ * async_request_update(). The transaction completes at the annotated completion time or, if the kernel already
+ * advanced beyond it, at the time the result arrived.
+ *
+ * @tparam BUSWIDTH the width of the target socket
+ */
+template <unsigned BUSWIDTH = 32> class async_offload_target : public sc_core::sc_module {
+public:
+    using functional_cb = std::function<void(tlm::tlm_generic_payload&, sc_core::sc_time&)>;
+    //! the statistics collected by the adapter
+    struct statistics {
+        //! number of offloaded transactions
+        uint64_t transactions{0};
+        //! number of transactions where the kernel had to wait for the worker thread
+        uint64_t kernel_stalls{0};
+    };
+
+    target_mixin<tlm::tlm_target_socket<BUSWIDTH>> tsck{"tsck"};
+
+#ifdef HAS_CCI
+    cci::cci_param<bool> deterministic{"deterministic", true,
+                                       "complete transactions independent of the host execution time"};
+#else
+    bool deterministic{true};
+#endif
+    /**
+     * @fn  async_offload_target(const sc_core::sc_module_name&, unsigned)
+     * @brief constructor
+     *
+     * @param nm the instance name
+     * @param worker_threads the number of host threads executing transactions
+     */
+    async_offload_target(const sc_core::sc_module_name& nm, unsigned worker_threads = 1)
+    : sc_core::sc_module(nm) {
+        workers.start(worker_threads);
+        tsck.register_b_transport(
+            [this](tlm::tlm_generic_payload& trans, sc_core::sc_time& t) -> void { b_transport(trans, t); });
+    }
+
+    ~async_offload_target() override { workers.finish(); }
+    /**
+     * @fn void register_b_transport(functional_cb)
+     * @brief register the functional part of the target being executed in a worker thread
+     *
+     * @param cb the functor, it must not call any SystemC API
+     */
+    void register_b_transport(functional_cb cb) { functional = cb; }
+    /**
+     * @fn const statistics& get_statistics()const
+     * @brief get the collected statistics
+     *
+     * @return reference to the statistics
+     */
+    const statistics& get_statistics() const { return stats; }
+
+protected:
+    void end_of_simulation() override {
+        if(stats.transactions)
+            SCCDEBUG(SCMOD) << "offloaded " << stats.transactions << " transactions, the kernel waited "
+                            << stats.kernel_stalls << " times for a worker thread";
+    }
+
+    void b_transport(tlm::tlm_generic_payload& trans, sc_core::sc_time& t) {
+        sc_assert(functional);
+        stats.transactions++;
+        auto min_delay = t;
+        sc_core::sc_time delay = t;
+#if(SYSTEMC_VERSION >= 20171012)
+        if(!static_cast<bool>(deterministic)) {
+            auto start = sc_core::sc_time_stamp();
+            auto* done = get_event();
+            sync.attach();
+            auto res = workers.enqueue([this, &trans, &delay, done, start]() {
+                functional(trans, delay);
+                sync.enqueue([done, start, &delay]() {
+                    auto now = sc_core::sc_time_stamp();
+                    done->notify(start + delay > now ? start + delay - now : sc_core::SC_ZERO_TIME);
+                });
+            });
+            sc_core::wait(*done);
+            sync.detach();
+            put_event(done);
+            res.get();
+            t = sc_core::SC_ZERO_TIME;
+            return;
+        }
+#endif
+        auto res = workers.enqueue([this, &trans, &delay]() { functional(trans, delay); });
+        sc_core::wait(min_delay);
+        if(res.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            stats.kernel_stalls++;
+            res.wait();
+        }
+        res.get();
+        if(delay > min_delay)
+            sc_core::wait(delay - min_delay);
+        t = sc_core::SC_ZERO_TIME;
+    }
+
+private:
+    //! executes the completion handlers of the worker threads in the update phase of the kernel
+    struct sync_channel : public sc_core::sc_prim_channel {
+        sync_channel()
+        : sc_core::sc_prim_channel(sc_core::sc_gen_unique_name("sync")) {}
+
+        template <typename F> void enqueue(F&& f) {
+            completions.enqueue(std::forward<F>(f));
+            async_request_update();
+        }
+#if(SYSTEMC_VERSION >= 20171012)
+        void attach() {
+            if(!attached++)
+                async_attach_suspending();
+        }
+
+        void detach() {
+            if(!--attached)
+                async_detach_suspending();
+        }
+#endif
+    protected:
+        void update() override {
+            while(completions.has_pending())
+                completions.execute();
+        }
+
+    private:
+        util::thread_syncronizer completions;
+        unsigned attached{0};
+    };
+
+    sc_core::sc_event* get_event() {
+        if(free_events.empty()) {
+            events.emplace_back();
+            return &events.back();
+        }
+        auto* evt = free_events.back();
+        free_events.pop_back();
+        return evt;
+    }
+
+    void put_event(sc_core::sc_event* evt) { free_events.push_back(evt); }
+
+    functional_cb functional;
+    util::thread_pool workers;
+    sync_channel sync;
+    std::deque<sc_core::sc_event> events;
+    std::vector<sc_core::sc_event*> free_events;
+    statistics stats;
+};
+} // namespace scc
+} // namespace tlm
+
+#endif /* _TLM_SCC_ASYNC_OFFLOAD_TARGET_H_ */
@@ -17,8 +17,10 @@
 #ifndef _TLM_SCC_INITIATOR_MIXIN_H__
 #define _TLM_SCC_INITIATOR_MIXIN_H__
 
+#include "quantum_keeper.h"
 #include "scc/utilities.h"
 #include <functional>
+#include <memory>
 #include <sstream>
 #include <tlm>
 
@@ -75,6 +77,42 @@ public:
     void register_invalidate_direct_mem_ptr(std::function<void(sc_dt::uint64, sc_dt::uint64)> cb) {
         bw_if.set_invalidate_direct_mem_function(cb);
     }
+    /**
+     * enable temporal decoupling for this initiator. Afterwards b_transport() accumulates the delays in the local time
+     * of a quantum keeper and synchronizes only when the quantum expired or a sync was requested. This needs to be
+     * called during elaboration.
+     */
+    void enable_temporal_decoupling() {
+        if(!qk)
+            qk.reset(new quantum_keeper(this->name()));
+    }
+    /**
+     * get the quantum keeper of this initiator
+     *
+     * @return the quantum keeper or nullptr if temporal decoupling is not enabled
+     */
+    quantum_keeper* get_quantum_keeper() { return qk.get(); }
+    /**
+     * execute a blocking transport. If temporal decoupling is enabled the delay is added to the local time of the
+     * quantum keeper, the transaction is sent with the local time as annotated delay, the keeper syncs if needed and t
+     * is SC_ZERO_TIME upon return. Otherwise the call is forwarded unchanged to the bound target, the same as calling
+     * (*this)->b_transport(trans, t).
+     *
+     * @param trans the transaction to send
+     * @param t the delay to add before sending the transaction
+     */
+    void b_transport(transaction_type& trans, sc_core::sc_time& t) {
+        if(qk) {
+            qk->inc(t);
+            auto delay = qk->get_local_time();
+            (*this)->b_transport(trans, delay);
+            qk->set(delay);
+            if(qk->need_sync())
+                qk->sync();
+            t = sc_core::SC_ZERO_TIME;
+        } else
+            (*this)->b_transport(trans, t);
+    }
 
 private:
     class bw_transport_if : public tlm::tlm_bw_transport_if<TYPES> {
@@ -129,6 +167,7 @@ private:
 
 private:
     bw_transport_if bw_if;
+    std::unique_ptr<quantum_keeper> qk;
 };
 } // namespace scc
 } // namespace tlm
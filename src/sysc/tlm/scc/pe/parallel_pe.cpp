@@ -16,6 +16,7 @@
 
 #define SC_INCLUDE_DYNAMIC_PROCESSES
 #include "parallel_pe.h"
+#include "scc/report.h"
 
 namespace tlm {
 namespace scc {
@@ -29,36 +30,63 @@ parallel_pe::parallel_pe(sc_core::sc_module_name const& nm)
 
 parallel_pe::~parallel_pe() = default;
 
+void parallel_pe::end_of_simulation() {
+    if(stats.transactions)
+        SCCDEBUG(SCMOD) << "executed " << stats.transactions << " transactions using " << threads.size()
+                        << " threads, peak outstanding " << stats.peak_outstanding << ", " << stats.queued_transactions
+                        << " transactions queued (peak queue size " << stats.peak_queue_size << ", max queue delay "
+                        << stats.max_queue_delay << ")";
+}
+
 void parallel_pe::transport(tlm::tlm_generic_payload& payload, bool lt_transport) {
-    if(!waiting_ids.size()) {
-        auto id = threads.size();
-        threads.resize(threads.size() + 1);
-        thread_unit& tu = threads.back();
-        tu.hndl = sc_core::sc_spawn(
-            [this, id]() -> void {
-                auto& tu = threads[id];
-                while(true) {
-                    fw_o->transport(*tu.gp, tu.lt_transport);
-                    bw_o->transport(*tu.gp);
-                    if(tu.gp->has_mm())
-                        tu.gp->release();
-                    tu.gp = nullptr;
-                    waiting_ids.push_back(id);
-                    wait(tu.evt);
-                    assert(tu.gp);
-                }
-            },
-            sc_core::sc_gen_unique_name("execute"));
-        tu.gp = &payload;
-    } else {
-        auto& tu = threads[waiting_ids.front()];
-        waiting_ids.pop_front();
+    if(payload.has_mm())
+        payload.acquire();
+    if(++outstanding > stats.peak_outstanding)
+        stats.peak_outstanding = outstanding;
+    if(idle_threads.size()) {
+        auto* tu = idle_threads.back();
+        idle_threads.pop_back();
+        tu->gp = &payload;
+        tu->lt_transport = lt_transport;
+        tu->evt.notify();
+    } else if(!static_cast<unsigned>(max_threads) || threads.size() < static_cast<unsigned>(max_threads)) {
+        threads.emplace_back();
+        auto& tu = threads.back();
         tu.gp = &payload;
         tu.lt_transport = lt_transport;
-        tu.evt.notify();
+        tu.hndl = sc_core::sc_spawn([this, &tu]() -> void { run(tu); }, sc_core::sc_gen_unique_name("execute"));
+    } else {
+        pending.push_back(pending_trans{&payload, lt_transport, sc_time_stamp()});
+        stats.queued_transactions++;
+        if(pending.size() > stats.peak_queue_size)
+            stats.peak_queue_size = pending.size();
+    }
+}
+
+void parallel_pe::run(thread_unit& tu) {
+    while(true) {
+        fw_o->transport(*tu.gp, tu.lt_transport);
+        bw_o->transport(*tu.gp);
+        if(tu.gp->has_mm())
+            tu.gp->release();
+        tu.gp = nullptr;
+        outstanding--;
+        stats.transactions++;
+        if(pending.size()) {
+            auto& p = pending.front();
+            auto delay = sc_time_stamp() - p.enqueue_time;
+            stats.total_queue_delay += delay;
+            if(delay > stats.max_queue_delay)
+                stats.max_queue_delay = delay;
+            tu.gp = p.gp;
+            tu.lt_transport = p.lt_transport;
+            pending.pop_front();
+        } else {
+            idle_threads.push_back(&tu);
+            wait(tu.evt);
+        }
+        sc_assert(tu.gp);
     }
-    if(payload.has_mm())
-        payload.acquire();
 }
 
 } /* namespace pe */
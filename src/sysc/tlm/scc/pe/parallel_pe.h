@@ -18,46 +18,108 @@
 #define _TLM_SCC_PE_PARALLEL_PE_H_
 
 #include "intor_if.h"
+#ifdef HAS_CCI
+#include <cci_configuration>
+#endif
 #include <deque>
 #include <tlm>
+#include <vector>
 //! @brief SystemC TLM
 namespace tlm {
 //! @brief SCC TLM utilities
 namespace scc {
 //! @brief SCC protocol engines
 namespace pe {
-
+/**
+ * @class parallel_pe
+ * @brief a protocol engine executing transactions in parallel SystemC threads
+ *
+ * Each incoming transaction is executed by a pooled thread. At most max_threads threads are created, further
+ * transactions are queued in FIFO order until a thread becomes free.
+ */
 class parallel_pe : public sc_core::sc_module, public intor_fw_nb {
     struct thread_unit {
         sc_core::sc_event evt;
         tlm::tlm_generic_payload* gp{nullptr};
         bool lt_transport{false};
         sc_core::sc_process_handle hndl{};
-        thread_unit(const thread_unit& o)
-        : gp(o.gp)
-        , lt_transport(o.lt_transport)
-        , hndl(o.hndl) {}
-        thread_unit() = default;
+    };
+    struct pending_trans {
+        tlm::tlm_generic_payload* gp;
+        bool lt_transport;
+        sc_core::sc_time enqueue_time;
     };
 
 public:
+    //! the statistics collected by the protocol engine
+    struct statistics {
+        //! number of completed transactions
+        uint64_t transactions{0};
+        //! number of transactions which needed to wait for a free thread
+        uint64_t queued_transactions{0};
+        //! maximum number of outstanding (executing and queued) transactions
+        unsigned peak_outstanding{0};
+        //! maximum number of transactions waiting for a free thread
+        unsigned peak_queue_size{0};
+        //! accumulated time transactions waited for a free thread
+        sc_core::sc_time total_queue_delay{sc_core::SC_ZERO_TIME};
+        //! maximum time a transaction waited for a free thread
+        sc_core::sc_time max_queue_delay{sc_core::SC_ZERO_TIME};
+    };
+
     sc_core::sc_export<intor_fw_nb> fw_i{"fw_i"};
 
     sc_core::sc_port<intor_bw_nb> bw_o{"bw_o"};
 
     sc_core::sc_port<intor_fw_b> fw_o{"fw_o"};
 
+#ifdef HAS_CCI
+    cci::cci_param<unsigned> max_threads{"max_threads", 0,
+                                         "maximum number of transactions executed in parallel, 0 means unlimited"};
+#else
+    unsigned max_threads{0};
+#endif
+
     parallel_pe(sc_core::sc_module_name const& nm);
 
     virtual ~parallel_pe();
+    /**
+     * @fn const statistics& get_statistics()const
+     * @brief get the collected statistics
+     *
+     * @return reference to the statistics
+     */
+    const statistics& get_statistics() const { return stats; }
+    /**
+     * @fn unsigned get_outstanding()const
+     * @brief get the number of currently outstanding (executing and queued) transactions
+     *
+     * @return the number of outstanding transactions
+     */
+    unsigned get_outstanding() const { return outstanding; }
+    /**
+     * @fn size_t get_thread_count()const
+     * @brief get the number of created threads
+     *
+     * @return the number of threads
+     */
+    size_t get_thread_count() const { return threads.size(); }
+
+protected:
+    void end_of_simulation() override;
 
 private:
     void transport(tlm::tlm_generic_payload& payload, bool lt_transport = false) override;
 
     void snoop_resp(tlm::tlm_generic_payload& payload, bool sync) override { fw_o->snoop_resp(payload, sync); }
 
-    std::deque<unsigned> waiting_ids;
-    std::vector<thread_unit> threads;
+    void run(thread_unit& tu);
+
+    std::vector<thread_unit*> idle_threads;
+    std::deque<pending_trans> pending;
+    std::deque<thread_unit> threads;
+    unsigned outstanding{0};
+    statistics stats;
 };
 
 } /* namespace pe */
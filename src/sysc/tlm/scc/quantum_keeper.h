@@ -0,0 +1,180 @@
+/*******************************************************************************
+ * Copyright 2022 MINRES Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef _TLM_SCC_QUANTUM_KEEPER_H_
+#define _TLM_SCC_QUANTUM_KEEPER_H_
+
+#ifndef SC_INCLUDE_DYNAMIC_PROCESSES // needed for sc_spawn
+#define SC_INCLUDE_DYNAMIC_PROCESSES
+#endif
+
+#include "scc/report.h"
+#include "scc/utilities.h"
+#include <memory>
+#include <string>
+#include <tlm>
+#include <tlm_utils/tlm_quantumkeeper.h>
+#ifdef HAS_CCI
+#include <cci_configuration>
+#endif
+
+//! @brief SystemC TLM
+namespace tlm {
+//! @brief SCC TLM utilities
+namespace scc {
+/**
+ * @class quantum_keeper
+ * @brief a quantum keeper with per-initiator quantum, sync requests and statistics
+ *
+ * The keeper uses the TLM global quantum unless a local quantum is set. Besides syncing upon quantum expiry a sync
+ * can be requested e.g. by an interrupt so that the initiator synchronizes with the next transaction. If CCI is
+ * available the global quantum is the parameter 'global_quantum' (created with the first keeper) and the local quantum
+ * is the parameter '<name>.quantum'.
+ */
+class quantum_keeper : public tlm_utils::tlm_quantumkeeper {
+public:
+    /**
+     * @fn  quantum_keeper(const std::string&)
+     * @brief constructor
+     *
+     * @param name the name of the keeper used for the CCI parameter and logging, usually the name of the initiator
+     */
+    explicit quantum_keeper(const std::string& name)
+    : name(name)
+#ifdef HAS_CCI
+    , quantum(name + ".quantum", sc_core::SC_ZERO_TIME, "local quantum, SC_ZERO_TIME selects the global quantum",
+              cci::CCI_ABSOLUTE_NAME)
+#endif
+    {
+        init_global_quantum();
+    }
+
+    quantum_keeper(const quantum_keeper&) = delete;
+
+    quantum_keeper& operator=(const quantum_keeper&) = delete;
+
+    ~quantum_keeper() override {
+        if(sync_count)
+            SCCDEBUG(name.c_str()) << "synchronized " << sync_count << " times, " << requested_sync_count
+                                   << " of them were requested";
+    }
+    /**
+     * @fn void set_quantum(const sc_core::sc_time&)
+     * @brief set the local quantum of this keeper
+     *
+     * @param t the quantum, SC_ZERO_TIME selects the global quantum
+     */
+    void set_quantum(const sc_core::sc_time& t) {
+#ifdef HAS_CCI
+        quantum.set_value(t);
+#else
+        quantum = t;
+#endif
+    }
+    /**
+     * @fn sc_core::sc_time get_quantum()const
+     * @brief get the effective quantum of this keeper
+     *
+     * @return the local quantum if set, the global quantum otherwise
+     */
+    sc_core::sc_time get_quantum() const {
+        sc_core::sc_time q = quantum;
+        return q == sc_core::SC_ZERO_TIME ? tlm::tlm_global_quantum::instance().get() : q;
+    }
+    /**
+     * @fn void request_sync()
+     * @brief request a synchronization with the next check of need_sync()
+     *
+     */
+    void request_sync() { sync_requested = true; }
+    /**
+     * @fn void sync_on(const sc_core::sc_event&)
+     * @brief request a synchronization whenever the given event is notified e.g. an interrupt or tlm_signal value
+     * change. This spawns a method process so it needs to be called during elaboration or simulation.
+     *
+     * @param evt the event to monitor
+     */
+    void sync_on(const sc_core::sc_event& evt) {
+        sc_core::sc_spawn_options opts;
+        opts.spawn_method();
+        opts.dont_initialize();
+        opts.set_sensitivity(&evt);
+        sc_core::sc_spawn([this]() { request_sync(); }, sc_core::sc_gen_unique_name("sync_on"), &opts);
+    }
+
+    bool need_sync() const override { return sync_requested || tlm_utils::tlm_quantumkeeper::need_sync(); }
+
+    void sync() override {
+        sync_count++;
+        if(sync_requested)
+            requested_sync_count++;
+        sync_requested = false;
+        tlm_utils::tlm_quantumkeeper::sync();
+    }
+    /**
+     * @fn uint64_t get_sync_count()const
+     * @brief get the number of synchronizations
+     *
+     * @return the number of calls to sync()
+     */
+    uint64_t get_sync_count() const { return sync_count; }
+    /**
+     * @fn uint64_t get_requested_sync_count()const
+     * @brief get the number of synchronizations caused by a sync request
+     *
+     * @return the number of requested synchronizations
+     */
+    uint64_t get_requested_sync_count() const { return requested_sync_count; }
+
+protected:
+    sc_core::sc_time compute_local_quantum() override {
+        sc_core::sc_time q = quantum;
+        if(q == sc_core::SC_ZERO_TIME)
+            return tlm_utils::tlm_quantumkeeper::compute_local_quantum();
+        auto now = sc_core::sc_time_stamp();
+        return sc_core::sc_time::from_value(q.value() - now.value() % q.value());
+    }
+
+    static void init_global_quantum() {
+#ifdef HAS_CCI
+        // the parameter is shared by all keepers and intentionally never destroyed as it has to outlive them
+        static cci::cci_param<sc_core::sc_time>* global_quantum = nullptr;
+        if(global_quantum)
+            return;
+        global_quantum = new cci::cci_param<sc_core::sc_time>("global_quantum",
+                                                              tlm::tlm_global_quantum::instance().get(),
+                                                              "the TLM global quantum", cci::CCI_ABSOLUTE_NAME);
+        tlm::tlm_global_quantum::instance().set(global_quantum->get_value());
+        global_quantum->register_post_write_callback([](cci::cci_param_write_event<sc_core::sc_time> const& ev) {
+            tlm::tlm_global_quantum::instance().set(ev.new_value);
+        });
+#endif
+    }
+
+private:
+    const std::string name;
+#ifdef HAS_CCI
+    cci::cci_param<sc_core::sc_time> quantum;
+#else
+    sc_core::sc_time quantum{sc_core::SC_ZERO_TIME};
+#endif
+    bool sync_requested{false};
+    uint64_t sync_count{0}, requested_sync_count{0};
+};
+} // namespace scc
+} // namespace tlm
+
+#endif /* _TLM_SCC_QUANTUM_KEEPER_H_ */
@@ -80,9 +80,18 @@ public:
         if(ext_rec[id])
             delete ext_rec[id];
         ext_rec[id] = ext;
+        active.clear();
+        for(auto* e : ext_rec)
+            if(e)
+                active.push_back(e);
     }
 
     const std::vector<tlm_extensions_recording_if<TYPES>*>& get() { return ext_rec; }
+    /*! \brief get the registered extension recorders without the empty slots of unregistered extension ids
+     *
+     * The returned vector is updated in place when an extension recorder is registered.
+     */
+    const std::vector<tlm_extensions_recording_if<TYPES>*>& get_active() { return active; }
 
     inline void recordBeginTx(size_t id, SCVNS scv_tr_handle& handle, typename TYPES::tlm_payload_type& trans) {
         if(ext_rec.size() > id && ext_rec[id])
@@ -105,6 +114,7 @@ private:
             delete(ext);
     }
     std::vector<tlm_extensions_recording_if<TYPES>*> ext_rec{};
+    std::vector<tlm_extensions_recording_if<TYPES>*> active{};
 };
 
 } // namespace scv
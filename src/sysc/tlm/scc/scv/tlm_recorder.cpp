@@ -17,7 +17,17 @@
 #define SC_INCLUDE_DYNAMIC_PROCESSES
 #include "tlm_recorder.h"
 #include "tlm_extension_recording_registry.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <scc/report.h>
+#include <sstream>
 #include <tlm/scc/tlm_id.h>
+#include <unordered_map>
+#ifdef HAS_LZ4
+#include <lz4.h>
+#endif
 
 namespace tlm {
 namespace scc {
@@ -32,6 +42,123 @@ const std::array<std::string, 4> dmi2char{
     {"DMI_ACCESS_NONE", "DMI_ACCESS_READ", "DMI_ACCESS_WRITE", "DMI_ACCESS_READ_WRITE"}};
 const std::array<std::string, 3> sync2char{{"ACCEPTED", "UPDATED", "COMPLETED"}};
 
+inline uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+//! a 128 bit content hash, a collision of distinct contents is negligible so no byte compare is needed
+struct hash128 {
+    uint64_t lo, hi;
+    bool operator==(hash128 const& o) const { return lo == o.lo && hi == o.hi; }
+};
+
+struct hash128_hasher {
+    size_t operator()(hash128 const& h) const { return static_cast<size_t>(h.lo); }
+};
+//! two independently seeded lanes, the second one also rotates the input words
+hash128 content_hash(uint8_t const* data, size_t len) {
+    auto lo = mix(0x9e3779b97f4a7c15ULL ^ len);
+    auto hi = mix(0x632be59bd9b4e019ULL + len);
+    auto add = [&lo, &hi](uint64_t v) {
+        lo = mix(lo ^ v);
+        hi = mix(hi + ((v << 29) | (v >> 35)));
+    };
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        add(v);
+    }
+    if(i < len) {
+        uint64_t v = 0;
+        memcpy(&v, data + i, len - i);
+        add(v);
+    }
+    return hash128{lo, mix(hi ^ lo)};
+}
+/**
+ * @class blob_store
+ * @brief stores the unique payload contents of a transaction database in the file <database name>.blob
+ *
+ * The file starts with the magic 'SCCBLOB1' followed by the blobs. Each blob consists of its ID (8 byte), its size
+ * (4 byte), the size of the stored data (4 byte), all little endian, and the stored data. If both sizes differ the
+ * data is a LZ4 compressed block otherwise it is stored uncompressed. The IDs are assigned in ascending order starting
+ * at 0. Only the 128 bit hashes of the stored contents are kept in memory to look them up.
+ */
+class blob_store {
+public:
+    blob_store(std::string const& name)
+    : out(name, std::ios::binary | std::ios::trunc) {
+        if(!out.is_open())
+            SCCWARN("tlm_recorder") << "could not open payload data file " << name;
+        out.write("SCCBLOB1", 8);
+    }
+
+    uint64_t store(uint8_t const* data, size_t len) {
+        auto res = known.emplace(content_hash(data, len), next_id);
+        if(!res.second)
+            return res.first->second;
+        auto id = next_id++;
+        auto stored = len;
+        auto const* ptr = reinterpret_cast<char const*>(data);
+#ifdef HAS_LZ4
+        buffer.resize(LZ4_compressBound(static_cast<int>(len)));
+        auto size = LZ4_compress_default(ptr, buffer.data(), static_cast<int>(len), static_cast<int>(buffer.size()));
+        if(size > 0 && static_cast<size_t>(size) < len) {
+            stored = size;
+            ptr = buffer.data();
+        }
+#endif
+        write(id, 8);
+        write(len, 4);
+        write(stored, 4);
+        out.write(ptr, stored);
+        return id;
+    }
+
+    static blob_store* get(SCVNS scv_tr_db const* db) {
+        if(!db)
+            return nullptr;
+        auto& store = stores()[db];
+        if(!store) {
+            static bool registered = false;
+            if(!registered) {
+                SCVNS scv_tr_db::register_class_cb(&db_cb);
+                registered = true;
+            }
+            store.reset(new blob_store(std::string(db->get_name()) + ".blob"));
+        }
+        return store.get();
+    }
+
+private:
+    static std::unordered_map<SCVNS scv_tr_db const*, std::unique_ptr<blob_store>>& stores() {
+        static std::unordered_map<SCVNS scv_tr_db const*, std::unique_ptr<blob_store>> s;
+        return s;
+    }
+
+    static void db_cb(SCVNS scv_tr_db const& db, SCVNS scv_tr_db::callback_reason reason, void*) {
+        if(reason == SCVNS scv_tr_db::DELETE)
+            stores().erase(&db);
+    }
+
+    void write(uint64_t v, size_t len) {
+        char buf[8];
+        for(size_t i = 0; i < len; ++i)
+            buf[i] = static_cast<char>(v >> (8 * i));
+        out.write(buf, len);
+    }
+
+    std::ofstream out;
+    //! the IDs of the stored contents by their hash
+    std::unordered_map<hash128, uint64_t, hash128_hasher> known;
+    uint64_t next_id{0};
+    std::vector<char> buffer;
+};
 } // namespace
 void record(SCVNS scv_tr_handle& handle, tlm::tlm_generic_payload& o) {
     handle.record_attribute("trans.ptr", reinterpret_cast<uintptr_t>(&o));
@@ -53,6 +180,18 @@ void record(SCVNS scv_tr_handle& handle, tlm::tlm_generic_payload& o) {
         handle.record_attribute("trans.data_value", buf);
     }
 }
+void record_data(SCVNS scv_tr_handle& handle, tlm::tlm_generic_payload& o, unsigned max_size) {
+    if(!o.get_data_ptr() || !o.get_data_length())
+        return;
+    if(auto* store = blob_store::get(handle.get_scv_tr_stream().get_scv_tr_db())) {
+        handle.record_attribute("trans.data_blob",
+                                store->store(o.get_data_ptr(), std::min<size_t>(o.get_data_length(), max_size)));
+        if(o.get_byte_enable_ptr() && o.get_byte_enable_length())
+            handle.record_attribute(
+                "trans.byte_enable_blob",
+                store->store(o.get_byte_enable_ptr(), std::min<size_t>(o.get_byte_enable_length(), max_size)));
+    }
+}
 void record(SCVNS scv_tr_handle& handle, tlm::tlm_phase& o) {
     unsigned id = o;
     if(id < phase2char.size())
@@ -70,6 +209,39 @@ void record(SCVNS scv_tr_handle& handle, tlm::tlm_dmi& o) {
     handle.record_attribute("trans.write_latency", o.get_write_latency().to_string());
 }
 
+std::vector<std::pair<uint64_t, uint64_t>> parse_address_ranges(std::string const& ranges) {
+    std::vector<std::pair<uint64_t, uint64_t>> ret;
+    std::istringstream is(ranges);
+    std::string range;
+    while(std::getline(is, range, ',')) {
+        auto first = range.find_first_not_of(" \t");
+        if(first == std::string::npos)
+            continue;
+        range = range.substr(first, range.find_last_not_of(" \t") - first + 1);
+        try {
+            auto pos = range.find_first_of("-+", 1);
+            if(pos == std::string::npos) {
+                auto addr = std::stoull(range, nullptr, 0);
+                ret.emplace_back(addr, addr);
+            } else {
+                auto start = std::stoull(range.substr(0, pos), nullptr, 0);
+                auto end = std::stoull(range.substr(pos + 1), nullptr, 0);
+                if(range[pos] == '+') {
+                    if(!end)
+                        throw std::invalid_argument("empty range");
+                    end = start + end - 1;
+                }
+                if(end < start)
+                    throw std::invalid_argument("end before start");
+                ret.emplace_back(start, end);
+            }
+        } catch(std::exception& e) {
+            SCCWARN("tlm_recorder") << "ignoring malformed address range '" << range << "' (" << e.what() << ")";
+        }
+    }
+    return ret;
+}
+
 class tlm_id_ext_recording : public tlm_extensions_recording_if<tlm::tlm_base_protocol_types> {
 
     void recordBeginTx(SCVNS scv_tr_handle& handle, tlm::tlm_base_protocol_types::tlm_payload_type& trans) override {
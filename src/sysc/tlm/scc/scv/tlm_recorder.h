@@ -20,6 +20,7 @@
 #include "tlm_extension_recording_registry.h"
 #include "tlm_recording_extension.h"
 #include <array>
+#include <scc/flight_recorder.h>
 #include <regex>
 #include <sstream>
 #include <string>
@@ -27,6 +28,12 @@
 #include <tlm>
 #include <tlm_utils/peq_with_cb_and_phase.h>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#ifdef HAS_CCI
+#include <cci_configuration>
+#endif
 
 //! @brief SystemC TLM
 namespace tlm {
@@ -39,11 +46,33 @@ void record(SCVNS scv_tr_handle&, tlm::tlm_generic_payload&);
 void record(SCVNS scv_tr_handle&, tlm::tlm_phase&);
 void record(SCVNS scv_tr_handle&, tlm::tlm_sync_enum);
 void record(SCVNS scv_tr_handle&, tlm::tlm_dmi&);
+/**
+ * @fn void record_data(scv_tr_handle&, tlm::tlm_generic_payload&, unsigned)
+ * @brief records the data and the byte enables of a payload. The contents are stored once per database in the file
+ * <database name>.blob, the transaction refers to them by their blob ID in the attributes trans.data_blob and
+ * trans.byte_enable_blob
+ *
+ * @param handle the transaction handle
+ * @param o the payload
+ * @param max_size the maximum number of bytes being recorded
+ */
+void record_data(SCVNS scv_tr_handle& handle, tlm::tlm_generic_payload& o, unsigned max_size);
+/**
+ * @fn std::vector<std::pair<uint64_t, uint64_t>> parse_address_ranges(std::string const&)
+ * @brief parses a comma separated list of address windows given as 'start-end' (end is inclusive) or 'start+size'.
+ * Numbers can be decimal, hexadecimal (0x prefix) or octal (0 prefix), malformed entries are reported and ignored
+ *
+ * @param ranges the textual representation of the address windows
+ * @return the list of windows as pairs of first and last address
+ */
+std::vector<std::pair<uint64_t, uint64_t>> parse_address_ranges(std::string const& ranges);
 
 namespace impl {
 template <typename TYPES = tlm::tlm_base_protocol_types> class tlm_recording_payload : public TYPES::tlm_payload_type {
 public:
     SCVNS scv_tr_handle parent;
+    //! the transaction on the timed stream of a blocking access, set with BEGIN_REQ and ended with END_RESP
+    SCVNS scv_tr_handle timed;
     uint64_t id;
     tlm_recording_payload& operator=(const typename TYPES::tlm_payload_type& x) {
         id = reinterpret_cast<uintptr_t>(&x);
@@ -60,6 +89,7 @@ public:
     explicit tlm_recording_payload(tlm::tlm_mm_interface* mm)
     : TYPES::tlm_payload_type(mm)
     , parent()
+    , timed()
     , id(0) {}
 };
 template <typename TYPES = tlm::tlm_base_protocol_types> struct tlm_recording_types {
@@ -101,6 +131,26 @@ public:
     //! \brief the attribute to selectively enable/disable DMI recording
     sc_core::sc_attribute<bool> enableDmiTracing{"enableDmiTracing", false};
 
+#ifdef HAS_CCI
+    //! \brief the address windows of the transactions being recorded, see parse_address_ranges(), empty means all
+    cci::cci_param<std::string> filter_address_ranges;
+    //! \brief bit mask of the commands being recorded, bit 0 is READ, bit 1 WRITE and bit 2 IGNORE
+    cci::cci_param<unsigned> filter_commands;
+    //! \brief the minimum data length of the transactions being recorded
+    cci::cci_param<unsigned> filter_min_length;
+    //! \brief record only every n-th transaction passing the other filters, 0 and 1 record all of them
+    cci::cci_param<unsigned> filter_sampling;
+    //! \brief the number of data bytes being recorded per transaction, see record_data(), 0 disables it. Write data is
+    //! recorded with the request, read data with the response
+    cci::cci_param<unsigned> record_data_size;
+#else
+    std::string filter_address_ranges{""};
+    unsigned filter_commands{7};
+    unsigned filter_min_length{0};
+    unsigned filter_sampling{1};
+    unsigned record_data_size{0};
+#endif
+
     //! \brief the port where fw accesses are forwarded to
     sc_core::sc_port_b<tlm::tlm_fw_transport_if<TYPES>>& fw_port;
 
@@ -143,6 +193,21 @@ public:
                  SCVNS scv_tr_db* tr_db = SCVNS scv_tr_db::get_default_db())
     : enableBlTracing("enableBlTracing", recording_enabled)
     , enableNbTracing("enableNbTracing", recording_enabled)
+#ifdef HAS_CCI
+    , filter_address_ranges(std::string(name) + ".filter_address_ranges", "",
+                            "comma separated list of address windows ('start-end' or 'start+size') to record",
+                            cci::CCI_ABSOLUTE_NAME)
+    , filter_commands(std::string(name) + ".filter_commands", 7,
+                      "bit mask of the commands to record (bit 0 READ, bit 1 WRITE, bit 2 IGNORE)",
+                      cci::CCI_ABSOLUTE_NAME)
+    , filter_min_length(std::string(name) + ".filter_min_length", 0, "minimum data length of a recorded transaction",
+                        cci::CCI_ABSOLUTE_NAME)
+    , filter_sampling(std::string(name) + ".filter_sampling", 1, "record only every n-th transaction",
+                      cci::CCI_ABSOLUTE_NAME)
+    , record_data_size(std::string(name) + ".record_data_size", 0,
+                       "number of data bytes recorded per transaction, 0 disables the recording of data",
+                       cci::CCI_ABSOLUTE_NAME)
+#endif
     , fw_port(fw_port)
     , bw_port(bw_port)
     , b_timed_peq(this, &tlm_recorder::btx_cb)
@@ -151,7 +216,8 @@ public:
     , fixed_basename(name) {}
 
     virtual ~tlm_recorder() override {
-        btx_handle_map.clear();
+        for(auto* p : ext_free_list)
+            delete p; // NOLINT
         nbtx_req_handle_map.clear();
         nbtx_last_req_handle_map.clear();
         delete b_streamHandle;
@@ -242,6 +308,107 @@ public:
     inline bool isRecordingNonBlockingTxEnabled() const { return m_db && enableNbTracing.value; }
 
 private:
+    /*! \brief check if an address window is covered by the address filter
+     *
+     * \param first is the first address of the window
+     * \param last is the last address of the window
+     * \return true if the window overlaps with one of the filter windows or no address filter is set
+     */
+    inline bool in_address_ranges(uint64_t first, uint64_t last) const {
+        if(filter.address_ranges.empty())
+            return true;
+        for(auto& r : filter.address_ranges)
+            if(first <= r.second && last >= r.first)
+                return true;
+        return false;
+    }
+    /*! \brief check if a transaction passes the filters
+     *
+     * The address, command and length filters only depend on the payload so they yield the same result in all phases
+     * of a transaction. The sampling decision of non-blocking transactions is taken with BEGIN_REQ and remembered until
+     * the transaction finishes.
+     * \param trans is the generic payload of the transaction
+     * \param start is true if this is the first call of the transaction
+     * \param track is true if the sampling decision needs to be remembered
+     * \return true if the transaction shall be recorded
+     */
+    inline bool is_recorded(typename TYPES::tlm_payload_type& trans, bool start, bool track) {
+        if(!((filter.commands >> trans.get_command()) & 1) || trans.get_data_length() < filter.min_length)
+            return false;
+        auto first = trans.get_address();
+        if(!in_address_ranges(first, first + (trans.get_data_length() ? trans.get_data_length() - 1 : 0)))
+            return false;
+        if(filter.sampling < 2)
+            return true;
+        if(!start)
+            return filter.sampled.count(reinterpret_cast<uintptr_t>(&trans)) != 0;
+        if(++filter.sample_count < filter.sampling)
+            return false;
+        filter.sample_count = 0;
+        if(track)
+            filter.sampled.insert(reinterpret_cast<uintptr_t>(&trans));
+        return true;
+    }
+    //! \brief forget the sampling decision of a finished non-blocking transaction
+    inline void finish_sampled(typename TYPES::tlm_payload_type& trans) {
+        if(filter.sampling > 1)
+            filter.sampled.erase(reinterpret_cast<uintptr_t>(&trans));
+    }
+    /*! \brief writes an access into the flight recorder when leaving the scope of a transport function
+     *
+     * The start time is taken when entering and the end time when leaving the function, both include the annotated
+     * delay. If the flight recorder is disabled it does nothing.
+     */
+    struct flight_record {
+        flight_record(tlm_recorder* recorder, ::scc::flight_recorder::kind kind, typename TYPES::tlm_payload_type& trans,
+                      sc_core::sc_time const& delay, unsigned phase = 0)
+        : recorder(::scc::flight_recorder::enabled() ? recorder : nullptr)
+        , kind(kind)
+        , trans(trans)
+        , delay(delay)
+        , phase(phase)
+        , start(this->recorder ? (sc_core::sc_time_stamp() + delay).value() : 0) {}
+
+        ~flight_record() {
+            if(recorder) {
+                if(recorder->flight_source < 0)
+                    recorder->flight_source = ::scc::flight_recorder::get().register_source(recorder->fixed_basename);
+                ::scc::flight_recorder::get().record_tx(kind, recorder->flight_source, trans.get_command(),
+                                                        trans.get_address(), trans.get_data_length(),
+                                                        trans.get_response_status(), phase, start,
+                                                        (sc_core::sc_time_stamp() + delay).value());
+            }
+        }
+
+        tlm_recorder* const recorder;
+        ::scc::flight_recorder::kind const kind;
+        typename TYPES::tlm_payload_type& trans;
+        sc_core::sc_time const& delay;
+        unsigned const phase;
+        uint64_t const start;
+    };
+    //! the id of this recorder in the flight recorder
+    int flight_source{-1};
+    //! \brief take over the filter and data recording settings, they are evaluated when the first stream is created
+    void initialize_filter() {
+        std::string ranges = filter_address_ranges;
+        filter.address_ranges = parse_address_ranges(ranges);
+        filter.commands = filter_commands;
+        filter.min_length = filter_min_length;
+        filter.sampling = filter_sampling;
+        filter.data_size = record_data_size;
+        filter.initialized = true;
+    }
+    //! the filter settings used during simulation
+    struct {
+        std::vector<std::pair<uint64_t, uint64_t>> address_ranges;
+        unsigned commands{7}, min_length{0}, sampling{1}, sample_count{0};
+        //! the number of data bytes being recorded
+        unsigned data_size{0};
+        //! the non-blocking transactions selected by the sampling which are not yet finished
+        std::unordered_set<uintptr_t> sampled;
+        bool initialized{false};
+    } filter;
     //! event queue to hold time points of blocking transactions
     tlm_utils::peq_with_cb_and_phase<tlm_recorder, recording_types> b_timed_peq;
     //! event queue to hold time points of non-blocking transactions
@@ -267,7 +434,11 @@ private:
     //! transaction generator handle for blocking transactions with annotated
     //! delays
     std::array<SCVNS scv_tr_generator<>*, 3> b_trTimedHandle{{nullptr, nullptr, nullptr}};
-    std::unordered_map<uint64_t, SCVNS scv_tr_handle> btx_handle_map;
+    //! the recording extensions not in use, they are attached to blocking transactions for the duration of the call
+    std::vector<tlm_recording_extension*> ext_free_list;
+    //! the registered extension recorders
+    std::vector<tlm_extensions_recording_if<TYPES>*> const& ext_recorders{
+        tlm_extension_recording_registry<TYPES>::inst().get_active()};
 
     enum DIR { FW, BW, REQ = FW, RESP = BW };
     //! non-blocking transaction recording stream handle
@@ -289,6 +460,8 @@ private:
 
 public:
     void initialize_streams() {
+        if(!filter.initialized)
+            initialize_filter();
         if(isRecordingBlockingTxEnabled() && !b_streamHandle) {
             b_streamHandle = new SCVNS scv_tr_stream((fixed_basename + "_bl").c_str(), "[TLM][base-protocol][b]", m_db);
             b_trHandle[tlm::TLM_READ_COMMAND] = new SCVNS scv_tr_generator<sc_dt::uint64, sc_dt::uint64>(
@@ -343,12 +516,17 @@ private:
 
 template <typename TYPES>
 void tlm_recorder<TYPES>::b_transport(typename TYPES::tlm_payload_type& trans, sc_core::sc_time& delay) {
+    flight_record fr(this, ::scc::flight_recorder::B_TRANSPORT, trans, delay);
     tlm_recording_payload* req{nullptr};
     if(!isRecordingBlockingTxEnabled()) {
         fw_port->b_transport(trans, delay);
         return;
     } else if(!b_streamHandle)
         initialize_streams();
+    if(!is_recorded(trans, true, false)) {
+        fw_port->b_transport(trans, delay);
+        return;
+    }
     // Get a handle for the new transaction
     SCVNS scv_tr_handle h = b_trHandle[trans.get_command()]->begin_transaction(delay.value(), sc_core::sc_time_stamp());
     /*************************************************************************
@@ -363,37 +541,44 @@ void tlm_recorder<TYPES>::b_transport(typename TYPES::tlm_payload_type& trans, s
         b_timed_peq.notify(*req, tlm::BEGIN_REQ, delay);
     }
 
-    for(auto& extensionRecording : tlm_extension_recording_registry<TYPES>::inst().get())
-        if(extensionRecording)
-            extensionRecording->recordBeginTx(h, trans);
+    for(auto* extensionRecording : ext_recorders)
+        extensionRecording->recordBeginTx(h, trans);
     tlm_recording_extension* preExt = nullptr;
 
     trans.get_extension(preExt);
-    if(preExt == nullptr) { // we are the first recording this transaction
-        preExt = new tlm_recording_extension(h, this);
-        if(trans.has_mm())
-            trans.set_auto_extension(preExt);
-        else
-            trans.set_extension(preExt);
+    auto const creator = preExt == nullptr;
+    if(creator) { // we are the first recording this transaction
+        // the extension only lives for the duration of the call so it is taken from the free list and not
+        // handed over to the memory manager of the payload
+        if(ext_free_list.empty())
+            preExt = new tlm_recording_extension(h, this);
+        else {
+            preExt = ext_free_list.back();
+            ext_free_list.pop_back();
+            preExt->txHandle = h;
+        }
+        trans.set_extension(preExt);
     } else {
         h.add_relation(rel_str(PREDECESSOR_SUCCESSOR), preExt->txHandle);
     }
     SCVNS scv_tr_handle preTx{preExt->txHandle};
     preExt->txHandle = h;
+    // write data is recorded as sent, read data as returned
+    if(filter.data_size && trans.is_write())
+        record_data(h, trans, filter.data_size);
     fw_port->b_transport(trans, delay);
-    if(preExt && preExt->get_creator() == this) {
+    if(creator) {
         // clean-up the extension if this is the original creator
         trans.set_extension(static_cast<tlm_recording_extension*>(nullptr));
-        if(!trans.has_mm()) {
-            delete preExt;
-        }
+        ext_free_list.push_back(preExt);
     } else {
         preExt->txHandle = preTx;
     }
     record(h, trans);
-    for(auto& extensionRecording : tlm_extension_recording_registry<TYPES>::inst().get())
-        if(extensionRecording)
-            extensionRecording->recordEndTx(h, trans);
+    if(filter.data_size && trans.is_read())
+        record_data(h, trans, filter.data_size);
+    for(auto* extensionRecording : ext_recorders)
+        extensionRecording->recordEndTx(h, trans);
     // End the transaction
     b_trHandle[trans.get_command()]->end_transaction(h, delay.value(), sc_core::sc_time_stamp());
     // and now the stuff for the timed tx
@@ -408,15 +593,11 @@ void tlm_recorder<TYPES>::btx_cb(tlm_recording_payload& rec_parts, const typenam
     // Now process outstanding recordings
     switch(phase) {
     case tlm::BEGIN_REQ: {
-        h = b_trTimedHandle[rec_parts.get_command()]->begin_transaction();
-        h.add_relation(rel_str(PARENT_CHILD), rec_parts.parent);
-        btx_handle_map[rec_parts.id] = h;
+        rec_parts.timed = b_trTimedHandle[rec_parts.get_command()]->begin_transaction();
+        rec_parts.timed.add_relation(rel_str(PARENT_CHILD), rec_parts.parent);
     } break;
     case tlm::END_RESP: {
-        auto it = btx_handle_map.find(rec_parts.id);
-        sc_assert(it != btx_handle_map.end());
-        h = it->second;
-        btx_handle_map.erase(it);
+        h = rec_parts.timed;
         record(h, rec_parts);
         h.end_transaction();
         rec_parts.release();
@@ -431,10 +612,13 @@ template <typename TYPES>
 tlm::tlm_sync_enum tlm_recorder<TYPES>::nb_transport_fw(typename TYPES::tlm_payload_type& trans,
                                                         typename TYPES::tlm_phase_type& phase,
                                                         sc_core::sc_time& delay) {
+    flight_record fr(this, ::scc::flight_recorder::NB_TRANSPORT_FW, trans, delay, phase);
     if(!isRecordingNonBlockingTxEnabled())
         return fw_port->nb_transport_fw(trans, phase, delay);
     else if(!nb_streamHandle)
         initialize_streams();
+    if(!is_recorded(trans, phase == tlm::BEGIN_REQ, true))
+        return fw_port->nb_transport_fw(trans, phase, delay);
     /*************************************************************************
      * prepare recording
      *************************************************************************/
@@ -456,9 +640,8 @@ tlm::tlm_sync_enum tlm_recorder<TYPES>::nb_transport_fw(typename TYPES::tlm_payl
     if(preExt)
         preExt->txHandle = h;
     h.record_attribute("delay", delay.to_string());
-    for(auto& extensionRecording : tlm_extension_recording_registry<TYPES>::inst().get())
-        if(extensionRecording)
-            extensionRecording->recordBeginTx(h, trans);
+    for(auto* extensionRecording : ext_recorders)
+        extensionRecording->recordBeginTx(h, trans);
     /*************************************************************************
      * do the timed notification
      *************************************************************************/
@@ -469,6 +652,9 @@ tlm::tlm_sync_enum tlm_recorder<TYPES>::nb_transport_fw(typename TYPES::tlm_payl
         req->parent = h;
         nb_timed_peq.notify(*req, phase, delay);
     }
+    // write data is recorded with the request
+    if(filter.data_size && phase == tlm::BEGIN_REQ && trans.is_write())
+        record_data(h, trans, filter.data_size);
     /*************************************************************************
      * do the access
      *************************************************************************/
@@ -479,11 +665,15 @@ tlm::tlm_sync_enum tlm_recorder<TYPES>::nb_transport_fw(typename TYPES::tlm_payl
     record(h, status);
     h.record_attribute("delay[return_path]", delay.to_string());
     record(h, trans);
-    for(auto& extensionRecording : tlm_extension_recording_registry<TYPES>::inst().get())
-        if(extensionRecording)
-            extensionRecording->recordEndTx(h, trans);
+    // read data is recorded with the response if it is returned on the forward path
+    if(filter.data_size && trans.is_read() &&
+       (status == tlm::TLM_COMPLETED || (status == tlm::TLM_UPDATED && phase == tlm::BEGIN_RESP)))
+        record_data(h, trans, filter.data_size);
+    for(auto* extensionRecording : ext_recorders)
+        extensionRecording->recordEndTx(h, trans);
     // get the extension and free the memory if it was mine
     if(status == tlm::TLM_COMPLETED || (status == tlm::TLM_ACCEPTED && phase == tlm::END_RESP)) {
+        finish_sampled(trans);
         trans.get_extension(preExt);
         if(preExt && preExt->get_creator() == this) {
             trans.set_extension(static_cast<tlm_recording_extension*>(nullptr));
@@ -518,10 +708,13 @@ template <typename TYPES>
 tlm::tlm_sync_enum tlm_recorder<TYPES>::nb_transport_bw(typename TYPES::tlm_payload_type& trans,
                                                         typename TYPES::tlm_phase_type& phase,
                                                         sc_core::sc_time& delay) {
+    flight_record fr(this, ::scc::flight_recorder::NB_TRANSPORT_BW, trans, delay, phase);
     if(!isRecordingNonBlockingTxEnabled())
         return bw_port->nb_transport_bw(trans, phase, delay);
     else if(!nb_streamHandle)
         initialize_streams();
+    if(!is_recorded(trans, false, true))
+        return bw_port->nb_transport_bw(trans, phase, delay);
     /*************************************************************************
      * prepare recording
      *************************************************************************/
@@ -537,9 +730,8 @@ tlm::tlm_sync_enum tlm_recorder<TYPES>::nb_transport_bw(typename TYPES::tlm_payl
         preExt->txHandle = h;
     }
     h.record_attribute("delay", delay.to_string());
-    for(auto& extensionRecording : tlm_extension_recording_registry<TYPES>::inst().get())
-        if(extensionRecording)
-            extensionRecording->recordBeginTx(h, trans);
+    for(auto* extensionRecording : ext_recorders)
+        extensionRecording->recordBeginTx(h, trans);
     /*************************************************************************
      * do the timed notification
      *************************************************************************/
@@ -550,6 +742,9 @@ tlm::tlm_sync_enum tlm_recorder<TYPES>::nb_transport_bw(typename TYPES::tlm_payl
         req->parent = h;
         nb_timed_peq.notify(*req, phase, delay);
     }
+    // read data is recorded with the response
+    if(filter.data_size && phase == tlm::BEGIN_RESP && trans.is_read())
+        record_data(h, trans, filter.data_size);
     /*************************************************************************
      * do the access
      *************************************************************************/
@@ -560,13 +755,13 @@ tlm::tlm_sync_enum tlm_recorder<TYPES>::nb_transport_bw(typename TYPES::tlm_payl
     record(h, status);
     h.record_attribute("delay[return_path]", delay.to_string());
     record(h, trans);
-    for(auto& extensionRecording : tlm_extension_recording_registry<TYPES>::inst().get())
-        if(extensionRecording)
-            extensionRecording->recordEndTx(h, trans);
+    for(auto* extensionRecording : ext_recorders)
+        extensionRecording->recordEndTx(h, trans);
     // End the transaction
     nb_trHandle[BW]->end_transaction(h, phase2string(phase));
     if(status == tlm::TLM_COMPLETED || (status == tlm::TLM_UPDATED && phase == tlm::END_RESP)) {
         // the transaction is finished
+        finish_sampled(trans);
         if(preExt && preExt->get_creator() == this) {
             // clean-up the extension if this is the original creator
             trans.set_extension(static_cast<tlm_recording_extension*>(nullptr));
@@ -646,6 +841,8 @@ bool tlm_recorder<TYPES>::get_direct_mem_ptr(typename TYPES::tlm_payload_type& t
         return fw_port->get_direct_mem_ptr(trans, dmi_data);
     else if(!dmi_streamHandle)
         initialize_streams();
+    if(!in_address_ranges(trans.get_address(), trans.get_address()))
+        return fw_port->get_direct_mem_ptr(trans, dmi_data);
     SCVNS scv_tr_handle h = dmi_trGetHandle->begin_transaction();
     bool status = fw_port->get_direct_mem_ptr(trans, dmi_data);
     record(h, trans);
@@ -666,6 +863,10 @@ void tlm_recorder<TYPES>::invalidate_direct_mem_ptr(sc_dt::uint64 start_addr, sc
         return;
     } else if(!dmi_streamHandle)
         initialize_streams();
+    if(!in_address_ranges(start_addr, end_addr)) {
+        bw_port->invalidate_direct_mem_ptr(start_addr, end_addr);
+        return;
+    }
     SCVNS scv_tr_handle h = dmi_trInvalidateHandle->begin_transaction(start_addr);
     bw_port->invalidate_direct_mem_ptr(start_addr, end_addr);
     dmi_trInvalidateHandle->end_transaction(h, end_addr);
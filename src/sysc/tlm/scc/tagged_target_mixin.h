@@ -20,6 +20,8 @@
 #define SC_INCLUDE_DYNAMIC_PROCESSES
 #endif
 
+#include <deque>
+#include <memory>
 #include <scc/utilities.h>
 #include <sstream>
 #include <tlm>
@@ -120,6 +122,37 @@ private:
         base_type::operator->()->invalidate_direct_mem_ptr(s, e);
     }
 
+    // marks a transaction of b_transport being converted to nb_transport as pending on this socket
+    class pending_trans_ext : public tlm::tlm_extension<pending_trans_ext> {
+    public:
+        tlm::tlm_extension_base* clone() const { return nullptr; }
+        void free() {}
+        void copy_from(tlm::tlm_extension_base const&) {}
+        void finish(sc_core::sc_time const& t) {
+            end_event->notify(t);
+            owner = nullptr;
+        }
+        tagged_target_mixin* owner{nullptr};
+        sc_core::sc_event* end_event{nullptr};
+    };
+
+    pending_trans_ext* get_pending_trans(transaction_type& trans) {
+        auto* ext = trans.template get_extension<pending_trans_ext>();
+        return ext && ext->owner == this ? ext : nullptr;
+    }
+
+    sc_core::sc_event* get_event() {
+        if(m_free_events.empty()) {
+            m_events.emplace_back();
+            return &m_events.back();
+        }
+        auto* evt = m_free_events.back();
+        m_free_events.pop_back();
+        return evt;
+    }
+
+    void put_event(sc_core::sc_event* evt) { m_free_events.push_back(evt); }
+
     // Helper class to handle bw path calls
     // Needed to detect transaction end when called from b_transport.
     class bw_process : public tlm::tlm_bw_transport_if<TYPES> {
@@ -128,10 +161,8 @@ private:
         : m_owner(p_own) {}
 
         sync_enum_type nb_transport_bw(transaction_type& trans, phase_type& phase, sc_core::sc_time& t) {
-            typename std::map<transaction_type*, sc_core::sc_event*>::iterator it;
-
-            it = m_owner->m_pending_trans.find(&trans);
-            if(it == m_owner->m_pending_trans.end()) {
+            auto* ext = m_owner->get_pending_trans(trans);
+            if(!ext) {
                 // Not a blocking call, forward.
                 return m_owner->bw_nb_transport(trans, phase, t);
 
@@ -145,8 +176,7 @@ private:
                         m_owner->m_end_request.notify(sc_core::SC_ZERO_TIME);
                     }
                     // TODO: add response-accept delay?
-                    it->second->notify(t);
-                    m_owner->m_pending_trans.erase(it);
+                    ext->finish(t);
                     return tlm::TLM_COMPLETED;
 
                 } else {
@@ -282,6 +312,12 @@ private:
                 return;
 
             } else if(m_nb_transport_ptr) {
+                // mark the transaction as pending on this socket, a pending one of an outer socket is restored later
+                pending_trans_ext pt_ext;
+                pt_ext.owner = m_owner;
+                pt_ext.end_event = m_owner->get_event();
+                auto* outer_ext = trans.set_extension(&pt_ext);
+
                 m_peq.notify(trans, t);
                 t = sc_core::SC_ZERO_TIME;
 
@@ -295,9 +331,9 @@ private:
                 }
 
                 // wait until transaction is finished
-                sc_core::sc_event end_event;
-                m_owner->m_pending_trans[&trans] = &end_event;
-                sc_core::wait(end_event);
+                sc_core::wait(*pt_ext.end_event);
+                m_owner->put_event(pt_ext.end_event);
+                trans.set_extension(outer_ext);
 
                 if(mm_added) {
                     // release will not delete the transaction, it will notify mm_ext.done
@@ -345,41 +381,37 @@ private:
         class process_handle_class {
         public:
             explicit process_handle_class(transaction_type* trans)
-            : m_trans(trans)
-            , m_suspend(false) {}
+            : m_trans(trans) {}
 
             transaction_type* m_trans{nullptr};
             sc_core::sc_event m_e{};
-            bool m_suspend{false};
+            process_handle_class* m_next_free{nullptr};
         };
-
+        //! owns the nb2b processes and keeps the suspended ones in an intrusive free list
         class process_handle_list {
         public:
             process_handle_list() = default;
 
-            ~process_handle_list() {
-                for(typename std::vector<process_handle_class*>::iterator it = v.begin(), end = v.end(); it != end;
-                    ++it)
-                    delete *it;
-            }
-
             process_handle_class* get_handle(transaction_type* trans) {
-                typename std::vector<process_handle_class*>::iterator it;
-
-                for(it = v.begin(); it != v.end(); it++) {
-                    if((*it)->m_suspend) {      // found suspended dynamic process, re-use it
-                        (*it)->m_trans = trans; // replace to new one
-                        (*it)->m_suspend = false;
-                        return *it;
-                    }
+                auto* ph = m_free;
+                if(ph) { // found suspended dynamic process, re-use it
+                    m_free = ph->m_next_free;
+                    ph->m_next_free = nullptr;
+                    ph->m_trans = trans; // replace to new one
                 }
-                return NULL; // no suspended process
+                return ph; // nullptr if there is no suspended process
             }
 
-            void put_handle(process_handle_class* ph) { v.push_back(ph); }
+            void put_handle(process_handle_class* ph) { v.emplace_back(ph); }
+
+            void suspend_handle(process_handle_class* ph) {
+                ph->m_next_free = m_free;
+                m_free = ph;
+            }
 
         private:
-            std::vector<process_handle_class*> v{};
+            std::vector<std::unique_ptr<process_handle_class>> v{};
+            process_handle_class* m_free{nullptr};
         };
 
         process_handle_list m_process_handle{};
@@ -407,7 +439,7 @@ private:
                 }
 
                 // suspend until next transaction
-                h->m_suspend = true;
+                m_process_handle.suspend_handle(h);
                 sc_core::wait();
             }
         }
@@ -425,11 +457,9 @@ private:
                     switch(m_nb_transport_ptr(tags[1], *trans, phase, t)) {
                     case tlm::TLM_COMPLETED: {
                         // notify transaction is finished
-                        typename std::map<transaction_type*, sc_core::sc_event*>::iterator it =
-                            m_owner->m_pending_trans.find(trans);
-                        assert(it != m_owner->m_pending_trans.end());
-                        it->second->notify(t);
-                        m_owner->m_pending_trans.erase(it);
+                        auto* ext = m_owner->get_pending_trans(*trans);
+                        assert(ext);
+                        ext->finish(t);
                         break;
                     }
 
@@ -453,11 +483,9 @@ private:
                             m_nb_transport_ptr(tags[1], *trans, phase, t);
 
                             // notify transaction is finished
-                            typename std::map<transaction_type*, sc_core::sc_event*>::iterator it =
-                                m_owner->m_pending_trans.find(trans);
-                            assert(it != m_owner->m_pending_trans.end());
-                            it->second->notify(t);
-                            m_owner->m_pending_trans.erase(it);
+                            auto* ext = m_owner->get_pending_trans(*trans);
+                            assert(ext);
+                            ext->finish(t);
                             break;
                         }
 
@@ -508,7 +536,8 @@ private:
 private:
     fw_process m_fw_process;
     bw_process m_bw_process;
-    std::map<transaction_type*, sc_core::sc_event*> m_pending_trans{};
+    std::deque<sc_core::sc_event> m_events{};
+    std::vector<sc_core::sc_event*> m_free_events{};
     sc_core::sc_event m_end_request{};
     transaction_type* m_current_transaction{nullptr};
 };